@@ -114,6 +114,205 @@ bool dijkstra(const HandleGraph* g, const unordered_set<handle_t>& starts,
 
 }
 
+DijkstraWorkspace::DijkstraWorkspace(size_t arity) : arity(max<size_t>(arity, 2)) {
+    // Nothing to do
+}
+
+DijkstraWorkspace& DijkstraWorkspace::get_thread_local() {
+    static thread_local DijkstraWorkspace workspace;
+    return workspace;
+}
+
+void DijkstraWorkspace::reset(const HandleGraph* g, const vector<handle_t>& starts) {
+    heap.clear();
+    sparse_slots.clear();
+    
+    generation++;
+    if (generation == 0) {
+        // We wrapped around, so old stamps could look current. Clear them all.
+        fill(stamps.begin(), stamps.end(), 0);
+        generation = 1;
+    }
+    
+    // Finding the ID range can mean a scan over the whole graph, so only do it
+    // if this looks like a different graph from last time. If we guess wrong,
+    // handles out of the range just get sparse slots.
+    bool same_range = (g == graph && g->get_node_count() == node_count);
+    for (auto& start : starts) {
+        if (!same_range || dense_span == 0) {
+            break;
+        }
+        same_range = (g->get_id(start) >= min_id && (size_t) (g->get_id(start) - min_id) < dense_span);
+    }
+    if (same_range) {
+        return;
+    }
+    
+    graph = g;
+    node_count = g->get_node_count();
+    dense_span = 0;
+    if (node_count > 0) {
+        // Use a dense table if the ID space isn't much bigger than the graph,
+        // or than we want to hold for each thread.
+        min_id = g->min_node_id();
+        size_t id_span = g->max_node_id() - min_id + 1;
+        if (id_span <= 2 * node_count + 1024 && id_span <= MAX_DENSE_SPAN) {
+            dense_span = id_span;
+            size_t needed = 2 * dense_span;
+            if (stamps.size() < needed) {
+                stamps.resize(needed, 0);
+                distances.resize(needed);
+                heap_positions.resize(needed);
+                handles.resize(needed);
+                is_start.resize(needed);
+            }
+        }
+    }
+}
+
+size_t DijkstraWorkspace::slot_of(const handle_t& handle) {
+    size_t slot;
+    id_t id = graph->get_id(handle);
+    if (id >= min_id && (size_t) (id - min_id) < dense_span) {
+        slot = (id - min_id) * 2 + graph->get_is_reverse(handle);
+    } else {
+        auto inserted = sparse_slots.emplace(handle, 2 * dense_span + sparse_slots.size());
+        slot = inserted.first->second;
+        if (slot >= stamps.size()) {
+            size_t needed = max<size_t>(slot + 1, stamps.size() * 2);
+            stamps.resize(needed, 0);
+            distances.resize(needed);
+            heap_positions.resize(needed);
+            handles.resize(needed);
+            is_start.resize(needed);
+        }
+    }
+    
+    if (stamps[slot] != generation) {
+        // Slot is left over from a previous search, so start it fresh.
+        stamps[slot] = generation;
+        distances[slot] = numeric_limits<size_t>::max();
+        heap_positions[slot] = UNQUEUED;
+        handles[slot] = handle;
+        is_start[slot] = false;
+    }
+    return slot;
+}
+
+void DijkstraWorkspace::sift_up(size_t heap_index) {
+    size_t slot = heap[heap_index];
+    while (heap_index > 0) {
+        size_t parent = (heap_index - 1) / arity;
+        if (distances[heap[parent]] <= distances[slot]) {
+            break;
+        }
+        heap[heap_index] = heap[parent];
+        heap_positions[heap[heap_index]] = heap_index;
+        heap_index = parent;
+    }
+    heap[heap_index] = slot;
+    heap_positions[slot] = heap_index;
+}
+
+void DijkstraWorkspace::sift_down(size_t heap_index) {
+    size_t slot = heap[heap_index];
+    while (true) {
+        size_t first_child = heap_index * arity + 1;
+        if (first_child >= heap.size()) {
+            break;
+        }
+        // Find the closest child
+        size_t best_child = first_child;
+        size_t past_last_child = min(first_child + arity, heap.size());
+        for (size_t child = first_child + 1; child < past_last_child; child++) {
+            if (distances[heap[child]] < distances[heap[best_child]]) {
+                best_child = child;
+            }
+        }
+        if (distances[heap[best_child]] >= distances[slot]) {
+            break;
+        }
+        heap[heap_index] = heap[best_child];
+        heap_positions[heap[heap_index]] = heap_index;
+        heap_index = best_child;
+    }
+    heap[heap_index] = slot;
+    heap_positions[slot] = heap_index;
+}
+
+bool DijkstraWorkspace::search(const HandleGraph* g, const vector<handle_t>& starts,
+                               const function<bool(const handle_t&, size_t)>& reached_callback,
+                               bool traverse_leftward, size_t max_distance) {
+    
+    reset(g, starts);
+    
+    for (auto& start : starts) {
+        size_t slot = slot_of(start);
+        if (is_start[slot]) {
+            continue;
+        }
+        is_start[slot] = true;
+        distances[slot] = 0;
+        heap.push_back(slot);
+        sift_up(heap.size() - 1);
+    }
+    
+    while (!heap.empty()) {
+        // Pop the closest slot
+        size_t slot = heap.front();
+        heap_positions[slot] = SETTLED;
+        size_t last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0] = last;
+            sift_down(0);
+        }
+        
+        size_t distance = distances[slot];
+        if (distance > max_distance) {
+            // Everything left is out of bounds.
+            return true;
+        }
+        
+        handle_t current = handles[slot];
+        if (!reached_callback(current, distance)) {
+            return false;
+        }
+        
+        if (!is_start[slot]) {
+            // Count distance from the end of the start handles, as dijkstra() does.
+            distance += g->get_length(current);
+        }
+        if (distance > max_distance) {
+            // Nothing past here can be in bounds
+            continue;
+        }
+        
+        g->follow_edges(current, traverse_leftward, [&](const handle_t& next) {
+            size_t next_slot = slot_of(next);
+            size_t position = heap_positions[next_slot];
+            if (position == SETTLED || distances[next_slot] <= distance) {
+                return;
+            }
+            distances[next_slot] = distance;
+            if (position == UNQUEUED) {
+                heap.push_back(next_slot);
+                position = heap.size() - 1;
+            }
+            sift_up(position);
+        });
+    }
+    
+    return true;
+}
+
+bool bounded_dijkstra(const HandleGraph* g, const vector<handle_t>& starts, size_t max_distance,
+                      const function<bool(const handle_t&, size_t)>& reached_callback,
+                      bool traverse_leftward) {
+    return DijkstraWorkspace::get_thread_local().search(g, starts, reached_callback, traverse_leftward, max_distance);
+}
+
+
     
 }
 }
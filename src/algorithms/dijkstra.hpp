@@ -8,6 +8,8 @@
  */
 
 #include <unordered_map>
+#include <limits>
+#include <vector>
 #include <vg/vg.pb.h>
 
 #include "../position.hpp"
@@ -41,6 +43,100 @@ namespace algorithms {
     bool dijkstra(const HandleGraph* g, const unordered_set<handle_t>& starts,
                   function<bool(const handle_t&, size_t)> reached_callback,
                   bool traverse_leftward = false);
+
+    /**
+     * Reusable state for running many Dijkstra searches over handle graphs,
+     * such as one per read or seed pair, without allocating for each one.
+     *
+     * Tentative distances live in a table of slots that is kept between
+     * searches and invalidated by bumping a generation stamp rather than by
+     * clearing it. When the graph's node IDs are dense enough, and don't span
+     * more than MAX_DENSE_SPAN IDs, slots are indexed directly by ID and
+     * orientation; other handles are assigned slots through a reused hash
+     * map. The ID range is only looked up again when the graph, its node
+     * count, or the range the starts fall in changes, so repeated searches on
+     * one graph don't pay for a scan of it. The frontier is an indexed d-ary
+     * heap over slots, so improving a distance is a decrease-key instead of
+     * a duplicate push.
+     *
+     * A workspace is not thread safe; use get_thread_local() to get one for
+     * the current thread. Callbacks must not start another search on the
+     * workspace that is calling them.
+     */
+    class DijkstraWorkspace {
+    public:
+        
+        /// Make a workspace with a heap of the given arity.
+        DijkstraWorkspace(size_t arity = 4);
+        
+        /// Get a workspace that belongs to the calling thread.
+        static DijkstraWorkspace& get_thread_local();
+        
+        /// Run the same search as dijkstra() from the given starts, except
+        /// that handles farther than max_distance are never reached, and the
+        /// search ends (normally) once the frontier passes max_distance.
+        /// Returns true if the search terminated normally, and false if it was
+        /// aborted by the callback.
+        bool search(const HandleGraph* g, const vector<handle_t>& starts,
+                    const function<bool(const handle_t&, size_t)>& reached_callback,
+                    bool traverse_leftward = false,
+                    size_t max_distance = numeric_limits<size_t>::max());
+        
+    protected:
+        
+        /// Prepare the slot table for a search on the given graph from the given starts.
+        void reset(const HandleGraph* g, const vector<handle_t>& starts);
+        
+        /// Get the slot for a handle, making it current if it is stale.
+        size_t slot_of(const handle_t& handle);
+        
+        /// Move the heap entry at the given heap index up or down to where it belongs.
+        void sift_up(size_t heap_index);
+        void sift_down(size_t heap_index);
+        
+        /// Heap position value for slots that have been settled.
+        static const size_t SETTLED = numeric_limits<size_t>::max();
+        /// Heap position value for slots that have not been queued yet.
+        static const size_t UNQUEUED = numeric_limits<size_t>::max() - 1;
+        /// Largest ID span to address densely. Each ID takes two slots of
+        /// about 28 bytes each, so this keeps the table around 14 MB.
+        static const size_t MAX_DENSE_SPAN = 1 << 18;
+        
+        size_t arity;
+        
+        /// Generation of the current search; slots stamped otherwise are stale.
+        uint32_t generation = 0;
+        
+        /// The graph being searched
+        const HandleGraph* graph = nullptr;
+        /// The node count the ID range was computed at
+        size_t node_count = 0;
+        /// The minimum node ID addressed densely
+        id_t min_id = 0;
+        /// The number of IDs from min_id that are addressed densely, or 0 if
+        /// the graph is not addressed densely
+        size_t dense_span = 0;
+        /// Slot assignments for handles outside the dense range, which come
+        /// after the dense slots
+        unordered_map<handle_t, size_t> sparse_slots;
+        
+        /// Per-slot state
+        vector<uint32_t> stamps;
+        vector<size_t> distances;
+        vector<size_t> heap_positions;
+        vector<handle_t> handles;
+        vector<bool> is_start;
+        
+        /// The heap of slots, ordered by distance
+        vector<size_t> heap;
+    };
+    
+    /// Run a bounded Dijkstra search with the calling thread's workspace.
+    /// Visits the handles within max_distance of the starts, closest first,
+    /// measuring distances the same way as dijkstra().
+    bool bounded_dijkstra(const HandleGraph* g, const vector<handle_t>& starts, size_t max_distance,
+                          const function<bool(const handle_t&, size_t)>& reached_callback,
+                          bool traverse_leftward = false);
                                                       
 }
 }
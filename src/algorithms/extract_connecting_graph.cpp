@@ -5,6 +5,7 @@
  */
  
 #include "extract_connecting_graph.hpp"
+#include "dijkstra.hpp"
 #include <structures/updateable_priority_queue.hpp>
 
 //#define debug_vg_algorithms
@@ -541,36 +542,32 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
         // some nodes in the current graph may not be on paths, or the paths that they are on may be
         // above the maximum distance, so we do a forward-backward distance search to check
         
-        // compute the minimum distance from the two start point s
-        unordered_map<handle_t, size_t> forward_dist = find_shortest_paths(into, cut_handle_1, false);
-        unordered_map<handle_t, size_t> reverse_dist = find_shortest_paths(into, cut_handle_2, true);
-
-        // also consider minimum distances from alternate start points if we have them
-        if (duplicate_node_1) {
-            auto alt_forward_dist = find_shortest_paths(into, into->get_handle(duplicate_node_1, is_rev(pos_1)), false);
-            for (const auto& alt_dist : alt_forward_dist) {
-                auto iter = forward_dist.find(alt_dist.first);
-                if (iter != forward_dist.end()) {
-                    iter->second = min(iter->second, alt_dist.second);
+        // compute the minimum distance from the two start points, and also from alternate start
+        // points if we have them. anything farther than the max length can't be on a short enough
+        // walk, so we stop the searches there
+        unordered_map<handle_t, size_t> forward_dist;
+        unordered_map<handle_t, size_t> reverse_dist;
+        auto record_min_dists = [&](const handle_t& start, bool traverse_leftward,
+                                    unordered_map<handle_t, size_t>& dists) {
+            bounded_dijkstra(into, {start}, max_len, [&](const handle_t& handle, size_t distance) {
+                auto iter = dists.find(handle);
+                if (iter != dists.end()) {
+                    iter->second = min(iter->second, distance);
                 }
                 else {
-                    forward_dist.insert(alt_dist);
+                    dists[handle] = distance;
                 }
-            }
-        }
+                return true;
+            }, traverse_leftward);
+        };
         
-        // also consider minimum distances from alternate start points if we have them
+        record_min_dists(cut_handle_1, false, forward_dist);
+        record_min_dists(cut_handle_2, true, reverse_dist);
+        if (duplicate_node_1) {
+            record_min_dists(into->get_handle(duplicate_node_1, is_rev(pos_1)), false, forward_dist);
+        }
         if (duplicate_node_2) {
-            auto alt_reverse_dist = find_shortest_paths(into, into->get_handle(duplicate_node_2, is_rev(pos_2)), true);
-            for (const auto& alt_dist : alt_reverse_dist) {
-                auto iter = reverse_dist.find(alt_dist.first);
-                if (iter != reverse_dist.end()) {
-                    iter->second = min(iter->second, alt_dist.second);
-                }
-                else {
-                    reverse_dist.insert(alt_dist);
-                }
-            }
+            record_min_dists(into->get_handle(duplicate_node_2, is_rev(pos_2)), true, reverse_dist);
         }
         
         // now we have the lengths of the shortest path remaining in graph to and from each node
@@ -1,10 +1,13 @@
 #include "id_sort.hpp"
 
 #include "apply_bulk_modifications.hpp"
+#include "../utility.hpp"
 
 #include <algorithm>
 #include <vector>
 
+#include <omp.h>
+
 namespace vg {
 namespace algorithms {
 
@@ -25,6 +28,51 @@ vector<handle_t> id_order(const HandleGraph* g) {
     
     return to_return;
 }
+
+vector<handle_t> parallel_id_order(const HandleGraph* g) {
+    
+    size_t thread_count = get_thread_count();
+    if (thread_count <= 1 || omp_in_parallel()) {
+        return id_order(g);
+    }
+    
+    // Sort IDs alongside the handles so comparisons don't go back to the graph.
+    vector<pair<id_t, handle_t>> keyed;
+    keyed.reserve(g->get_node_count());
+    g->for_each_handle([&](const handle_t& handle) {
+        keyed.emplace_back(g->get_id(handle), handle);
+    });
+    
+    auto by_id = [](const pair<id_t, handle_t>& a, const pair<id_t, handle_t>& b) {
+        return a.first < b.first;
+    };
+    
+    // Sort one chunk per thread
+    size_t chunk_count = min(thread_count, max<size_t>(keyed.size() / 1024, 1));
+    vector<size_t> bounds(chunk_count + 1);
+    for (size_t i = 0; i <= chunk_count; i++) {
+        bounds[i] = keyed.size() * i / chunk_count;
+    }
+#pragma omp parallel for schedule(static, 1)
+    for (size_t i = 0; i < chunk_count; i++) {
+        std::sort(keyed.begin() + bounds[i], keyed.begin() + bounds[i + 1], by_id);
+    }
+    
+    // Then merge neighboring chunks until there's only one left
+    for (size_t width = 1; width < chunk_count; width *= 2) {
+#pragma omp parallel for schedule(static, 1)
+        for (size_t i = 0; i < chunk_count - width; i += 2 * width) {
+            std::inplace_merge(keyed.begin() + bounds[i], keyed.begin() + bounds[i + width],
+                               keyed.begin() + bounds[min(i + 2 * width, chunk_count)], by_id);
+        }
+    }
+    
+    vector<handle_t> to_return(keyed.size());
+    for (size_t i = 0; i < keyed.size(); i++) {
+        to_return[i] = keyed[i].second;
+    }
+    return to_return;
+}
     
 }
 }
@@ -22,6 +22,13 @@ using namespace std;
  * Order all the handles in the graph in ID order. All orientations are forward.
  */
 vector<handle_t> id_order(const HandleGraph* g);
+
+/**
+ * Produce the same order as id_order(), sorting chunks of the handles in
+ * parallel and then merging them pairwise. Falls back to id_order() when
+ * there is only one thread or we are already in a parallel region.
+ */
+vector<handle_t> parallel_id_order(const HandleGraph* g);
                                                       
 }
 }
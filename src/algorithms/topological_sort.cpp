@@ -1,4 +1,9 @@
 #include "topological_sort.hpp"
+#include "weakly_connected_components.hpp"
+#include "../utility.hpp"
+
+#include <omp.h>
+#include <queue>
 
 namespace vg {
 namespace algorithms {
@@ -257,6 +262,235 @@ vector<handle_t> topological_order(const HandleGraph* g) {
     // Send away our sorted ordering.
     return sorted;
 }
+
+/// How a component's part of the topological sort restarted after running
+/// out of oriented nodes.
+enum class SortRestart { HEADS, SEED, ARBITRARY };
+
+/// One stretch of a component's sort order, from a restart until it ran out
+/// of oriented nodes again.
+struct SortPhase {
+    /// Index of the phase's first handle in the component's order
+    size_t begin;
+    SortRestart restart;
+    /// The ID of the node the phase started from (unused for heads)
+    id_t start_id;
+};
+
+/// Run the topological_order() algorithm on a single weakly connected
+/// component, given as its node ranks in ascending ID order, recording where
+/// each phase begins.
+static void component_topological_order(const HandleGraph* g, const ComponentLabeling& labeling,
+                                        const vector<size_t>& local_of, const size_t* ranks, size_t count,
+                                        vector<handle_t>& order, vector<SortPhase>& phases) {
+    
+    auto local = [&](const handle_t& handle) {
+        return local_of[labeling.rank_of(g->get_id(handle))];
+    };
+    auto handle_at = [&](size_t here, bool is_reverse) {
+        return g->get_handle(labeling.ranked_ids[ranks[here]], is_reverse);
+    };
+    
+    // Dense replacements for the unvisited set, the oriented set s, and the seeds.
+    vector<bool> visited(count, false);
+    vector<bool> oriented_reverse(count, false);
+    vector<bool> has_seed(count, false);
+    vector<bool> seed_reverse(count, false);
+    priority_queue<size_t, vector<size_t>, greater<size_t>> s;
+    priority_queue<size_t, vector<size_t>, greater<size_t>> seeds;
+    size_t next_unvisited = 0;
+    size_t unvisited_count = count;
+    
+    unordered_set<pair<handle_t, handle_t>> masked_edges;
+    
+    order.reserve(count);
+    
+    for (size_t i = 0; i < count; i++) {
+        // Start from all the heads at once
+        bool no_left_edges = g->follow_edges(handle_at(i, false), true, [&](const handle_t& ignored) {
+            return false;
+        });
+        if (no_left_edges) {
+            visited[i] = true;
+            unvisited_count--;
+            s.push(i);
+        }
+    }
+    if (!s.empty()) {
+        phases.push_back({0, SortRestart::HEADS, 0});
+    }
+    
+    while (unvisited_count > 0 || !s.empty()) {
+        
+        while (s.empty() && !seeds.empty()) {
+            size_t seed = seeds.top();
+            seeds.pop();
+            if (!visited[seed]) {
+                visited[seed] = true;
+                unvisited_count--;
+                oriented_reverse[seed] = seed_reverse[seed];
+                s.push(seed);
+                phases.push_back({order.size(), SortRestart::SEED, labeling.ranked_ids[ranks[seed]]});
+            }
+        }
+        
+        if (s.empty()) {
+            // Grab the lowest-ID unvisited node, locally forward
+            while (visited[next_unvisited]) {
+                next_unvisited++;
+            }
+            visited[next_unvisited] = true;
+            unvisited_count--;
+            oriented_reverse[next_unvisited] = false;
+            s.push(next_unvisited);
+            phases.push_back({order.size(), SortRestart::ARBITRARY, labeling.ranked_ids[ranks[next_unvisited]]});
+        }
+        
+        while (!s.empty()) {
+            size_t here = s.top();
+            s.pop();
+            handle_t n = handle_at(here, oriented_reverse[here]);
+            order.push_back(n);
+            
+            // Mask edges from our start to cycle entry points
+            g->follow_edges(n, true, [&](const handle_t& prev_node) {
+                if (visited[local(prev_node)]) {
+                    auto edge = g->edge_handle(prev_node, n);
+                    if (!masked_edges.count(edge)) {
+                        masked_edges.insert(edge);
+                    }
+                }
+            });
+            
+            g->follow_edges(n, false, [&](const handle_t& next_node) {
+                auto edge = g->edge_handle(n, next_node);
+                if (masked_edges.count(edge)) {
+                    return;
+                }
+                masked_edges.insert(edge);
+                
+                size_t next = local(next_node);
+                if (!visited[next]) {
+                    bool unmasked_incoming_edge = false;
+                    g->follow_edges(next_node, true, [&](const handle_t& prev_node) {
+                        if (!masked_edges.count(g->edge_handle(prev_node, next_node))) {
+                            unmasked_incoming_edge = true;
+                            return false;
+                        }
+                        return true;
+                    });
+                    
+                    if (!unmasked_incoming_edge) {
+                        visited[next] = true;
+                        unvisited_count--;
+                        oriented_reverse[next] = g->get_is_reverse(next_node);
+                        s.push(next);
+                    } else if (!has_seed[next]) {
+                        has_seed[next] = true;
+                        seed_reverse[next] = g->get_is_reverse(next_node);
+                        seeds.push(next);
+                    }
+                }
+            });
+        }
+    }
+}
+
+vector<handle_t> parallel_topological_order(const HandleGraph* g) {
+    
+    if (get_thread_count() <= 1 || omp_in_parallel()) {
+        return topological_order(g);
+    }
+    
+    ComponentLabeling labeling = weakly_connected_component_labels(g);
+    if (labeling.component_count <= 1) {
+        return topological_order(g);
+    }
+    
+    // Group the node ranks by component, keeping them in ID order, and find
+    // each node's index within its component.
+    size_t node_count = labeling.ranked_ids.size();
+    vector<size_t> component_start(labeling.component_count + 1, 0);
+    for (auto& label : labeling.labels) {
+        component_start[label + 1]++;
+    }
+    for (size_t c = 0; c < labeling.component_count; c++) {
+        component_start[c + 1] += component_start[c];
+    }
+    vector<size_t> component_ranks(node_count);
+    vector<size_t> local_of(node_count);
+    {
+        vector<size_t> filled(component_start.begin(), component_start.end() - 1);
+        for (size_t rank = 0; rank < node_count; rank++) {
+            size_t c = labeling.labels[rank];
+            local_of[rank] = filled[c] - component_start[c];
+            component_ranks[filled[c]++] = rank;
+        }
+    }
+    
+    // Sort all the components
+    vector<vector<handle_t>> orders(labeling.component_count);
+    vector<vector<SortPhase>> phases(labeling.component_count);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t c = 0; c < labeling.component_count; c++) {
+        component_topological_order(g, labeling, local_of, component_ranks.data() + component_start[c],
+                                    component_start[c + 1] - component_start[c], orders[c], phases[c]);
+    }
+    
+    // Now interleave them. All the components with heads run together at
+    // first, each time emitting whichever oriented node has the lowest ID.
+    vector<handle_t> sorted;
+    sorted.reserve(node_count);
+    vector<size_t> next_phase(labeling.component_count, 0);
+    
+    auto phase_end = [&](size_t c, size_t phase) {
+        return phase + 1 < phases[c].size() ? phases[c][phase + 1].begin : orders[c].size();
+    };
+    
+    using Pending = pair<id_t, size_t>;
+    priority_queue<Pending, vector<Pending>, greater<Pending>> heads_merge;
+    vector<size_t> cursor(labeling.component_count, 0);
+    for (size_t c = 0; c < labeling.component_count; c++) {
+        if (!phases[c].empty() && phases[c].front().restart == SortRestart::HEADS) {
+            heads_merge.emplace(g->get_id(orders[c].front()), c);
+        }
+    }
+    while (!heads_merge.empty()) {
+        size_t c = heads_merge.top().second;
+        heads_merge.pop();
+        sorted.push_back(orders[c][cursor[c]++]);
+        if (cursor[c] < phase_end(c, 0)) {
+            heads_merge.emplace(g->get_id(orders[c][cursor[c]]), c);
+        } else {
+            next_phase[c] = 1;
+        }
+    }
+    
+    // After that, one phase runs at a time. Cycle-breaking seeds are preferred
+    // over arbitrary nodes, and lower IDs over higher ones.
+    priority_queue<Pending, vector<Pending>, greater<Pending>> seed_phases;
+    priority_queue<Pending, vector<Pending>, greater<Pending>> arbitrary_phases;
+    auto enqueue_next_phase = [&](size_t c) {
+        if (next_phase[c] < phases[c].size()) {
+            auto& phase = phases[c][next_phase[c]];
+            (phase.restart == SortRestart::SEED ? seed_phases : arbitrary_phases).emplace(phase.start_id, c);
+        }
+    };
+    for (size_t c = 0; c < labeling.component_count; c++) {
+        enqueue_next_phase(c);
+    }
+    while (!seed_phases.empty() || !arbitrary_phases.empty()) {
+        auto& source = seed_phases.empty() ? arbitrary_phases : seed_phases;
+        size_t c = source.top().second;
+        source.pop();
+        
+        size_t phase = next_phase[c]++;
+        sorted.insert(sorted.end(), orders[c].begin() + phases[c][phase].begin, orders[c].begin() + phase_end(c, phase));
+        enqueue_next_phase(c);
+    }
+    
+    return sorted;
+}
     
 vector<handle_t> lazy_topological_order_internal(const HandleGraph* g, bool lazier) {
     
@@ -60,6 +60,20 @@ vector<handle_t> tail_nodes(const HandleGraph* g);
  */
 vector<handle_t> topological_order(const HandleGraph* g);
 
+/**
+ * Produce exactly the same order and orientation as topological_order(), but
+ * sort the weakly connected components concurrently, with dense
+ * rank-indexed bookkeeping in place of the ID-keyed maps. Each component's
+ * part of the serial algorithm does not depend on the others, so we record
+ * each component's order along with the points where it restarted from its
+ * heads, a cycle-breaking seed, or an arbitrary node, and then interleave the
+ * components' orders the way the serial algorithm would have.
+ *
+ * Falls back to topological_order() for graphs with a single component, when
+ * there is only one thread, or when called from inside a parallel region.
+ */
+vector<handle_t> parallel_topological_order(const HandleGraph* g);
+
 /**
  * Order the nodes in a graph using a topological sort. The sort is NOT guaranteed
  * to be machine-independent, but it is faster than topological_order(). This algorithm 
@@ -1,115 +1,172 @@
 #include "weakly_connected_components.hpp"
 
+#include <atomic>
+#include <algorithm>
+#include <limits>
+
+#include <omp.h>
+
 namespace vg {
 namespace algorithms {
 
 using namespace std;
 
-vector<unordered_set<id_t>> weakly_connected_components(const HandleGraph* graph) {
-    vector<unordered_set<id_t>> to_return;
-    
-    // This only holds locally forward handles
-    unordered_set<handle_t> traversed;
+size_t ComponentLabeling::rank_of(id_t id) const {
+    if (contiguous) {
+        return id - ranked_ids.front();
+    }
+    auto found = lower_bound(ranked_ids.begin(), ranked_ids.end(), id);
+    assert(found != ranked_ids.end() && *found == id);
+    return found - ranked_ids.begin();
+}
+
+size_t ComponentLabeling::component_of(id_t id) const {
+    return labels[rank_of(id)];
+}
+
+/// Graphs with fewer nodes than this are labeled on one thread, since the
+/// work isn't worth starting threads for (as when labeling per read).
+static const size_t MIN_PARALLEL_NODES = 10000;
+
+ComponentLabeling weakly_connected_component_labels(const HandleGraph* graph) {
+    ComponentLabeling to_return;
     
+    // Rank the nodes by ID
+    auto& ranked_ids = to_return.ranked_ids;
+    ranked_ids.reserve(graph->get_node_count());
     graph->for_each_handle([&](const handle_t& handle) {
-        
-        // Only think about it in the forward orientation
-        auto forward = graph->forward(handle);
-        
-        if (traversed.count(forward)) {
-            // Already have this node, so don't start a search from it.
-            return;
+        ranked_ids.push_back(graph->get_id(handle));
+    });
+    sort(ranked_ids.begin(), ranked_ids.end());
+    to_return.contiguous = !ranked_ids.empty() && ranked_ids.back() - ranked_ids.front() + 1 == (id_t) ranked_ids.size();
+    
+    size_t node_count = ranked_ids.size();
+    
+    // Don't nest parallel regions in callers that are already parallel
+    bool run_parallel = node_count >= MIN_PARALLEL_NODES && !omp_in_parallel();
+    
+    // Union-find forest over ranks. Roots are always linked under smaller
+    // roots, so every root is the smallest rank in its set.
+    vector<atomic<size_t>> parent(node_count);
+#pragma omp parallel for if(run_parallel)
+    for (size_t i = 0; i < node_count; i++) {
+        parent[i].store(i, memory_order_relaxed);
+    }
+    
+    // Find the root of a rank, halving the path on the way. Concurrent
+    // halving is safe because it only ever points a node at one of its
+    // ancestors.
+    auto find = [&](size_t here) {
+        while (true) {
+            size_t up = parent[here].load(memory_order_relaxed);
+            if (up == here) {
+                return here;
+            }
+            size_t up_up = parent[up].load(memory_order_relaxed);
+            if (up_up != up) {
+                parent[here].compare_exchange_weak(up, up_up, memory_order_relaxed);
+            }
+            here = up_up;
         }
-        
-        // The stack only holds locally forward handles
-        vector<handle_t> stack{forward};
-        to_return.emplace_back();
-        while (!stack.empty()) {
-            handle_t here = stack.back();
-            stack.pop_back();
-            
-            traversed.insert(here);
-            to_return.back().insert(graph->get_id(here));
-            
-            // We have a function to handle all connected handles
-            auto handle_other = [&](const handle_t& other) {
-                // Again, make it forward
-                auto other_forward = graph->forward(other);
-                
-                if (!traversed.count(other_forward)) {
-                    stack.push_back(other_forward);
-                }
-            };
-            
-            // Look at edges in both directions
-            graph->follow_edges(here, false, handle_other);
-            graph->follow_edges(here, true, handle_other);
-            
+    };
+    
+    graph->for_each_edge([&](const edge_t& edge) {
+        size_t a = to_return.rank_of(graph->get_id(edge.first));
+        size_t b = to_return.rank_of(graph->get_id(edge.second));
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                break;
+            }
+            if (a < b) {
+                swap(a, b);
+            }
+            // Link the larger root under the smaller, if it is still a root.
+            size_t expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, memory_order_relaxed)) {
+                break;
+            }
+        }
+    }, run_parallel);
+    
+    // Flatten the forest, and number the roots in rank order.
+    auto& labels = to_return.labels;
+    labels.resize(node_count);
+#pragma omp parallel for if(run_parallel)
+    for (size_t i = 0; i < node_count; i++) {
+        labels[i] = find(i);
+    }
+    vector<size_t> root_numbers(node_count);
+    size_t component_count = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        if (labels[i] == i) {
+            root_numbers[i] = component_count++;
         }
+    }
+#pragma omp parallel for if(run_parallel)
+    for (size_t i = 0; i < node_count; i++) {
+        labels[i] = root_numbers[labels[i]];
+    }
+    to_return.component_count = component_count;
+    
+    return to_return;
+}
+
+/// Get the index each component should have in the output, so components come
+/// out in the order the graph first presents one of their nodes.
+static vector<size_t> presentation_order(const HandleGraph* graph, const ComponentLabeling& labeling) {
+    vector<size_t> order(labeling.component_count, numeric_limits<size_t>::max());
+    size_t next = 0;
+    graph->for_each_handle([&](const handle_t& handle) {
+        size_t& index = order[labeling.component_of(graph->get_id(handle))];
+        if (index == numeric_limits<size_t>::max()) {
+            index = next++;
+        }
+        // Stop once every component has been seen
+        return next < labeling.component_count;
     });
+    return order;
+}
+
+vector<unordered_set<id_t>> weakly_connected_components(const HandleGraph* graph) {
+    auto labeling = weakly_connected_component_labels(graph);
+    auto order = presentation_order(graph, labeling);
+    
+    vector<unordered_set<id_t>> to_return(labeling.component_count);
+    for (size_t i = 0; i < labeling.ranked_ids.size(); i++) {
+        to_return[order[labeling.labels[i]]].insert(labeling.ranked_ids[i]);
+    }
     return to_return;
 }
 
 vector<pair<unordered_set<id_t>, vector<handle_t>>> weakly_connected_components_with_tips(const HandleGraph* graph) {
-    // TODO: deduplicate with above
-    
-    vector<pair<unordered_set<id_t>, vector<handle_t>>> to_return;
+    auto labeling = weakly_connected_component_labels(graph);
+    auto order = presentation_order(graph, labeling);
     
-    // This only holds locally forward handles
-    unordered_set<handle_t> traversed;
-    
-    graph->for_each_handle([&](const handle_t& handle) {
+    vector<pair<unordered_set<id_t>, vector<handle_t>>> to_return(labeling.component_count);
+    for (size_t i = 0; i < labeling.ranked_ids.size(); i++) {
+        auto& component = to_return[order[labeling.labels[i]]];
+        component.first.insert(labeling.ranked_ids[i]);
         
-        // Only think about it in the forward orientation
-        auto forward = graph->forward(handle);
+        handle_t here = graph->get_handle(labeling.ranked_ids[i], false);
         
-        if (traversed.count(forward)) {
-            // Already have this node, so don't start a search from it.
-            return;
-        }
+        // A side with no edges makes a tip. Stop looking at the first edge.
+        auto no_edges = [&](bool go_left) {
+            return graph->follow_edges(here, go_left, [&](const handle_t& other) {
+                return false;
+            });
+        };
         
-        // The stack only holds locally forward handles
-        vector<handle_t> stack{forward};
-        to_return.emplace_back();
-        while (!stack.empty()) {
-            handle_t here = stack.back();
-            stack.pop_back();
-            
-            traversed.insert(here);
-            to_return.back().first.insert(graph->get_id(here));
-            
-            // We have a counter for the number of edges we saw.
-            // If it is 0 after traversing edges we know we have a tip.
-            size_t edge_counter = 0;
-            
-            // We have a function to handle all connected handles
-            auto handle_other = [&](const handle_t& other) {
-                // Again, make it forward
-                auto other_forward = graph->forward(other);
-                
-                if (!traversed.count(other_forward)) {
-                    stack.push_back(other_forward);
-                }
-                
-                edge_counter++;
-            };
-            
-            // Look at edges in both directions
-            graph->follow_edges(here, false, handle_other);
-            if (edge_counter == 0) {
-                // This is a tail node. Put it in reverse as a tip.
-                to_return.back().second.push_back(graph->flip(here));
-            }
-            
-            edge_counter = 0;
-            graph->follow_edges(here, true, handle_other);
-            if (edge_counter == 0) {
-                // This is a head node. Put it as a tip.
-                to_return.back().second.push_back(here);
-            }
-            
+        if (no_edges(false)) {
+            // This is a tail node. Put it in reverse as a tip.
+            component.second.push_back(graph->flip(here));
         }
-    });
+        if (no_edges(true)) {
+            // This is a head node. Put it as a tip.
+            component.second.push_back(here);
+        }
+    }
     return to_return;
 }
 
@@ -17,16 +17,50 @@ namespace algorithms {
 
 using namespace std;
 
+/**
+ * Weakly connected component labels for all the nodes in a graph, stored
+ * flat. Nodes are ranked by ascending ID, and components are numbered from 0
+ * in order of their smallest node ID.
+ */
+struct ComponentLabeling {
+    /// The graph's node IDs in ascending order; node rank i has ID ranked_ids[i].
+    vector<id_t> ranked_ids;
+    /// The component number of each node rank.
+    vector<size_t> labels;
+    /// The number of components.
+    size_t component_count = 0;
+    
+    /// Get the rank of a node ID, which must be in the graph.
+    size_t rank_of(id_t id) const;
+    
+    /// Get the component number of a node ID, which must be in the graph.
+    size_t component_of(id_t id) const;
+    
+protected:
+    /// Whether the IDs are contiguous, so ranks are offsets from the first.
+    bool contiguous = false;
+    
+    friend ComponentLabeling weakly_connected_component_labels(const HandleGraph* graph);
+};
+
+/// Label every node in the graph with its weakly connected component, as
+/// above. Components are found with a concurrent union-find over node ranks,
+/// with edges processed in parallel unless the graph is small or we are
+/// already in a parallel region.
+ComponentLabeling weakly_connected_component_labels(const HandleGraph* graph);
+
 /// Returns sets of IDs defining components that are connected by any series
 /// of nodes and edges, even if it is not a valid bidirected walk. TODO: It
 /// might make sense to have a handle-returning version, but the consumers of
 /// weakly connected components right now want IDs, and membership in a weakly
-/// connected component is orientation-independent.
+/// connected component is orientation-independent. Components are in the
+/// order that for_each_handle first reaches one of their nodes.
 vector<unordered_set<id_t>> weakly_connected_components(const HandleGraph* graph);
 
 /// Return pairs of weakly connected component ID sets and the handles that are
 /// their tips, oriented inward. If a node is both a head and a tail, it will
-/// appear in tips in both orientations.
+/// appear in tips in both orientations. Components are ordered as in
+/// weakly_connected_components(), and tips within each are in ID order.
 vector<pair<unordered_set<id_t>, vector<handle_t>>> weakly_connected_components_with_tips(const HandleGraph* graph);
 
 }
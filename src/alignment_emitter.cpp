@@ -820,4 +820,56 @@ void VGAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_bat
     }
 }
 
+MultipathAlignmentEmitter::MultipathAlignmentEmitter(const string& filename, size_t max_threads):
+    out_file(filename == "-" ? nullptr : new ofstream(filename)),
+    multiplexer(out_file.get() != nullptr ? *out_file : cout, max_threads) {
+    
+    if (filename != "-") {
+        // Check the file
+        if (!*out_file) {
+            // We couldn't get it open
+            cerr << "[vg::MultipathAlignmentEmitter] failed to open " << filename << " for writing" << endl;
+            exit(1);
+        }
+    }
+    
+    // We need per-thread emitters
+    proto.reserve(max_threads);
+    for (size_t i = 0; i < max_threads; i++) {
+        // Make an emitter for each thread.
+        proto.emplace_back(new vg::io::ProtobufEmitter<MultipathAlignment>(multiplexer.get_thread_stream(i)));
+    }
+}
+
+MultipathAlignmentEmitter::~MultipathAlignmentEmitter() {
+    for (auto& emitter : proto) {
+        // Flush each ProtobufEmitter
+        emitter->flush();
+        // Make it go away before the stream
+        emitter.reset();
+    }
+}
+
+void MultipathAlignmentEmitter::emit_singles(vector<MultipathAlignment>&& mp_aln_batch) {
+    if (mp_aln_batch.empty()) {
+        // Nothing to do
+        return;
+    }
+    
+    size_t thread_number = omp_get_thread_num();
+    
+#ifdef debug
+    #pragma omp critical (cerr)
+    cerr << "MultipathAlignmentEmitter emitting " << mp_aln_batch.size() << " alignments to Protobuf in thread " << thread_number << endl;
+#endif
+    
+    proto[thread_number]->write_many(std::move(mp_aln_batch));
+    if (multiplexer.want_breakpoint(thread_number)) {
+        // The multiplexer wants our data.
+        // Flush and create a breakpoint.
+        proto[thread_number]->flush();
+        multiplexer.register_breakpoint(thread_number);
+    }
+}
+
 }
@@ -302,6 +302,45 @@ private:
     vector<unique_ptr<vg::io::ProtobufEmitter<Alignment>>> proto;
 };
 
+/**
+ * Emit MultipathAlignments to a stream in protobuf format.
+ * Thread safe.
+ *
+ * Each thread serializes into its own buffer, and the buffers are handed off
+ * to the output stream through a StreamMultiplexer, so threads never have to
+ * wait on each other to produce output.
+ */
+class MultipathAlignmentEmitter {
+public:
+    /// Create a MultipathAlignmentEmitter writing to the given file (or "-").
+    MultipathAlignmentEmitter(const string& filename, size_t max_threads);
+    
+    /// Finish and destroy a MultipathAlignmentEmitter.
+    ~MultipathAlignmentEmitter();
+    
+    // Not copyable or movable
+    MultipathAlignmentEmitter(const MultipathAlignmentEmitter& other) = delete;
+    MultipathAlignmentEmitter& operator=(const MultipathAlignmentEmitter& other) = delete;
+    MultipathAlignmentEmitter(MultipathAlignmentEmitter&& other) = delete;
+    MultipathAlignmentEmitter& operator=(MultipathAlignmentEmitter&& other) = delete;
+    
+    /// Emit a batch of MultipathAlignments, in order. Pairs must already be
+    /// collated in the batch.
+    void emit_singles(vector<MultipathAlignment>&& mp_aln_batch);
+    
+private:
+    
+    /// If we are doing output to a file, this will hold the open file. Otherwise (for stdout) it will be empty.
+    unique_ptr<ofstream> out_file;
+    
+    /// This holds a StreamMultiplexer on the output stream, for sharing it
+    /// between threads.
+    vg::io::StreamMultiplexer multiplexer;
+    
+    /// We keep ProtobufEmitters, one per thread.
+    vector<unique_ptr<vg::io::ProtobufEmitter<MultipathAlignment>>> proto;
+};
+
 }
 
 
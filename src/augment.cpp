@@ -1,8 +1,12 @@
 #include "vg.hpp"
 #include <vg/io/stream.hpp>
 
+#include <omp.h>
+
 #include "augment.hpp"
 #include "alignment.hpp"
+#include "packer.hpp"
+#include "edit.hpp"
 
 //#define debug
 
@@ -10,6 +14,24 @@ namespace vg {
 
 using namespace std;
 
+/// Call the given function with each node ID and position at which
+/// find_breakpoints() would break the graph, in the same order.
+static void for_each_breakpoint(const Path& path, bool break_ends,
+                                const function<void(id_t, const pos_t&)>& iteratee);
+
+/// Implementation of add_nodes_and_edges() that makes edges through the given
+/// function. If the path adds no new sequence, the graph is not modified
+/// except through create_edge.
+static Path embed_path(MutableHandleGraph* graph,
+                       const Path& path,
+                       const map<pos_t, id_t>& node_translation,
+                       unordered_map<pair<pos_t, string>, vector<id_t>>& added_seqs,
+                       unordered_map<id_t, Path>& added_nodes,
+                       const unordered_map<id_t, size_t>& orig_node_sizes,
+                       set<NodeSide>& dangling,
+                       size_t max_node_size,
+                       const function<void(const handle_t&, const handle_t&)>& create_edge);
+
 // The correct way to edit the graph
 void augment(MutablePathMutableHandleGraph* graph,
              istream& gam_stream,
@@ -17,7 +39,9 @@ void augment(MutablePathMutableHandleGraph* graph,
              ostream* gam_out_stream,
              function<void(Path&)> save_path_fn,
              bool break_at_ends,
-             bool remove_softclips) {
+             bool remove_softclips,
+             const Packer* packer,
+             size_t min_edit_support) {
 
     function<void(function<void(Alignment&)>, bool)> iterate_gam =
         [&gam_stream] (function<void(Alignment&)> aln_callback, bool reset_stream) {
@@ -34,7 +58,9 @@ void augment(MutablePathMutableHandleGraph* graph,
                  gam_out_stream,
                  save_path_fn,
                  break_at_ends,
-                 remove_softclips);
+                 remove_softclips,
+                 packer,
+                 min_edit_support);
 }
 
 void augment(MutablePathMutableHandleGraph* graph,
@@ -43,7 +69,9 @@ void augment(MutablePathMutableHandleGraph* graph,
              ostream* gam_out_stream,
              function<void(Path&)> save_path_fn,
              bool break_at_ends,
-             bool remove_softclips) {
+             bool remove_softclips,
+             const Packer* packer,
+             size_t min_edit_support) {
     
     function<void(function<void(Alignment&)>, bool)> iterate_gam =
         [&path_vector] (function<void(Alignment&)> aln_callback, bool reset_stream) {
@@ -61,7 +89,9 @@ void augment(MutablePathMutableHandleGraph* graph,
                  gam_out_stream,
                  save_path_fn,
                  break_at_ends,
-                 remove_softclips);
+                 remove_softclips,
+                 packer,
+                 min_edit_support);
 }
 
 void augment_impl(MutablePathMutableHandleGraph* graph,
@@ -70,29 +100,104 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
                   ostream* gam_out_stream,
                   function<void(Path&)> save_path_fn,
                   bool break_at_ends,
-                  bool remove_softclips) {
-    // Collect the breakpoints
-    unordered_map<id_t, set<pos_t>> breakpoints;
-
-    // First pass: find the breakpoints
-    iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
+                  bool remove_softclips,
+                  const Packer* packer,
+                  size_t min_edit_support) {
+    
+    size_t thread_count = get_thread_count();
+    // How many reads should we hold at once to work on in parallel?
+    size_t batch_size = 256 * thread_count;
+    
+    // Both passes work on batches of reads pulled out of the serial iterator
+    auto for_each_batch = [&](const function<void(vector<Alignment>&)>& batch_callback, bool reset_stream) {
+        vector<Alignment> batch;
+        batch.reserve(batch_size);
+        iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
+                batch.emplace_back(std::move(aln));
+                if (batch.size() == batch_size) {
+                    batch_callback(batch);
+                    batch.clear();
+                }
+            }, reset_stream);
+        if (!batch.empty()) {
+            batch_callback(batch);
+        }
+    };
+    
+    // First pass: find the breakpoints. Each thread collects its own, and
+    // remembers which read and breakpoint first touched each node. Reads
+    // are split into contiguous runs by thread, so that's the first touch
+    // within the thread.
+    struct FirstTouchedBreakpoints {
+        pair<size_t, size_t> first_touch;
+        set<pos_t> positions;
+    };
+    vector<unordered_map<id_t, FirstTouchedBreakpoints>> thread_breakpoints(thread_count);
+    size_t reads_seen = 0;
+    for_each_batch([&](vector<Alignment>& batch) {
+#pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < batch.size(); i++) {
+                Alignment& aln = batch[i];
 #ifdef debug
-            cerr << pb2json(aln.path()) << endl;
+#pragma omp critical (cerr)
+                cerr << pb2json(aln.path()) << endl;
 #endif
 
-            if (remove_softclips) {
-                softclip_trim(aln);
-            }
-
-            // Simplify the path, just to eliminate adjacent match Edits in the same
-            // Mapping (because we don't have or want a breakpoint there)
-            Path simplified_path = simplify(aln.path());
-
-
-            // Add in breakpoints from each path
-            find_breakpoints(simplified_path, breakpoints, break_at_ends);
+                if (remove_softclips) {
+                    softclip_trim(aln);
+                }
+                if (packer != nullptr) {
+                    filter_unsupported_edits(*aln.mutable_path(), *packer, min_edit_support);
+                }
 
+                // Simplify the path, just to eliminate adjacent match Edits in the same
+                // Mapping (because we don't have or want a breakpoint there)
+                Path simplified_path = simplify(aln.path());
+
+                // Add in breakpoints from each path
+                auto& breakpoints = thread_breakpoints[omp_get_thread_num()];
+                size_t breakpoint_number = 0;
+                for_each_breakpoint(simplified_path, break_at_ends, [&](id_t node_id, const pos_t& breakpoint) {
+                        auto found = breakpoints.find(node_id);
+                        if (found == breakpoints.end()) {
+                            found = breakpoints.emplace(node_id, FirstTouchedBreakpoints{
+                                    make_pair(reads_seen + i, breakpoint_number), set<pos_t>()}).first;
+                        }
+                        found->second.positions.insert(breakpoint);
+                        breakpoint_number++;
+                    });
+            }
+            reads_seen += batch.size();
         }, false);
+    
+    // Merge the threads' breakpoints
+    unordered_map<id_t, FirstTouchedBreakpoints> merged = std::move(thread_breakpoints.front());
+    for (size_t i = 1; i < thread_breakpoints.size(); i++) {
+        for (auto& kv : thread_breakpoints[i]) {
+            auto found = merged.find(kv.first);
+            if (found == merged.end()) {
+                merged.emplace(kv.first, std::move(kv.second));
+            } else {
+                found->second.first_touch = min(found->second.first_touch, kv.second.first_touch);
+                found->second.positions.insert(kv.second.positions.begin(), kv.second.positions.end());
+            }
+        }
+        thread_breakpoints[i].clear();
+    }
+    
+    // Then add the nodes to the breakpoints map in the order a single thread
+    // would have, so it iterates (and we break nodes) in the same order.
+    vector<pair<pair<size_t, size_t>, id_t>> touch_order;
+    touch_order.reserve(merged.size());
+    for (auto& kv : merged) {
+        touch_order.emplace_back(kv.second.first_touch, kv.first);
+    }
+    sort(touch_order.begin(), touch_order.end());
+    unordered_map<id_t, set<pos_t>> breakpoints;
+    for (auto& touch : touch_order) {
+        breakpoints[touch.second] = std::move(merged[touch.second].positions);
+    }
+    merged.clear();
 
     // Invert the breakpoints that are on the reverse strand
     breakpoints = forwardize_breakpoints(graph, breakpoints);
@@ -116,56 +221,116 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
     unordered_map<id_t, Path> added_nodes;
     // output gam buffer
     vector<Alignment> gam_buffer;
+    
+    // Reads that add no new sequence can be embedded in parallel against the
+    // divided graph. We hold on to the edges they need and make them later, in
+    // order.
+    struct EmbeddedRead {
+        Path simplified_path;
+        bool embedded = false;
+        Path added;
+        vector<pair<handle_t, handle_t>> edges;
+    };
+    vector<EmbeddedRead> embedded_reads;
+    
+    // We check that each embedded path's edges are all in the graph
+    auto for_each_path_edge = [&](const Path& added, const function<void(const handle_t&, const handle_t&)>& iteratee) {
+        // something is off about this check.
+        // assuming the GAM path is sorted, let's double-check that its edges are here
+        for (size_t i = 1; i < added.mapping_size(); ++i) {
+            auto& m1 = added.mapping(i-1);
+            auto& m2 = added.mapping(i);
+            // we're no longer sorting our input paths, so we assume they are sorted
+            assert((m1.rank() == 0 && m2.rank() == 0) || (m1.rank() + 1 == m2.rank()));
+            //if (!adjacent_mappings(m1, m2)) continue; // the path is completely represented here
+            iteratee(graph->get_handle(m1.position().node_id(), m1.position().is_reverse()),
+                     graph->get_handle(m2.position().node_id(), m2.position().is_reverse()));
+        }
+    };
 
     // Second pass: add the nodes and edges
-    iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
-            if (remove_softclips) {
-                softclip_trim(aln);
-            }
+    for_each_batch([&](vector<Alignment>& batch) {
+            embedded_reads.resize(batch.size());
+#pragma omp parallel for schedule(dynamic, 64)
+            for (size_t i = 0; i < batch.size(); i++) {
+                Alignment& aln = batch[i];
+                EmbeddedRead& read = embedded_reads[i];
+                
+                if (remove_softclips) {
+                    softclip_trim(aln);
+                }
+                if (packer != nullptr) {
+                    filter_unsupported_edits(*aln.mutable_path(), *packer, min_edit_support);
+                }
 
-            // Simplify the path, just to eliminate adjacent match Edits in the same
-            // Mapping (because we don't have or want a breakpoint there)
-            // Note: We're electing to re-simplify in a second pass to avoid storing all
-            // the input paths in memory
-            Path simplified_path = simplify(aln.path());
+                // Simplify the path, just to eliminate adjacent match Edits in the same
+                // Mapping (because we don't have or want a breakpoint there)
+                // Note: We're electing to re-simplify in a second pass to avoid storing all
+                // the input paths in memory
+                read.simplified_path = simplify(aln.path());
+                read.edges.clear();
+                
+                read.embedded = true;
+                for (size_t j = 0; j < read.simplified_path.mapping_size() && read.embedded; j++) {
+                    for (auto& edit : read.simplified_path.mapping(j).edit()) {
+                        if (edit_is_insertion(edit) || edit_is_sub(edit)) {
+                            // This read adds nodes, so it has to wait its turn.
+                            read.embedded = false;
+                            break;
+                        }
+                    }
+                }
+                
+                if (read.embedded) {
+                    // Nothing will look at the added nodes or sequences for this path
+                    set<NodeSide> dangling;
+                    read.added = embed_path(graph, read.simplified_path, node_translation, added_seqs,
+                                            added_nodes, orig_node_sizes, dangling, 1024,
+                                            [&](const handle_t& left, const handle_t& right) {
+                            read.edges.emplace_back(left, right);
+                        });
+                }
+            }
+            
+            for (size_t i = 0; i < batch.size(); i++) {
+                Alignment& aln = batch[i];
+                EmbeddedRead& read = embedded_reads[i];
+                
+                Path added;
+                if (read.embedded) {
+                    for (auto& edge : read.edges) {
+                        graph->create_edge(edge.first, edge.second);
+                    }
+                    added = std::move(read.added);
+                } else {
+                    // Create new nodes/wire things up. Get the added version of the path.
+                    added = add_nodes_and_edges(graph, read.simplified_path, node_translation, added_seqs,
+                                                added_nodes, orig_node_sizes);
+                }
 
-            // Now go through each new path again, by reference so we can overwrite.
-        
-            // Create new nodes/wire things up. Get the added version of the path.
-            Path added = add_nodes_and_edges(graph, simplified_path, node_translation, added_seqs,
-                                             added_nodes, orig_node_sizes);
+                // Copy over the name
+                *added.mutable_name() = aln.name();
 
-            // Copy over the name
-            *added.mutable_name() = aln.name();
+                if (save_path_fn) {
+                    save_path_fn(added);
+                }
 
-            if (save_path_fn) {
-                save_path_fn(added);
-            }
+                for_each_path_edge(added, [&](const handle_t& s1, const handle_t& s2) {
+                        // check that we always have an edge between the two nodes in the correct direction
+                        if (!graph->has_edge(s1, s2)) {
+                            // force these edges in
+                            graph->create_edge(s1, s2);
+                        }
+                    });
 
-            // something is off about this check.
-            // assuming the GAM path is sorted, let's double-check that its edges are here
-            for (size_t i = 1; i < added.mapping_size(); ++i) {
-                auto& m1 = added.mapping(i-1);
-                auto& m2 = added.mapping(i);
-                // we're no longer sorting our input paths, so we assume they are sorted
-                assert((m1.rank() == 0 && m2.rank() == 0) || (m1.rank() + 1 == m2.rank()));
-                //if (!adjacent_mappings(m1, m2)) continue; // the path is completely represented here
-                auto s1 = graph->get_handle(m1.position().node_id(), m1.position().is_reverse());
-                auto s2 = graph->get_handle(m2.position().node_id(), m2.position().is_reverse());
-                // check that we always have an edge between the two nodes in the correct direction
-                if (!graph->has_edge(s1, s2)) {
-                    // force these edges in
-                    graph->create_edge(s1, s2);
+                // optionally write out the modified path to GAM
+                if (gam_out_stream != nullptr) {
+                    *aln.mutable_path() = added;
+                    gam_buffer.push_back(aln);
+                    vg::io::write_buffered(*gam_out_stream, gam_buffer, 100);
                 }
             }
-
-            // optionally write out the modified path to GAM
-            if (gam_out_stream != nullptr) {
-                *aln.mutable_path() = added;
-                gam_buffer.push_back(aln);
-                vg::io::write_buffered(*gam_out_stream, gam_buffer, 100);
-            }
-    }, true);
+        }, true);
     if (gam_out_stream != nullptr) {
         // Flush the buffer
         vg::io::write_buffered(*gam_out_stream, gam_buffer, 0);
@@ -201,8 +366,15 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
 }
 
 
-// returns breakpoints on the forward strand of the nodes
 void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpoints, bool break_ends) {
+    for_each_breakpoint(path, break_ends, [&](id_t node_id, const pos_t& breakpoint) {
+        breakpoints[node_id].insert(breakpoint);
+    });
+}
+
+// returns breakpoints on the forward strand of the nodes
+static void for_each_breakpoint(const Path& path, bool break_ends,
+                                const function<void(id_t, const pos_t&)>& iteratee) {
     // We need to work out what offsets we will need to break each node at, if
     // we want to add in all the new material and edges in this path.
 
@@ -264,7 +436,7 @@ void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpo
 
                 // We need to snip between edit_first_position and edit_first_position - direction.
                 // Note that it doesn't matter if we put breakpoints at 0 and 1-past-the-end; those will be ignored.
-                breakpoints[node_id].insert(edit_first_position);
+                iteratee(node_id, edit_first_position);
             }
 
             if (!edit_is_match(e) || (j == m.edit_size() - 1 && (i != path.mapping_size() - 1 || break_ends))) {
@@ -279,7 +451,7 @@ void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpo
 #endif
 
                 // We also need to snip between edit_last_position and edit_last_position + direction.
-                breakpoints[node_id].insert(edit_last_position);
+                iteratee(node_id, edit_last_position);
             }
 
             // TODO: for an insertion or substitution, note that we need a new
@@ -297,6 +469,66 @@ void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpo
 
 }
 
+size_t filter_unsupported_edits(Path& path, const Packer& packer, size_t min_support) {
+    size_t replaced = 0;
+    for (size_t i = 0; i < path.mapping_size(); ++i) {
+        Mapping& m = *path.mutable_mapping(i);
+        if (!m.has_position() || m.position().node_id() == 0 || !packer.graph->has_node(m.position().node_id())) {
+            // The packer can't have seen anything here
+            continue;
+        }
+        bool is_rev = m.position().is_reverse();
+        
+        // Walk along the node the same way the packer did when recording edits
+        size_t pos_in_basis = packer.position_in_basis(m.position());
+        vector<Edit> kept;
+        kept.reserve(m.edit_size());
+        bool changed = false;
+        for (auto& e : m.edit()) {
+            if (!edit_is_match(e)) {
+                // The packer stores edits on the forward strand
+                Edit oriented = is_rev ? reverse_complement_edit(e) : e;
+                size_t support = 0;
+                for (auto& seen : packer.edits_at_position(pos_in_basis)) {
+                    if (seen.from_length() == oriented.from_length() && seen.to_length() == oriented.to_length()
+                        && seen.sequence() == oriented.sequence()) {
+                        if (++support >= min_support) {
+                            break;
+                        }
+                    }
+                }
+                if (support < min_support) {
+                    // Follow the reference instead
+                    ++replaced;
+                    changed = true;
+                    if (e.from_length() > 0) {
+                        Edit match;
+                        match.set_from_length(e.from_length());
+                        match.set_to_length(e.from_length());
+                        kept.push_back(match);
+                    }
+                } else {
+                    kept.push_back(e);
+                }
+            } else {
+                kept.push_back(e);
+            }
+            if (is_rev) {
+                pos_in_basis -= e.from_length();
+            } else {
+                pos_in_basis += e.from_length();
+            }
+        }
+        if (changed) {
+            m.clear_edit();
+            for (auto& e : kept) {
+                *m.add_edit() = e;
+            }
+        }
+    }
+    return replaced;
+}
+
 unordered_map<id_t, set<pos_t>> forwardize_breakpoints(const HandleGraph* graph,
                                                        const unordered_map<id_t, set<pos_t>>& breakpoints) {
     unordered_map<id_t, set<pos_t>> fwd;
@@ -446,6 +678,22 @@ Path add_nodes_and_edges(MutableHandleGraph* graph,
                          set<NodeSide>& dangling,
                          size_t max_node_size) {
     
+    return embed_path(graph, path, node_translation, added_seqs, added_nodes, orig_node_sizes, dangling, max_node_size,
+                      [&](const handle_t& left, const handle_t& right) {
+        graph->create_edge(left, right);
+    });
+}
+
+static Path embed_path(MutableHandleGraph* graph,
+                       const Path& path,
+                       const map<pos_t, id_t>& node_translation,
+                       unordered_map<pair<pos_t, string>, vector<id_t>>& added_seqs,
+                       unordered_map<id_t, Path>& added_nodes,
+                       const unordered_map<id_t, size_t>& orig_node_sizes,
+                       set<NodeSide>& dangling,
+                       size_t max_node_size,
+                       const function<void(const handle_t&, const handle_t&)>& create_edge) {
+    
     // The basic algorithm is to traverse the path edit by edit, keeping track
     // of a NodeSide for the last piece of sequence we were on. If we hit an
     // edit that creates new sequence, we check if it has been added before If
@@ -635,7 +883,7 @@ Path add_nodes_and_edges(MutableHandleGraph* graph,
 #endif
                         if (!new_nodes.empty()) {
                             // Connect each to the previous node in the chain.
-                            graph->create_edge(graph->get_handle(new_nodes.back()), new_node);
+                            create_edge(graph->get_handle(new_nodes.back()), new_node);
 #ifdef debug_edit
                             cerr << "Create edge " << new_nodes.back() << "," << graph->get_id(new_node) << endl;
 #endif
@@ -704,8 +952,8 @@ Path add_nodes_and_edges(MutableHandleGraph* graph,
                     cerr << "Connecting " << dangler << " and " << to_attach << endl;
 #endif
                     // Add an edge from the dangling NodeSide to the start of this new node
-                    graph->create_edge(graph->get_handle(dangler.node, !dangler.is_end),
-                                       graph->get_handle(to_attach.node, to_attach.is_end));
+                    create_edge(graph->get_handle(dangler.node, !dangler.is_end),
+                                graph->get_handle(to_attach.node, to_attach.is_end));
 
                 }
 
@@ -754,8 +1002,8 @@ Path add_nodes_and_edges(MutableHandleGraph* graph,
 #endif
 
                     // Connect the left end of the left node we matched in the direction we matched it
-                    graph->create_edge(graph->get_handle(dangler.node, !dangler.is_end),
-                                       graph->get_handle(left_node,  m.position().is_reverse()));
+                    create_edge(graph->get_handle(dangler.node, !dangler.is_end),
+                                graph->get_handle(left_node,  m.position().is_reverse()));
                 }
 
                 // Dangle the right end of the right node in the direction we matched it.
@@ -14,6 +14,8 @@ namespace vg {
     
 using namespace std;
 
+class Packer;
+
 /// %Edit the graph to include all the sequence and edges added by the given
 /// paths. Can handle paths that visit nodes in any orientation. Note that
 /// this method sorts the graph and rebuilds the path index, so it should
@@ -31,13 +33,18 @@ using namespace std;
 /// be added to the vg graph's paths object.
 /// If soft_clip is true, soft clips will be removed from the input paths
 /// before processing, and the dangling ends won't end up in the graph
+/// If packer is not null, edits seen fewer than min_edit_support times in
+/// it are not added to the graph (see filter_unsupported_edits()), so
+/// nodes are only broken for well-supported variation.
 void augment(MutablePathMutableHandleGraph* graph,
              istream& gam_stream,
              vector<Translation>* out_translation = nullptr,
              ostream* gam_out_stream = nullptr,
              function<void(Path&)> save_path_fn = nullptr,
              bool break_at_ends = false,
-             bool remove_soft_clips = false);
+             bool remove_soft_clips = false,
+             const Packer* packer = nullptr,
+             size_t min_edit_support = 0);
 
 /// Like above, but operates on a vector of Alignments, instead of a stream
 /// (Note: It is best to use stream interface for large numbers of alignments to save memory)
@@ -47,7 +54,9 @@ void augment(MutablePathMutableHandleGraph* graph,
              ostream* gam_out_stream = nullptr,
              function<void(Path&)> save_path_fn = nullptr,
              bool break_at_ends = false,
-             bool remove_soft_clips = false);
+             bool remove_soft_clips = false,
+             const Packer* packer = nullptr,
+             size_t min_edit_support = 0);
 
 /// Generic version used to implement the above two methods.  
 void augment_impl(MutablePathMutableHandleGraph* graph,
@@ -56,7 +65,17 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
                   ostream* gam_out_stream,
                   function<void(Path&)> save_path_fn,
                   bool break_at_ends,
-                  bool remove_soft_clips);
+                  bool remove_soft_clips,
+                  const Packer* packer,
+                  size_t min_edit_support);
+
+/// Replace the non-match edits in the path that were recorded fewer than
+/// min_support times in the packer with the reference they cover.
+/// Substitutions and deletions become matches, and insertions are dropped, so
+/// the path then follows the existing graph across them. The packer's graph
+/// must have the same nodes as the path. Returns the number of edits
+/// replaced.
+size_t filter_unsupported_edits(Path& path, const Packer& packer, size_t min_support);
 
 
 /// Find all the points at which a Path enters or leaves nodes in the graph. Adds
@@ -30,8 +30,37 @@ MEMChainModel::MEMChainModel(
     int band_width,
     int position_depth,
     int max_connections) {
+    // gather all of the hits so that we can look up their positions in the graph in node ID order,
+    // which keeps the lookups local in the graph index instead of jumping around at random
+    vector<gcsa::node_type> hits;
+    for (auto& fragment : matches) {
+        for (auto& mem : fragment) {
+            hits.insert(hits.end(), mem.nodes.begin(), mem.nodes.end());
+        }
+    }
+    vector<size_t> hit_order(hits.size());
+    for (size_t i = 0; i < hit_order.size(); i++) {
+        hit_order[i] = i;
+    }
+    sort(hit_order.begin(), hit_order.end(), [&](size_t i, size_t j) {
+        return hits[i] < hits[j];
+    });
+    vector<unordered_map<path_handle_t, vector<pair<size_t, bool> > > > hit_positions(hits.size());
+    for (size_t k = 0; k < hit_order.size(); k++) {
+        size_t i = hit_order[k];
+        if (k > 0 && hits[hit_order[k - 1]] == hits[i]) {
+            // same hit as the last one, reuse its positions
+            hit_positions[i] = hit_positions[hit_order[k - 1]];
+            continue;
+        }
+        auto pos = make_pos_t(hits[i]);
+        hit_positions[i] = path_position(pos);
+        hit_positions[i][handlegraph::as_path_handle(0)].push_back(make_pair(approx_position(pos), is_rev(pos)));
+    }
+    
     // store the MEMs in the model
     int frag_n = 0;
+    size_t hit_idx = 0;
     for (auto& fragment : matches) {
         ++frag_n;
         for (auto& mem : fragment) {
@@ -40,14 +69,12 @@ MEMChainModel::MEMChainModel(
             for (auto& node : mem.nodes) {
                 //model.emplace_back();
                 //auto m = model.back();
-                auto pos = make_pos_t(node);
                 MEMChainModelVertex m;
                 m.mem = mem;
                 m.weight = mem.length();
                 m.prev = nullptr;
                 m.score = 0;
-                m.mem.positions = path_position(pos);
-                m.mem.positions[handlegraph::as_path_handle(0)].push_back(make_pair(approx_position(pos), is_rev(pos)));
+                m.mem.positions = move(hit_positions[hit_idx++]);
                 m.mem.nodes.clear();
                 m.mem.nodes.push_back(node);
                 m.mem.fragment = frag_n;
@@ -497,13 +497,12 @@ namespace vg {
                     for (auto& alt : variant->alt) {
                         string upper_case_alt = toUppercase(alt);
                         if (alt != upper_case_alt) {
-                            if (!warned_alt && warn_on_lowercase) {
+                            // Chunks are constructed in parallel, so only the thread that
+                            // flips the flag gets to warn
+                            if (warn_on_lowercase && !warned_alt.exchange(true)) {
                                 #pragma omp critical (cerr)
-                                {
-                                    cerr << "warning:[vg::Constructor] Lowercase characters found in "
-                                         << "variant, coercing to uppercase:\n" << *variant << endl;
-                                    warned_alt = true;
-                                }
+                                cerr << "warning:[vg::Constructor] Lowercase characters found in "
+                                     << "variant, coercing to uppercase:\n" << *variant << endl;
                             }
                             swap(alt, upper_case_alt);
                             reindex = true;
@@ -1727,6 +1726,55 @@ namespace vg {
             callback(chunk.graph);
         };
 
+        // Chunks are independent of each other until they are wired together,
+        // so we queue them up and construct a batch of them in parallel. Then
+        // we wire and emit them in order, which assigns the same IDs a serial
+        // run would.
+        struct ChunkJob {
+            string reference_sequence;
+            vector<vcflib::Variant> variants;
+            size_t chunk_start;
+            size_t chunk_end;
+        };
+        vector<ChunkJob> pending_chunks;
+        size_t max_pending_chunks = max<size_t>(1, chunks_per_thread * get_thread_count());
+        
+        // Construct, wire up, and emit all the queued chunks
+        auto flush_pending_chunks = [&]() {
+            vector<ConstructedChunk> results(pending_chunks.size());
+#pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < pending_chunks.size(); i++) {
+                auto& job = pending_chunks[i];
+                results[i] = construct_chunk(move(job.reference_sequence), reference_contig,
+                                             move(job.variants), job.chunk_start);
+            }
+            
+            for (size_t i = 0; i < results.size(); i++) {
+                // Wire up and emit the chunk graph
+                wire_and_emit(results[i]);
+                
+                // Say we've completed the chunk
+                update_progress(pending_chunks[i].chunk_end - leading_offset);
+            }
+            
+            pending_chunks.clear();
+        };
+        
+        // Queue up a chunk, and process the queue if it's full
+        auto enqueue_chunk = [&](size_t chunk_start, size_t chunk_end, vector<vcflib::Variant>& chunk_variants) {
+            // Get the ref sequence we need
+            pending_chunks.emplace_back();
+            auto& job = pending_chunks.back();
+            job.reference_sequence = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
+            job.variants = move(chunk_variants);
+            job.chunk_start = chunk_start;
+            job.chunk_end = chunk_end;
+            
+            if (pending_chunks.size() >= max_pending_chunks) {
+                flush_pending_chunks();
+            }
+        };
+
         bool do_external_insertions = false;
         FastaReference* insertion_fasta;
 
@@ -1893,17 +1941,8 @@ namespace vg {
                             min((size_t) reference_end,
                                 (size_t) (chunk_start + bases_per_chunk))));
 
-                // Get the ref sequence we need
-                auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-                // Call the construction
-                auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-                // Wire up and emit the chunk graph
-                wire_and_emit(result);
-
-                // Say we've completed the chunk
-                update_progress(chunk_end - leading_offset);
+                // Queue up the construction
+                enqueue_chunk(chunk_start, chunk_end, chunk_variants);
 
                 // Set up a new chunk
                 chunk_start = chunk_end;
@@ -1925,23 +1964,17 @@ namespace vg {
                     min((size_t) reference_end,
                         (size_t) (chunk_start + bases_per_chunk)));
 
-            // Get the ref sequence we need
-            auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-            // Call the construction
-            auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-            // Wire up and emit the chunk graph
-            wire_and_emit(result);
-
-            // Say we've completed the chunk
-            update_progress(chunk_end - leading_offset);
+            // Queue up the construction
+            enqueue_chunk(chunk_start, chunk_end, chunk_variants);
 
             // Set up a new chunk
             chunk_start = chunk_end;
             chunk_end = 0;
             chunk_variants.clear();
         }
+        
+        // Finish off any chunks still in the queue
+        flush_pending_chunks();
 
         // All the chunks have been wired and emitted.
         
@@ -1960,6 +1993,45 @@ namespace vg {
         const vector<vcflib::VariantCallFile*>& variant_files, const vector<FastaReference*>& insertions,
         function<void(Graph&)> callback) {
 
+        // Make VcfBuffers on all the variant files.
+        vector<unique_ptr<VcfBuffer>> buffers;
+        for (auto* vcf : variant_files) {
+            // Every VCF gets a buffer wrapped around it.
+
+            if (!vcf->is_open()) {
+                // Except those that didn't open.
+                continue;
+            }
+
+            // These will all get destructed when the vector goes away.
+            buffers.emplace_back(new VcfBuffer(vcf));
+        }
+        
+        construct_graph(references, buffers, insertions, callback);
+    }
+    
+    void Constructor::construct_graph(const vector<FastaReference*>& references,
+        const vector<string>& variant_filenames, const vector<FastaReference*>& insertions,
+        function<void(Graph&)> callback) {
+
+        // Open all the variant files ourselves with htslib.
+        vector<unique_ptr<VcfBuffer>> buffers;
+        for (auto& filename : variant_filenames) {
+            buffers.emplace_back(new VcfBuffer(filename));
+            if (!buffers.back()->is_open()) {
+                // TODO: report errors to caller instead.
+                cerr << "[vg::Constructor] Error: could not open VCF " << filename << endl;
+                exit(1);
+            }
+        }
+        
+        construct_graph(references, buffers, insertions, callback);
+    }
+
+    void Constructor::construct_graph(const vector<FastaReference*>& references,
+        vector<unique_ptr<VcfBuffer>>& buffers, const vector<FastaReference*>& insertions,
+        function<void(Graph&)> callback) {
+
         // Make a map from contig name to fasta reference containing it.
         map<string, FastaReference*> reference_for;
         for (size_t i = 0; i < references.size(); i++) {
@@ -1975,20 +2047,6 @@ namespace vg {
             }
         }
 
-        // Make VcfBuffers on all the variant files.
-        vector<unique_ptr<VcfBuffer>> buffers;
-        for (auto* vcf : variant_files) {
-            // Every VCF gets a buffer wrapped around it.
-
-            if (!vcf->is_open()) {
-                // Except those that didn't open.
-                continue;
-            }
-
-            // These will all get destructed when the vector goes away.
-            buffers.emplace_back(new VcfBuffer(vcf));
-        }
-
         if (!allowed_vcf_names.empty()) {
             // If we have a set of contigs to do, do those directly.
 
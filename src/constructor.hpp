@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <functional>
 #include <regex>
+#include <atomic>
 
 #include "types.hpp"
 #include "progressive.hpp"
@@ -117,6 +118,10 @@ public:
     // How many bases do we want to have per chunk? We don't necessarily want to
     // load all of chr1 into an std::string, even if we have no variants on it.
     size_t bases_per_chunk = 1024 * 1024;
+
+    // How many chunks per thread should we queue up and construct in parallel
+    // before wiring them together? The output does not depend on this.
+    size_t chunks_per_thread = 4;
     
     // This set contains the set of VCF sequence names we want to build the
     // graph for. If empty, we will build the graph for all sequences in the
@@ -159,6 +164,9 @@ public:
      * reference and the variants from the given buffered VCF file. Emits a
      * sequence of Graph chunks, which may be too big to serealize directly.
      *
+     * Chunks are constructed in parallel on the available OMP threads, but are
+     * emitted in order and with the same IDs as if they were built serially.
+     *
      * Doesn't handle any of the setup for VCF indexing. Just scans all the
      * variants that can come out of the buffer, so make sure indexing is set on
      * the file first before passing it in.
@@ -176,8 +184,25 @@ public:
     void construct_graph(const vector<FastaReference*>& references, const vector<vcflib::VariantCallFile*>& variant_files,
         const vector<FastaReference*>& insertions, function<void(Graph&)> callback);
     
+    /**
+     * Construct a graph using the given FASTA references and VCF or BCF files
+     * on disk, which are read directly through htslib without parsing any
+     * sample columns. Has the same requirements on the VCFs as the vcflib
+     * version. Stops the program if a file cannot be opened.
+     */
+    void construct_graph(const vector<FastaReference*>& references, const vector<string>& variant_filenames,
+        const vector<FastaReference*>& insertions, function<void(Graph&)> callback);
+    
 protected:
     
+    /**
+     * Construct a graph from the given FASTA references and the variants in
+     * the given open VcfBuffers. Backs both of the public whole-genome
+     * construct_graph overloads.
+     */
+    void construct_graph(const vector<FastaReference*>& references, vector<unique_ptr<VcfBuffer>>& buffers,
+        const vector<FastaReference*>& insertions, function<void(Graph&)> callback);
+    
     /// Remembers which unusable symbolic alleles we've already emitted a warning
     /// about during construction.
     set<string> symbolic_allele_warnings;
@@ -229,8 +254,9 @@ private:
     static pair<int64_t, int64_t> get_symbolic_bounds(vcflib::Variant var);
     /// What sequences have we warned about containing lowercase characters?
     mutable unordered_set<string> warned_sequences;
-    /// Have we given a warning yet about lowercase alt alleles?
-    mutable bool warned_alt = false;
+    /// Have we given a warning yet about lowercase alt alleles? Set by whichever
+    /// chunk-constructing thread gets to print the warning.
+    mutable atomic<bool> warned_alt{false};
     
 
 };
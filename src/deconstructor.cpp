@@ -191,7 +191,61 @@ pair<int, bool> Deconstructor::choose_traversal(const vector<int>& travs, const
     return make_pair(most_frequent, conflict);
 }
     
-bool Deconstructor::deconstruct_site(const Snarl* snarl) {
+void Deconstructor::get_gbwt_genotypes(vcflib::Variant& v, const vector<vector<gbwt::size_type>>& trav_paths,
+                                       const vector<int>& trav_to_allele) {
+    assert(trav_paths.size() == trav_to_allele.size());
+    v.format.push_back("GT");
+
+    // the allele of every haplotype of every sample (-1 if the haplotype doesn't go through the site).
+    // if a haplotype goes through the site more than once, we take its first traversal
+    const gbwt::Metadata& metadata = gbwt->metadata;
+    vector<vector<int>> sample_alleles(gbwt_sample_ploidy.size());
+    for (size_t i = 0; i < gbwt_sample_ploidy.size(); ++i) {
+        sample_alleles[i].resize(gbwt_sample_ploidy[i], -1);
+    }
+    for (size_t i = 0; i < trav_paths.size(); ++i) {
+        for (gbwt::size_type path_id : trav_paths[i]) {
+            const gbwt::PathName& path_name = metadata.path(path_id);
+            int& allele = sample_alleles[path_name.sample][path_name.phase];
+            if (allele == -1) {
+                allele = trav_to_allele[i];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < sample_alleles.size(); ++i) {
+        if (sample_alleles[i].empty()) {
+            continue;
+        }
+        string genotype;
+        for (size_t j = 0; j < sample_alleles[i].size(); ++j) {
+            if (j > 0) {
+                genotype += "|";
+            }
+            genotype += sample_alleles[i][j] == -1 ? "." : std::to_string(sample_alleles[i][j]);
+        }
+        v.samples[metadata.sample(i)]["GT"] = {genotype};
+    }
+}
+
+bool Deconstructor::BufferedVariant::operator<(const BufferedVariant& other) const {
+    return std::tie(ref_path_rank, position, line) < std::tie(other.ref_path_rank, other.position, other.line);
+}
+
+pair<size_t, size_t> Deconstructor::get_snarl_sort_key(const Snarl* snarl) {
+    pair<size_t, size_t> key(numeric_limits<size_t>::max(), numeric_limits<size_t>::max());
+    for (id_t node_id : {snarl->start().node_id(), snarl->end().node_id()}) {
+        graph->for_each_step_on_handle(graph->get_handle(node_id), [&](const step_handle_t& step) {
+                auto rank = ref_path_ranks.find(graph->get_path_name(graph->get_path_handle_of_step(step)));
+                if (rank != ref_path_ranks.end()) {
+                    key = min(key, make_pair(rank->second, graph->get_position_of_step(step)));
+                }
+            });
+    }
+    return key;
+}
+
+bool Deconstructor::deconstruct_site(const Snarl* snarl, vector<BufferedVariant>& buffer) {
 
     auto contents = snarl_manager->shallow_contents(snarl, *graph, false);
     if (contents.first.empty()) {
@@ -254,8 +308,33 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
         return false;
     }
 
-    // add in the exhaustive traversals
-    if (!path_restricted) {
+    // the gbwt paths that take each traversal (empty for traversals that don't come from the gbwt)
+    vector<vector<gbwt::size_type>> trav_paths;
+
+    if (gbwt) {
+        // the haplotypes are our samples, so we only keep the reference traversals from the graph's paths
+        pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > ref_path_travs;
+        for (int i = 0; i < ref_travs.size(); ++i) {
+            ref_path_travs.first.push_back(std::move(path_travs.first[ref_travs[i]]));
+            ref_path_travs.second.push_back(path_travs.second[ref_travs[i]]);
+            ref_travs[i] = i;
+        }
+        path_travs = std::move(ref_path_travs);
+        path_trav_names.assign(ref_travs.size(), ref_trav_name);
+        trav_paths.resize(ref_travs.size());
+
+        // add in the haplotype traversals.  they're distinct from each other, but can still
+        // spell the same alleles, which get_alleles() sorts out
+        pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> gbwt_travs = gbwt_trav_finder->find_gbwt_traversals(*snarl);
+        for (int i = 0; i < gbwt_travs.first.size(); ++i) {
+            path_travs.first.push_back(std::move(gbwt_travs.first[i]));
+            // dummy names and handles so we can use the same code as the named path traversals above
+            path_trav_names.push_back(" >>" + std::to_string(i));
+            path_travs.second.push_back(make_pair(step_handle_t(), step_handle_t()));
+            trav_paths.push_back(std::move(gbwt_travs.second[i]));
+        }
+    } else if (!path_restricted) {
+        // add in the exhaustive traversals
         // exhaustive traversal can't do all snarls
         if (snarl->type() != ULTRABUBBLE) {
             return false;
@@ -334,16 +413,17 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
         vector<int> trav_to_allele = get_alleles(v, path_travs.first, ref_trav_idx, prev_char, use_start);
 
         // Fill in the genotypes
-        if (path_restricted) {
+        if (gbwt) {
+            get_gbwt_genotypes(v, trav_paths, trav_to_allele);
+        } else if (path_restricted) {
             get_genotypes(v, path_trav_names, trav_to_allele);
         }
 
         // we only bother printing out sites with at least 1 non-reference allele
         if (!std::all_of(trav_to_allele.begin(), trav_to_allele.end(), [](int i) { return i == 0; })) {
-#pragma omp critical (cout)
-            {
-                cout << v << endl;
-            }
+            stringstream line;
+            line << v;
+            buffer.push_back({ref_path_ranks.at(ref_trav_name), (size_t)v.position, line.str()});
         }
     }
     return true;
@@ -354,35 +434,58 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
  */
 void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHandleGraph* graph, SnarlManager* snarl_manager,
                                 bool path_restricted_traversals,
-                                const unordered_map<string, string>* path_to_sample) {
+                                const unordered_map<string, string>* path_to_sample,
+                                const gbwt::GBWT* gbwt) {
 
     this->graph = graph;
     this->snarl_manager = snarl_manager;
     this->path_restricted = path_restricted_traversals;
     this->path_to_sample = path_to_sample;
+    this->gbwt = gbwt;
     this->ref_paths = set<string>(ref_paths.begin(), ref_paths.end());
+    ref_path_ranks.clear();
+    for (auto& ref_path : ref_paths) {
+        ref_path_ranks.emplace(ref_path, ref_path_ranks.size());
+    }
     assert(path_to_sample == nullptr || path_restricted);
+    assert(path_to_sample == nullptr || gbwt == nullptr);
     
     // Keep track of the non-reference paths in the graph.  They'll be our sample names
+    // (unless we have a gbwt, in which case its samples are ours)
     sample_names.clear();
-    graph->for_each_path_handle([&](const path_handle_t& path_handle) {
-            string path_name = graph->get_path_name(path_handle);
-            if (!this->ref_paths.count(path_name)) {
-                // rely on the given map.  if a path isn't in it, it'll be ignored
-                if (path_to_sample && path_to_sample->count(path_name)) {
-                    sample_names.insert(path_to_sample->find(path_name)->second);
-                }
-                else {
-                    // no name mapping, just use every path as is
-                    sample_names.insert(path_name);
-                }
+    gbwt_sample_ploidy.clear();
+    if (gbwt) {
+        assert(gbwt->hasMetadata() && gbwt->metadata.hasSampleNames() && gbwt->metadata.hasPathNames());
+        gbwt_sample_ploidy.resize(gbwt->metadata.samples(), 0);
+        for (size_t i = 0; i < gbwt->metadata.paths(); ++i) {
+            const gbwt::PathName& path_name = gbwt->metadata.path(i);
+            gbwt_sample_ploidy[path_name.sample] = max(gbwt_sample_ploidy[path_name.sample], (size_t)path_name.phase + 1);
+        }
+        for (size_t i = 0; i < gbwt_sample_ploidy.size(); ++i) {
+            if (gbwt_sample_ploidy[i] > 0) {
+                sample_names.insert(gbwt->metadata.sample(i));
             }
-        });
+        }
+    } else {
+        graph->for_each_path_handle([&](const path_handle_t& path_handle) {
+                string path_name = graph->get_path_name(path_handle);
+                if (!this->ref_paths.count(path_name)) {
+                    // rely on the given map.  if a path isn't in it, it'll be ignored
+                    if (path_to_sample && path_to_sample->count(path_name)) {
+                        sample_names.insert(path_to_sample->find(path_name)->second);
+                    }
+                    else {
+                        // no name mapping, just use every path as is
+                        sample_names.insert(path_name);
+                    }
+                }
+            });
+    }
     
     // print the VCF header
     stringstream stream;
     stream << "##fileformat=VCFv4.2" << endl;
-    if (path_restricted) {
+    if (path_restricted || gbwt) {
         stream << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">" << endl;
     }
     if (path_to_sample) {
@@ -398,7 +501,7 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
         stream << "##contig=<ID=" << refpath << ",length=" << path_len << ">" << endl;
     }
     stream << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
-    if (path_restricted) {
+    if (path_restricted || gbwt) {
         for (auto& sample_name : sample_names) {
             stream << "\t" << sample_name;
         }
@@ -414,31 +517,77 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
     path_trav_finder = unique_ptr<PathTraversalFinder>(new PathTraversalFinder(*graph,
                                                                                *snarl_manager));
     
-    if (!path_restricted) {
+    if (gbwt) {
+        gbwt_trav_finder = unique_ptr<GBWTTraversalFinder>(new GBWTTraversalFinder(*graph,
+                                                                                   *snarl_manager,
+                                                                                   *gbwt));
+    } else if (!path_restricted) {
         trav_finder = unique_ptr<TraversalFinder>(new ExhaustiveTraversalFinder(*graph,
                                                                                 *snarl_manager,
                                                                                 true));
 
     }
     
-    // Do the top-level snarls in parallel
-    snarl_manager->for_each_top_level_snarl_parallel([&](const Snarl* snarl) {
-            vector<const Snarl*> todo(1, snarl);
-            vector<const Snarl*> next;
-            while (!todo.empty()) {
-                for (auto next_snarl : todo) {
-                    // if we can't make a variant from the snarl due to not finding
-                    // paths through it, we try again on the children
-                    // note: we may want to push the parallelism down a bit 
-                    if (!deconstruct_site(next_snarl)) {
-                        const vector<const Snarl*>& children = snarl_manager->children_of(next_snarl);
-                        next.insert(next.end(), children.begin(), children.end());
-                    }
+    // Order the top-level snarls along the reference paths, so we can write out their records
+    // in sorted order as we go
+    const vector<const Snarl*>& top_level_snarls = snarl_manager->top_level_snarls();
+    vector<pair<pair<size_t, size_t>, size_t>> snarl_order(top_level_snarls.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < top_level_snarls.size(); ++i) {
+        snarl_order[i] = make_pair(get_snarl_sort_key(top_level_snarls[i]), i);
+    }
+    std::sort(snarl_order.begin(), snarl_order.end());
+
+    // Records that we've made but can't write yet, because a later window might make
+    // records that sort before them
+    vector<BufferedVariant> pending;
+    vector<vector<BufferedVariant>> thread_buffers(get_thread_count());
+
+    for (size_t window_start = 0; window_start < snarl_order.size(); window_start += snarls_per_window) {
+        size_t window_end = min(window_start + snarls_per_window, snarl_order.size());
+
+        // Do the snarls in the window in parallel, a level of the snarl tree at a time. If we
+        // can't make a variant from a snarl due to not finding paths through it, we try again
+        // on its children in the next level.
+        vector<const Snarl*> todo;
+        for (size_t i = window_start; i < window_end; ++i) {
+            todo.push_back(top_level_snarls[snarl_order[i].second]);
+        }
+        vector<vector<const Snarl*>> thread_next(thread_buffers.size());
+        while (!todo.empty()) {
+#pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < todo.size(); ++i) {
+                size_t thread_num = omp_get_thread_num();
+                if (!deconstruct_site(todo[i], thread_buffers[thread_num])) {
+                    const vector<const Snarl*>& children = snarl_manager->children_of(todo[i]);
+                    thread_next[thread_num].insert(thread_next[thread_num].end(), children.begin(), children.end());
                 }
-                swap(todo, next);
+            }
+            todo.clear();
+            for (auto& next : thread_next) {
+                todo.insert(todo.end(), next.begin(), next.end());
                 next.clear();
             }
-        });
+        }
+
+        for (auto& buffer : thread_buffers) {
+            std::move(buffer.begin(), buffer.end(), back_inserter(pending));
+            buffer.clear();
+        }
+        std::sort(pending.begin(), pending.end());
+
+        // Nothing in the windows to come can sort before the next window's first snarl
+        pair<size_t, size_t> frontier(numeric_limits<size_t>::max(), numeric_limits<size_t>::max());
+        if (window_end < snarl_order.size()) {
+            frontier = snarl_order[window_end].first;
+        }
+        auto written = pending.begin();
+        while (written != pending.end() && make_pair(written->ref_path_rank, written->position) < frontier) {
+            cout << written->line << endl;
+            ++written;
+        }
+        pending.erase(pending.begin(), written);
+    }
 }
 
 bool Deconstructor::check_max_nodes(const Snarl* snarl)  {
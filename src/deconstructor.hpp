@@ -33,13 +33,27 @@ public:
     // deconstruct the entire graph to cout
     void deconstruct(vector<string> refpaths, const PathPositionHandleGraph* grpah, SnarlManager* snarl_manager,
                      bool path_restricted_traversals,
-                     const unordered_map<string, string>* path_to_sample = nullptr); 
+                     const unordered_map<string, string>* path_to_sample = nullptr,
+                     const gbwt::GBWT* gbwt = nullptr);
     
 private:
 
-    // write a vcf record for the given site.  returns true if a record was written
+    // a vcf record, along with the reference path rank and position we sort it by
+    struct BufferedVariant {
+        size_t ref_path_rank;
+        size_t position;
+        string line;
+        bool operator<(const BufferedVariant& other) const;
+    };
+
+    // write a vcf record for the given site to the buffer.  returns true if a record was written
     // (need to have a path going through the site)
-    bool deconstruct_site(const Snarl* site);
+    bool deconstruct_site(const Snarl* site, vector<BufferedVariant>& buffer);
+
+    // get the lowest (reference path rank, position) at which a reference path touches one of
+    // the snarl's boundary nodes. no variant from the snarl or its children can sort before it
+    // (unless a reference path starts inside the snarl).
+    pair<size_t, size_t> get_snarl_sort_key(const Snarl* snarl);
 
     // convert traversals to strings.  returns mapping of traversal (offset in travs) to allele
     vector<int> get_alleles(vcflib::Variant& v, const vector<SnarlTraversal>& travs, int ref_path_idx,
@@ -48,6 +62,10 @@ private:
     // write traversal path names as genotypes
     void get_genotypes(vcflib::Variant& v, const vector<string>& names, const vector<int>& trav_to_allele);
 
+    // write the phased genotypes of the gbwt haplotypes that take each traversal
+    void get_gbwt_genotypes(vcflib::Variant& v, const vector<vector<gbwt::size_type>>& trav_paths,
+                            const vector<int>& trav_to_allele);
+
     // given a set of traversals associated with a particular sample, select one for the VCF
     // the highest-frequency ALT traversal is chosen
     // the bool returned is true if multiple traversals map to different alleles.
@@ -78,10 +96,21 @@ private:
     unique_ptr<PathTraversalFinder> path_trav_finder;
     // we optionally use another (exhaustive for now) traversal finder if we don't want to rely on paths
     unique_ptr<TraversalFinder> trav_finder;
+    // or we take the traversals of the haplotypes in a gbwt
+    unique_ptr<GBWTTraversalFinder> gbwt_trav_finder;
+
+    // the gbwt, if we're using it for the samples
+    const gbwt::GBWT* gbwt = nullptr;
+
+    // the ploidy of each gbwt sample (indexed by sample number in the gbwt metadata)
+    vector<size_t> gbwt_sample_ploidy;
 
     // the ref paths
     set<string> ref_paths;
 
+    // the ref paths' ranks in the vcf header, for sorting the output
+    unordered_map<string, size_t> ref_path_ranks;
+
     // keep track of the non-ref paths as they will be our samples
     set<string> sample_names;
 
@@ -90,6 +119,9 @@ private:
 
     // upper limit of degree-2+ nodes for exhaustive traversal
     int max_nodes_for_exhaustive = 100;    
+
+    // number of top-level snarls to deconstruct at once before writing out their sorted records
+    size_t snarls_per_window = 4096;
 };
 
 }
@@ -67,13 +67,14 @@ pair<const Edge*, bool> AugmentedGraph::base_edge(const Edge* edge) {
     }
 
     // work in forward strand since translator doesn't seem strand-aware
+    const PathHandleGraph& augmented_graph = get_graph();
     from_pos.set_is_reverse(false);
     from_pos.set_offset(edge->from_start() ? 0 :
-                        graph.get_node(edge->from())->sequence().length() - 1);
+                        augmented_graph.get_length(augmented_graph.get_handle(edge->from())) - 1);
 
     to_pos.set_is_reverse(false);
     to_pos.set_offset(edge->to_end() == false ? 0 :
-                      graph.get_node(edge->to())->sequence().length() - 1);
+                      augmented_graph.get_length(augmented_graph.get_handle(edge->to())) - 1);
 
     // Map to the base graph using our translation table
     Position base_from_pos = translator.translate(from_pos);
@@ -119,6 +120,15 @@ pair<const Edge*, bool> AugmentedGraph::base_edge(const Edge* edge) {
     return pair<const Edge*, bool>(found_edge, is_trivial);
 }
 
+bool AugmentedGraph::is_novel_edge(const NodeSide& end1, const NodeSide& end2) {
+    Edge edge;
+    edge.set_from(end1.node);
+    edge.set_from_start(!end1.is_end);
+    edge.set_to(end2.node);
+    edge.set_to_end(end2.is_end);
+    return is_novel_edge(&edge);
+}
+
 vector<const Alignment*> AugmentedGraph::get_alignments(id_t node_id) const {
     if (alignments_by_node.count(node_id)) {
         auto& found = alignments_by_node.at(node_id);
@@ -302,14 +312,41 @@ void SupportAugmentedGraph::clear() {
 }
 
 bool SupportAugmentedGraph::has_supports() const {
-    return !node_supports.empty() || !edge_supports.empty();
+    return packer.get() != nullptr || !node_supports.empty() || !edge_supports.empty();
 }
 
 Support SupportAugmentedGraph::get_support(id_t node) {
+    if (packer.get() != nullptr) {
+        // Use the average coverage we worked out when loading
+        Support support;
+        if (node >= min_packed_id && (size_t)(node - min_packed_id) < packed_node_coverage.size()) {
+            // we just get one value and put it in "forward".  can't fill out the rest of the Support object. 
+            support.set_forward(packed_node_coverage[node - min_packed_id]);
+        }
+        return support;
+    }
     return node_supports.count(node) ? node_supports.at(node) : Support();
 }
 
 Support SupportAugmentedGraph::get_support(edge_t edge) {
+    if (packer.get() != nullptr) {
+        // Look up the edge's packed coverage, by the same ends it would have
+        // had in the edge support map.
+        Support support;
+        const PathHandleGraph& augmented_graph = get_graph();
+        edge = augmented_graph.edge_handle(edge.first, edge.second);
+        Edge packed_edge;
+        packed_edge.set_from(augmented_graph.get_id(edge.first));
+        packed_edge.set_from_start(augmented_graph.get_is_reverse(edge.first));
+        packed_edge.set_to(augmented_graph.get_id(edge.second));
+        packed_edge.set_to_end(augmented_graph.get_is_reverse(edge.second));
+        if (packed_graph->has_node(packed_edge.from()) && packed_graph->has_node(packed_edge.to()) &&
+            packed_graph->has_edge(packed_graph->get_handle(packed_edge.from(), packed_edge.from_start()),
+                                   packed_graph->get_handle(packed_edge.to(), packed_edge.to_end()))) {
+            support.set_forward(packer->edge_coverage(packed_edge));
+        }
+        return support;
+    }
     return edge_supports.count(edge) ? edge_supports.at(edge) : Support();
 }
 
@@ -335,35 +372,35 @@ void SupportAugmentedGraph::load_supports(istream& in_file) {
 }
 
 void SupportAugmentedGraph::load_pack_as_supports(const string& pack_file_name, const HandleGraph* vectorizable_graph) {
-    Packer packer(vectorizable_graph);
-    packer.load_from_file(pack_file_name);
-    vectorizable_graph->for_each_handle([&](const handle_t& handle) {
-            Position pos;
-            pos.set_node_id(vectorizable_graph->get_id(handle));
-            size_t sequence_offset = packer.position_in_basis(pos);
-            size_t total_coverage = 0;
-            size_t node_length = vectorizable_graph->get_length(handle);
-            for (size_t i = 0; i < node_length; ++i) {
-                total_coverage += packer.coverage_at_position(sequence_offset + i);
-            }
-            double avg_coverage = node_length > 0 ? (double)total_coverage / node_length : 0.;
-            Support support;
-            // we just get one value and put it in "forward".  can't fill out the rest of the Support object. 
-            support.set_forward(avg_coverage);
-            node_supports[vectorizable_graph->get_id(handle)] = support;
-        });
-    vectorizable_graph->for_each_edge([&](const edge_t& handle_edge) {
-            Edge edge;
-            edge.set_from(vectorizable_graph->get_id(handle_edge.first));
-            edge.set_from_start(vectorizable_graph->get_is_reverse(handle_edge.first));
-            edge.set_to(vectorizable_graph->get_id(handle_edge.second));
-            edge.set_to_end(vectorizable_graph->get_is_reverse(handle_edge.second));
-            Support support;
-            support.set_forward(packer.edge_coverage(edge));
-            edge_supports[graph.edge_handle(graph.get_handle(edge.from(), edge.from_start()),
-                                            graph.get_handle(edge.to(), edge.to_end()))] = support;
-            return true;
-        });
+    // Keep the compacted coverage around, and look supports up in it as we
+    // need them, instead of keeping a Support object for every node and edge.
+    node_supports.clear();
+    edge_supports.clear();
+    packer = make_shared<Packer>(vectorizable_graph);
+    packer->load_from_file(pack_file_name);
+    packed_graph = vectorizable_graph;
+
+    // Node supports get asked for over and over, so average each node's
+    // coverage once now.
+    packed_node_coverage.clear();
+    if (packed_graph->get_node_count() == 0) {
+        return;
+    }
+    min_packed_id = packed_graph->min_node_id();
+    packed_node_coverage.resize(packed_graph->max_node_id() - min_packed_id + 1, 0.);
+    packed_graph->for_each_handle([&](const handle_t& handle) {
+        Position pos;
+        pos.set_node_id(packed_graph->get_id(handle));
+        size_t sequence_offset = packer->position_in_basis(pos);
+        size_t node_length = packed_graph->get_length(handle);
+        size_t total_coverage = 0;
+        for (size_t i = 0; i < node_length; ++i) {
+            total_coverage += packer->coverage_at_position(sequence_offset + i);
+        }
+        if (node_length > 0) {
+            packed_node_coverage[pos.node_id() - min_packed_id] = (double)total_coverage / node_length;
+        }
+    });
 }
 
 void SupportAugmentedGraph::write_supports(ostream& out_file) {
@@ -587,6 +624,211 @@ double FixedGenotypePriorCalculator::calculate_log_prior(const Genotype& genotyp
     return all_same ? homozygous_prior_ln : heterozygous_prior_ln;
 }
 
+DenseGenotypeLikelihoodCalculator::DenseGenotypeLikelihoodCalculator(size_t allele_count) :
+    consistent_columns(allele_count), reverse_columns(allele_count) {
+    // Nothing to do
+}
+
+void DenseGenotypeLikelihoodCalculator::add_read(const vector<bool>& consistent, const vector<bool>& is_reverse,
+                                                 double read_logprob_wrong) {
+    for (size_t i = 0; i < consistent_columns.size(); i++) {
+        // Fill in this read's row, one allele column at a time
+        consistent_columns[i].push_back(i < consistent.size() && consistent[i]);
+        reverse_columns[i].push_back(i < is_reverse.size() && is_reverse[i]);
+    }
+    empty_column.push_back(0);
+    logprob_wrong.push_back(read_logprob_wrong);
+    known_alleles.push_back(consistent.size());
+}
+
+size_t DenseGenotypeLikelihoodCalculator::read_count() const {
+    return logprob_wrong.size();
+}
+
+const vector<uint8_t>& DenseGenotypeLikelihoodCalculator::consistent_column(int allele) const {
+    return (allele >= 0 && (size_t) allele < consistent_columns.size()) ? consistent_columns[allele] : empty_column;
+}
+
+const vector<uint8_t>& DenseGenotypeLikelihoodCalculator::reverse_column(int allele) const {
+    return (allele >= 0 && (size_t) allele < reverse_columns.size()) ? reverse_columns[allele] : empty_column;
+}
+
+double DenseGenotypeLikelihoodCalculator::calculate_log_likelihood(const vector<int>& genotype) const {
+    size_t reads = logprob_wrong.size();
+
+    // Get the distinct alleles in the genotype, in order.
+    vector<int> unique_alleles(genotype);
+    sort(unique_alleles.begin(), unique_alleles.end());
+    unique_alleles.erase(unique(unique_alleles.begin(), unique_alleles.end()), unique_alleles.end());
+    
+    // This is the log probability that all reads that don't support either allele in this genotype are wrong.
+    double all_non_supporting_wrong = prob_to_logprob(1);
+
+    // This is the log probability that all the reads that do support alleles in this genotype were drawn from the genotype they support.
+    double all_supporting_drawn = prob_to_logprob(1);
+    
+    // Forward and reverse counts, by unique allele, of reads that support
+    // exactly one of the genotype's alleles.
+    vector<pair<int, int>> strand_counts(unique_alleles.size(), make_pair(0, 0));
+    
+    // For diploid hets, count the reads supporting only the first allele,
+    // only the second allele, and both. Reads that don't have consistency
+    // flags for both alleles are uninformative and don't count here.
+    int only_first_unique = 0;
+    int only_second_unique = 0;
+    int both_unique = 0;
+    
+    if (unique_alleles.size() == 1) {
+        // Homozygous or haploid. Only one column to look at.
+        const uint8_t* consistent = consistent_column(unique_alleles[0]).data();
+        const uint8_t* reverse = reverse_column(unique_alleles[0]).data();
+        int forward_count = 0;
+        int reverse_count = 0;
+        for (size_t i = 0; i < reads; i++) {
+            forward_count += consistent[i] & !reverse[i];
+            reverse_count += consistent[i] & reverse[i];
+            all_non_supporting_wrong += consistent[i] ? 0.0 : logprob_wrong[i];
+        }
+        strand_counts[0] = make_pair(forward_count, reverse_count);
+    } else if (unique_alleles.size() == 2) {
+        // Two distinct alleles. Look at both columns together.
+        const uint8_t* first_consistent = consistent_column(unique_alleles[0]).data();
+        const uint8_t* first_reverse = reverse_column(unique_alleles[0]).data();
+        const uint8_t* second_consistent = consistent_column(unique_alleles[1]).data();
+        const uint8_t* second_reverse = reverse_column(unique_alleles[1]).data();
+        // Alleles are sorted, so the second one is the one a read needs to
+        // know about to be informative.
+        size_t needed_alleles = unique_alleles[1] + 1;
+        for (size_t i = 0; i < reads; i++) {
+            uint8_t only_first = first_consistent[i] & !second_consistent[i];
+            uint8_t only_second = second_consistent[i] & !first_consistent[i];
+            uint8_t informative = known_alleles[i] >= needed_alleles;
+            strand_counts[0].first += only_first & !first_reverse[i];
+            strand_counts[0].second += only_first & first_reverse[i];
+            strand_counts[1].first += only_second & !second_reverse[i];
+            strand_counts[1].second += only_second & second_reverse[i];
+            only_first_unique += only_first & informative;
+            only_second_unique += only_second & informative;
+            both_unique += first_consistent[i] & second_consistent[i];
+            all_non_supporting_wrong += (first_consistent[i] | second_consistent[i]) ? 0.0 : logprob_wrong[i];
+        }
+    } else {
+        // No alleles or more than two. Go read by read over all the columns.
+        for (size_t i = 0; i < reads; i++) {
+            int consistent_alleles = 0;
+            size_t last_consistent = 0;
+            for (size_t j = 0; j < unique_alleles.size(); j++) {
+                if (consistent_column(unique_alleles[j])[i]) {
+                    consistent_alleles++;
+                    last_consistent = j;
+                }
+            }
+            if (consistent_alleles == 0) {
+                all_non_supporting_wrong += logprob_wrong[i];
+            } else if (consistent_alleles == 1) {
+                if (reverse_column(unique_alleles[last_consistent])[i]) {
+                    strand_counts[last_consistent].second++;
+                } else {
+                    strand_counts[last_consistent].first++;
+                }
+            }
+        }
+    }
+    
+    // Multiply in in the probability that the supporting reads all came from
+    // the strands they are on.
+    double strands_as_specified = prob_to_logprob(1);
+    // Each strand is equally likely
+    vector<double> probs_by_orientation = {0.5, 0.5};
+    for (auto& counts : strand_counts) {
+        if (counts.first == 0 && counts.second == 0) {
+            // No reads uniquely support this allele.
+            continue;
+        }
+        vector<int> obs = {counts.first, counts.second};
+        strands_as_specified += multinomial_sampling_prob_ln(probs_by_orientation, obs);
+    }
+    
+    // Multiply in probability that the reads came from alleles they support,
+    // treating reads as indistinguishable and using a multinomial/binomial
+    // model.
+    double alleles_as_specified = prob_to_logprob(1);
+    if (genotype.size() == 2 && genotype.at(0) != genotype.at(1)) {
+        // For diploid heterozygotes, handle multi-support as censorship.
+        
+        // Work out how many reads support the genotype's first allele only.
+        int first_only_reads = genotype.at(0) == unique_alleles[0] ? only_first_unique : only_second_unique;
+        // And how many support both
+        int ambiguous_reads = both_unique;
+        // And how many total reads there are (# of trials).
+        int total_reads = only_first_unique + only_second_unique + both_unique;
+        
+        // Each atom is weighted by the same factor for assigning all the reads
+        // at 50% probability.
+        double log_atom_weight = prob_to_logprob(0.5) * total_reads;
+        
+        vector<double> weighted_atom_logprobs;
+        for (int i = first_only_reads; i <= first_only_reads + ambiguous_reads; i++) {
+            weighted_atom_logprobs.push_back(choose_ln(total_reads, i) + log_atom_weight);
+        }
+        
+        alleles_as_specified = logprob_sum(weighted_atom_logprobs);
+    } else if (genotype.size() > 2) {
+        // Use a censored multinomial over the distinct alleles, weighted by how
+        // many times they occur in the genotype.
+        double per_allele_prob = 1.0/genotype.size();
+        vector<double> probs(unique_alleles.size(), 0.0);
+        for (auto& allele : genotype) {
+            probs[lower_bound(unique_alleles.begin(), unique_alleles.end(), allele) - unique_alleles.begin()] += per_allele_prob;
+        }
+        
+        // Assign reads to ambiguity classes and count them.
+        unordered_map<vector<bool>, int> reads_by_class;
+        for (size_t i = 0; i < reads; i++) {
+            vector<bool> ambiguity_class;
+            for (auto& allele : unique_alleles) {
+                ambiguity_class.push_back(consistent_column(allele)[i]);
+            }
+            reads_by_class[ambiguity_class]++;
+        }
+        
+        alleles_as_specified = multinomial_censored_sampling_prob_ln(probs, reads_by_class);
+    }
+    
+    // Now we've looked at all the reads, so AND everything together
+    return all_non_supporting_wrong + all_supporting_drawn + strands_as_specified + alleles_as_specified;
+}
+
+double DenseGenotypeLikelihoodCalculator::calculate_log_likelihood(const Snarl& site,
+    const vector<SnarlTraversal>& traversals, const Genotype& genotype,
+    const vector<vector<bool>>& consistencies, const vector<Support>& supports,
+    const vector<Alignment*>& reads) {
+    
+    DenseGenotypeLikelihoodCalculator site_calculator(traversals.size());
+    for (size_t i = 0; i < reads.size() && i < consistencies.size(); i++) {
+        const Alignment& read = *reads[i];
+        
+        // Work out the strand from the first visit to either end of the site.
+        bool read_is_reverse = false;
+        for (auto& mapping : read.path().mapping()) {
+            const Position& pos = mapping.position();
+            if (pos.node_id() == site.start().node_id()) {
+                read_is_reverse = pos.is_reverse() != site.start().backward();
+                break;
+            } else if (pos.node_id() == site.end().node_id()) {
+                read_is_reverse = pos.is_reverse() != site.end().backward();
+                break;
+            }
+        }
+        
+        site_calculator.add_read(consistencies[i], vector<bool>(consistencies[i].size(), read_is_reverse),
+                                 phred_to_logprob(read.mapping_quality()));
+    }
+    
+    vector<int> alleles(genotype.allele().begin(), genotype.allele().end());
+    return site_calculator.calculate_log_likelihood(alleles);
+}
+
 
 Support make_support(double forward, double reverse, double quality) {
     Support to_return;
@@ -157,6 +157,10 @@ struct AugmentedGraph {
     /// This holds all the new nodes and edges
     VG graph;
 
+    /// If set, this graph is used in place of the VG above, which is then left
+    /// empty. It is not owned, and must outlive this object.
+    const PathHandleGraph* handle_graph = nullptr;
+
     /// This holds the base graph (only required for mapping edges)
     VG* base_graph = nullptr;
 
@@ -172,17 +176,31 @@ struct AugmentedGraph {
     pair<const Edge*, bool> base_edge(const Edge* augmented_edge);
 
     // Is this node novel?  ie does it not map back to the base graph?
-    bool is_novel_node(const Node* augmented_node) {
+    bool is_novel_node(id_t augmented_node_id) {
         Position pos;
-        pos.set_node_id(augmented_node->id());
+        pos.set_node_id(augmented_node_id);
         return !translator.has_translation(pos);
     }
+    bool is_novel_node(const Node* augmented_node) {
+        return is_novel_node(augmented_node->id());
+    }
     
     // Is this edge novel?  ie does it not map back to the base graph?
     bool is_novel_edge(const Edge* augmented_edge) {
         auto be_ret = base_edge(augmented_edge);
         return be_ret.first == NULL && be_ret.second == false;
     }
+    // Or the edge between these two sides
+    bool is_novel_edge(const NodeSide& end1, const NodeSide& end2);
+
+    /// Get the graph to work on: handle_graph if it is set, and the VG
+    /// otherwise.
+    const PathHandleGraph& get_graph() const {
+        if (handle_graph != nullptr) {
+            return *handle_graph;
+        }
+        return graph;
+    }
 
     // Do we have a base graph in order to run the above methods?
     bool has_base_graph() const {
@@ -302,6 +320,12 @@ struct SupportAugmentedGraph : public AugmentedGraph {
      * Read the suppors from output of vg pack
      * Everything put in forward support, average used for nodes
      * Graph must implement VectorizableHandleGraph
+     *
+     * Supports are not copied into the maps above. Average node coverages are
+     * kept in a vector by node ID, and edge coverage is looked up in the
+     * compacted pack when asked for. So the graph must have the same nodes and
+     * edges as the augmented graph (and can be set as its handle_graph), and
+     * must outlive this object.
      */
     void load_pack_as_supports(const string& pack_file_name, const HandleGraph* vectorizable_graph);
 
@@ -310,6 +334,15 @@ struct SupportAugmentedGraph : public AugmentedGraph {
      */
     void write_supports(ostream& out_file);
     
+protected:
+    /// If the supports come from a pack file, this holds its coverage
+    shared_ptr<Packer> packer;
+    /// And this is the graph it is relative to
+    const HandleGraph* packed_graph = nullptr;
+    /// Average coverage of each node in the packed graph, by node ID minus
+    /// min_packed_id, so we don't rescan the node's bases on every lookup.
+    vector<double> packed_node_coverage;
+    id_t min_packed_id = 0;
 };
 
 
@@ -337,6 +370,81 @@ public:
 };
 
 
+/**
+ * This genotype likelihood calculator packs the reads at a site into a dense
+ * reads by alleles matrix of consistency and strand flags once, along with
+ * each read's probability of being mismapped or miscalled, and then scores
+ * each candidate genotype with a branch-free pass over just the columns for
+ * the genotype's alleles. Per-read work that doesn't depend on the genotype is
+ * done only once per site.
+ *
+ * The likelihood of a genotype is the probability that all the reads
+ * consistent with none of its alleles are wrong, times the probability of the
+ * strands that reads supporting exactly one allele were observed on, times the
+ * probability of the reads being apportioned across the alleles as observed,
+ * treating reads consistent with several alleles as censored.
+ */
+class DenseGenotypeLikelihoodCalculator : public GenotypeLikelihoodCalculator {
+public:
+    /// Make a calculator for a site with the given number of alleles.
+    DenseGenotypeLikelihoodCalculator(size_t allele_count);
+    
+    virtual ~DenseGenotypeLikelihoodCalculator() = default;
+    
+    /**
+     * Add a read to the matrix. Takes flags for whether the read is consistent
+     * with each allele, and whether it is on the reverse strand of each allele,
+     * and the log probability that the read is wrong if it is consistent with
+     * none of the alleles in the genotype. Alleles past the end of the flag
+     * vectors are taken to be inconsistent with the read, and the read is left
+     * out when apportioning reads between the alleles of a diploid het that
+     * uses any of them.
+     */
+    void add_read(const vector<bool>& consistent, const vector<bool>& is_reverse, double logprob_wrong);
+    
+    /// Get the number of reads in the matrix.
+    size_t read_count() const;
+    
+    /**
+     * Return the log likelihood of the reads given the genotype, as a list of
+     * allele numbers.
+     */
+    double calculate_log_likelihood(const vector<int>& genotype) const;
+    
+    /**
+     * Return the log likelihood of the given genotype, given the consistency
+     * of each of the given reads with each of the traversals. Reads are
+     * scored in a fresh matrix, not the one built with add_read(). A read is
+     * wrong with the probability given by its mapping quality, and is on the
+     * reverse strand if it visits the site's start or end backward.
+     */
+    virtual double calculate_log_likelihood(const Snarl& site,
+        const vector<SnarlTraversal>& traversals, const Genotype& genotype,
+        const vector<vector<bool>>& consistencies, const vector<Support>& supports,
+        const vector<Alignment*>& reads);
+        
+protected:
+    /// For each allele, whether each read is consistent with it
+    vector<vector<uint8_t>> consistent_columns;
+    /// For each allele, whether each read is on its reverse strand
+    vector<vector<uint8_t>> reverse_columns;
+    /// For each read, the log probability that it is wrong
+    vector<double> logprob_wrong;
+    /// For each read, the number of alleles it has consistency flags for
+    vector<size_t> known_alleles;
+    /// A column of all zeroes, for alleles we don't have
+    vector<uint8_t> empty_column;
+    
+    /// Get the column of consistency flags for an allele, or an empty one if
+    /// we don't have the allele.
+    const vector<uint8_t>& consistent_column(int allele) const;
+    
+    /// Get the column of strand flags for an allele, or an empty one if we
+    /// don't have the allele.
+    const vector<uint8_t>& reverse_column(int allele) const;
+};
+
+
 class SimpleTraversalSupportCalculator : public TraversalSupportCalculator{
     // A set of traversals through the site
     // A set of alignments to the site
@@ -137,126 +137,16 @@ void Genotyper::run(AugmentedGraph& augmented_graph,
     manager.for_each_snarl_parallel([&](const Snarl* snarl) {
         // For each snarl in parallel
 
-        if (snarl->type() != ULTRABUBBLE) {
-            // We only work on ultrabubbles right now
-            cerr << "Skip snarl " << snarl->start() << " - " << snarl->end() << " due to not being an ultrabubble" << endl;
-            return;
-        }
-
-        // Get the contents
-        pair<unordered_set<id_t>, unordered_set<edge_t> > snarl_contents =
-           manager.deep_contents(snarl, graph, true);
-
-        // Test if the snarl can be longer than the reads
-        bool read_bounded = is_snarl_smaller_than_reads(augmented_graph, snarl, snarl_contents, reads_by_name);
-        TraversalAlg use_traversal_alg = traversal_alg;
-        if (traversal_alg == TraversalAlg::Adaptive) {
-            use_traversal_alg = read_bounded ? TraversalAlg::Reads : TraversalAlg::Representative;
-        }
-
-        if (use_traversal_alg == TraversalAlg::Exhaustive &&
-            !manager.is_leaf(snarl)) {
-            // The SupportRestrictedTraversalFinder we use in Exhaustive mode
-            // can only handle leaf snarls.
-
-            // Todo : support nesting hierarchy!
-            if (show_progress) {
-                cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
-                    << " because it isn't a leaf and traversal algorithm "
-                    << alg2name[use_traversal_alg] << " only works on leaves" << endl;
-            }
-            return;
-        }
-
-        if (use_traversal_alg == TraversalAlg::Representative && !manager.all_children_trivial(snarl, graph)) {
-            // The RepresentativeTraversalFinder works for root and leaf
-            // snarls, but unless we're in a leaf snarl, or a snarl with only
-            // trivial children, it outputs traversals with child snarls in
-            // them that the rest of genotype can't yet handle.
-
-            // Todo : support nesting hierarchy!
-            if (show_progress) {
-                cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
-                    << " because it has nontrivial children and traversal algorithm "
-                    << alg2name[use_traversal_alg] << " will produce nested child snarl traversals" << endl;
-            }
-            return;
-        }
-
-
-        if (use_traversal_alg == TraversalAlg::Reads && !manager.is_root(snarl)) {
-            // The ReadRestrictedTraversalFinder only works for root snarls.
-            // TODO: How do we know this?
-            
-            // Todo : support nesting hierarchy!
-            if (show_progress) {
-                cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
-                    << " because it isn't a root and traversal algorithm "
-                    << alg2name[use_traversal_alg] << " only works on roots" << endl;
-            }
-            return;
-        }
-        
-        // Report the snarl to our statistics code
-        report_snarl(snarl, manager, reference_index, graph, reference_index);
-
         int tid = omp_get_thread_num();
 
-        // Get the traverals
-        vector<SnarlTraversal> paths = get_snarl_traversals(augmented_graph, manager, reads_by_name,
-                                                            snarl, snarl_contents, reference_index,
-                                                            use_traversal_alg);
-
-        if(paths.empty()) {
-            // Don't do anything for ultrabubbles with no routes through
-            if(show_progress) {
-#pragma omp critical (cerr)
-                cerr << "Snarl " << snarl->start() << " - " << snarl->end() << " has " << paths.size() <<
-                    " alleles: skipped for having no alleles" << endl;
-            }
+        // Get a genotyped locus in the original frame
+        Locus genotyped;
+        pair<unordered_set<id_t>, unordered_set<edge_t> > snarl_contents;
+        if (!call_snarl(augmented_graph, manager, snarl, reads_by_name, reference_index,
+                        genotyped, snarl_contents, total_affinities)) {
             return;
         }
 
-        if(show_progress) {
-#pragma omp critical (cerr)
-            cerr << "Snarl " << snarl->start() << " - " << snarl->end() << " has " << paths.size() << " alleles" << endl;
-            for(auto& path : paths) {
-                // Announce each allele in turn
-#pragma omp critical (cerr)
-                cerr << "\t" << traversal_to_string(graph, path) << endl;
-            }
-        }
-
-        // Compute the lengths of all the alleles
-        set<size_t> allele_lengths;
-        for(auto& path : paths) {
-            allele_lengths.insert(traversal_to_string(graph, path).size());
-        }
-
-        // Get the affinities for all the paths
-        map<const Alignment*, vector<Genotyper::Affinity>> affinities;
-
-        if(allele_lengths.size() > 1 && (realign_indels || !read_bounded)) {
-            // This is an indel, because we can change lengths. Use the slow route to do indel realignment.
-            affinities = get_affinities(augmented_graph, reads_by_name, snarl, snarl_contents, manager, paths);
-        } else {
-            // Just use string comparison. Don't re-align when
-            // length can't change, or when indle realignment is
-            // off.
-            affinities = get_affinities_fast(augmented_graph, reads_by_name, snarl, snarl_contents, manager, paths);
-        }
-
-        if(show_progress) {
-            report_affinities(affinities, paths, graph);
-            for(auto& alignment_and_affinities : affinities) {
-#pragma omp critical (total_affinities)
-                total_affinities += alignment_and_affinities.second.size();
-            }
-        }
-        
-        // Get a genotyped locus in the original frame
-        Locus genotyped = genotype_snarl(graph, snarl, paths, affinities);
-
         if (output_vcf) {
             // Get 0 or more variants from the ultrabubble
             vector<vcflib::Variant> variants =
@@ -328,6 +218,425 @@ void Genotyper::run(AugmentedGraph& augmented_graph,
 }
 
 
+/// Check if a snarl is of a type we can genotype, and say so if it isn't.
+static bool is_callable(const Snarl* snarl) {
+    if (snarl->type() != ULTRABUBBLE) {
+        // We only work on ultrabubbles right now
+#pragma omp critical (cerr)
+        cerr << "Skip snarl " << snarl->start() << " - " << snarl->end() << " due to not being an ultrabubble" << endl;
+        return false;
+    }
+    return true;
+}
+
+void Genotyper::run_indexed(VG& graph,
+                            const GAMIndex& gam_index,
+                            const string& gam_file_name,
+                            ostream& out,
+                            string ref_path_name,
+                            string contig_name,
+                            string sample_name,
+                            bool output_vcf,
+                            bool output_json,
+                            int length_override,
+                            int variant_offset) {
+
+    normal_aligners.resize(get_thread_count());
+    quality_aligners.resize(get_thread_count());
+
+    if(output_vcf && show_progress) {
+#pragma omp critical (cerr)
+        cerr << "Calling against path " << ref_path_name << endl;
+    }
+
+    if(sample_name.empty()) {
+        // Set a default sample name
+        sample_name = "SAMPLE";
+    }
+
+    // Make sure that we actually have an index for traversing along paths.
+    graph.paths.rebuild_mapping_aux();
+
+    SnarlManager manager = CactusSnarlFinder(graph, ref_path_name).find_snarls();
+
+    // If we're doing VCF output we need a VCF header
+    vcflib::VariantCallFile* vcf = nullptr;
+    // And a reference index tracking the primary path, which we also use to
+    // put the snarls in order
+    PathIndex* reference_index = nullptr;
+    if(output_vcf || graph.paths.has_path(ref_path_name)) {
+        reference_index = new PathIndex(graph, ref_path_name, true);
+    }
+    if(output_vcf) {
+        vcf = start_vcf(out, *reference_index, sample_name, contig_name, length_override);
+    }
+
+    // Order the snarls by where they start on the reference. Snarls that
+    // aren't on it go at the end.
+    vector<const Snarl*> snarls;
+    manager.for_each_snarl_preorder([&](const Snarl* snarl) {
+        snarls.push_back(snarl);
+    });
+    vector<pair<size_t, size_t>> snarl_order(snarls.size());
+    for (size_t i = 0; i < snarls.size(); ++i) {
+        size_t ref_start = numeric_limits<size_t>::max();
+        if (reference_index != nullptr) {
+            for (id_t node_id : {snarls[i]->start().node_id(), snarls[i]->end().node_id()}) {
+                auto found = reference_index->by_id.find(node_id);
+                if (found != reference_index->by_id.end()) {
+                    ref_start = min(ref_start, found->second.first);
+                }
+            }
+        }
+        snarl_order[i] = make_pair(ref_start, i);
+    }
+    std::sort(snarl_order.begin(), snarl_order.end());
+
+    if(show_progress) {
+#pragma omp critical (cerr)
+        cerr << "Found " << snarls.size() << " snarls" << endl;
+    }
+
+    // Each thread needs its own cursor on the GAM to look up reads with
+    int thread_count = get_thread_count();
+    vector<unique_ptr<ifstream>> gam_streams(thread_count);
+    vector<unique_ptr<vg::io::ProtobufIterator<Alignment>>> gam_cursors(thread_count);
+    vector<unique_ptr<GAMIndexSession>> gam_sessions(thread_count);
+    for (int i = 0; i < thread_count; ++i) {
+        gam_streams[i] = unique_ptr<ifstream>(new ifstream(gam_file_name));
+        if (!*gam_streams[i]) {
+            cerr << "error:[vg genotype] Unable to open sorted GAM " << gam_file_name << endl;
+            exit(1);
+        }
+        gam_cursors[i] = unique_ptr<vg::io::ProtobufIterator<Alignment>>(
+            new vg::io::ProtobufIterator<Alignment>(*gam_streams[i]));
+        gam_sessions[i] = unique_ptr<GAMIndexSession>(new GAMIndexSession(gam_index, *gam_cursors[i]));
+    }
+
+    // We're going to count up all the affinities and reads we use
+    size_t total_affinities = 0;
+    size_t total_reads = 0;
+
+    // Variants we've made but can't write yet, because a later window might
+    // make variants that come before them
+    vector<pair<int64_t, string>> pending_variants;
+
+    for (size_t window_start = 0; window_start < snarl_order.size(); window_start += snarls_per_window) {
+        size_t window_end = min(window_start + snarls_per_window, snarl_order.size());
+
+        // Each snarl in the window gets a slot for its output, so we can write
+        // it out in order
+        vector<vector<pair<int64_t, string>>> window_variants(window_end - window_start);
+        vector<Locus> window_loci(window_end - window_start);
+        vector<bool> window_called(window_end - window_start, false);
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = window_start; i < window_end; ++i) {
+            const Snarl* snarl = snarls[snarl_order[i].second];
+            if (!is_callable(snarl)) {
+                // Don't bother fetching reads for a snarl call_snarl() would skip
+                continue;
+            }
+            int tid = omp_get_thread_num();
+
+            // Fetch just the reads that touch the snarl, and that are entirely in the graph
+            unordered_set<id_t> snarl_nodes = manager.deep_contents(snarl, graph, true).first;
+            vector<pair<id_t, id_t>> ranges;
+            ranges.reserve(snarl_nodes.size());
+            for (id_t node_id : snarl_nodes) {
+                ranges.emplace_back(node_id, node_id);
+            }
+            GAMIndexSession::coalesce(ranges);
+            vector<Alignment> reads;
+            gam_sessions[tid]->find(ranges, [&](const Alignment& alignment) {
+                for (size_t j = 0; j < alignment.path().mapping_size(); j++) {
+                    if (!graph.has_node(alignment.path().mapping(j).position().node_id())) {
+                        return;
+                    }
+                }
+                if (alignment.path().mapping_size() > 0) {
+                    reads.push_back(alignment);
+                }
+            });
+            if (show_progress) {
+#pragma omp critical (total_reads)
+                total_reads += reads.size();
+            }
+
+            // Genotype against just the part of the graph the snarl and its reads use
+            AugmentedGraph snarl_graph;
+            make_snarl_augmented_graph(graph, snarl_nodes, reads, snarl_graph);
+            map<string, const Alignment*> reads_by_name;
+            for (const Alignment* alignment : snarl_graph.get_alignments()) {
+                reads_by_name[alignment->name()] = alignment;
+            }
+
+            Locus& genotyped = window_loci[i - window_start];
+            pair<unordered_set<id_t>, unordered_set<edge_t> > snarl_contents;
+            if (!call_snarl(snarl_graph, manager, snarl, reads_by_name, reference_index,
+                            genotyped, snarl_contents, total_affinities)) {
+                continue;
+            }
+            window_called[i - window_start] = true;
+
+            if (output_vcf) {
+                // Get 0 or more variants from the ultrabubble
+                vector<vcflib::Variant> variants =
+                    locus_to_variant(snarl_graph.graph, snarl, snarl_contents, manager, *reference_index,
+                                     *vcf, genotyped, sample_name);
+                for(auto& variant : variants) {
+                    variant.sequenceName = contig_name.empty() ? ref_path_name : contig_name;
+                    variant.position += variant_offset;
+                    stringstream line;
+                    line << variant;
+                    window_variants[i - window_start].emplace_back(variant.position, line.str());
+                }
+            } else {
+                // record a consistent name based on the start and end position of the first allele
+                stringstream name;
+                if (genotyped.allele_size() && genotyped.allele(0).mapping_size()) {
+                    name << make_pos_t(genotyped.allele(0).mapping(0).position())
+                         << "_"
+                         << make_pos_t(genotyped
+                                       .allele(0)
+                                       .mapping(genotyped.allele(0).mapping_size()-1)
+                                       .position());
+                }
+                genotyped.set_name(name.str());
+            }
+        }
+
+        if (output_vcf) {
+            for (auto& variants : window_variants) {
+                std::move(variants.begin(), variants.end(), back_inserter(pending_variants));
+            }
+            std::stable_sort(pending_variants.begin(), pending_variants.end(),
+                             [](const pair<int64_t, string>& a, const pair<int64_t, string>& b) {
+                                 return a.first < b.first;
+                             });
+            // Nothing in the windows to come can start at or before the next
+            // window's first snarl's start node, and snarls not on the
+            // reference can't make variants at all
+            bool flush_all = window_end == snarl_order.size() ||
+                snarl_order[window_end].first == numeric_limits<size_t>::max();
+            auto written = pending_variants.begin();
+            while (written != pending_variants.end() &&
+                   (flush_all || written->first <= (int64_t)snarl_order[window_end].first + variant_offset)) {
+                out << written->second << endl;
+                ++written;
+            }
+            pending_variants.erase(pending_variants.begin(), written);
+        } else {
+            vector<Locus> buffer;
+            for (size_t j = 0; j < window_loci.size(); ++j) {
+                if (!window_called[j]) {
+                    continue;
+                }
+                if (output_json) {
+                    out << pb2json(window_loci[j]) << endl;
+                } else {
+                    buffer.push_back(std::move(window_loci[j]));
+                    vg::io::write_buffered(out, buffer, 100);
+                }
+            }
+            vg::io::write_buffered(out, buffer, 0);
+        }
+    }
+
+    if(show_progress) {
+#pragma omp critical (cerr)
+        cerr << "Used " << total_reads << " reads and computed " << total_affinities << " affinities" << endl;
+    }
+
+    // Dump statistics before the snarls go away, so the pointers won't be dangling
+    print_statistics(cerr);
+
+    delete vcf;
+    delete reference_index;
+}
+
+void Genotyper::make_snarl_augmented_graph(VG& graph, const unordered_set<id_t>& snarl_nodes,
+                                           vector<Alignment>& reads, AugmentedGraph& out) {
+    // Take the nodes of the snarl and everything its reads visit
+    unordered_set<id_t> node_ids = snarl_nodes;
+    for (auto& read : reads) {
+        for (size_t i = 0; i < read.path().mapping_size(); i++) {
+            node_ids.insert(read.path().mapping(i).position().node_id());
+        }
+    }
+
+    // Copy them and the edges between them over, only reading from the full
+    // graph, since other threads are using it too
+    VG& subgraph = out.graph;
+    for (id_t node_id : node_ids) {
+        subgraph.create_handle(graph.get_sequence(graph.get_handle(node_id)), node_id);
+    }
+    for (id_t node_id : node_ids) {
+        handle_t handle = graph.get_handle(node_id);
+        graph.follow_edges(handle, false, [&](const handle_t& next) {
+            if (node_ids.count(graph.get_id(next))) {
+                handle_t left = subgraph.get_handle(node_id, false);
+                handle_t right = subgraph.get_handle(graph.get_id(next), graph.get_is_reverse(next));
+                if (!subgraph.has_edge(left, right)) {
+                    subgraph.create_edge(left, right);
+                }
+            }
+        });
+        graph.follow_edges(handle, true, [&](const handle_t& prev) {
+            if (node_ids.count(graph.get_id(prev))) {
+                handle_t left = subgraph.get_handle(graph.get_id(prev), graph.get_is_reverse(prev));
+                handle_t right = subgraph.get_handle(node_id, false);
+                if (!subgraph.has_edge(left, right)) {
+                    subgraph.create_edge(left, right);
+                }
+            }
+        });
+    }
+
+    // Bring along the embedded paths (the reference in particular) so
+    // path-based traversal finding still works
+    const Paths& paths = graph.paths;
+    for (id_t node_id : node_ids) {
+        if (graph.paths.has_node_mapping(node_id)) {
+            for (auto& path : paths.get_node_mapping(node_id)) {
+                auto& path_name = paths.get_path_name(path.first);
+                for (auto& m : path.second) {
+                    subgraph.paths.append_mapping(path_name, *m);
+                }
+            }
+        }
+    }
+    subgraph.paths.sort_by_mapping_rank();
+    subgraph.paths.rebuild_mapping_aux();
+    subgraph.paths.to_graph(subgraph.graph);
+
+    // The reads are already embedded in the graph, so they can't augment it
+    out.augment_from_alignment_edits(reads, true, true);
+}
+
+bool Genotyper::call_snarl(AugmentedGraph& augmented_graph, SnarlManager& manager, const Snarl* snarl,
+                           map<string, const Alignment*>& reads_by_name, PathIndex* reference_index,
+                           Locus& genotyped, pair<unordered_set<id_t>, unordered_set<edge_t> >& snarl_contents,
+                           size_t& total_affinities) {
+
+    VG& graph = augmented_graph.graph;
+
+    if (!is_callable(snarl)) {
+        return false;
+    }
+
+    // Get the contents
+    snarl_contents = manager.deep_contents(snarl, graph, true);
+
+    // Test if the snarl can be longer than the reads
+    bool read_bounded = is_snarl_smaller_than_reads(augmented_graph, snarl, snarl_contents, reads_by_name);
+    TraversalAlg use_traversal_alg = traversal_alg;
+    if (traversal_alg == TraversalAlg::Adaptive) {
+        use_traversal_alg = read_bounded ? TraversalAlg::Reads : TraversalAlg::Representative;
+    }
+
+    if (use_traversal_alg == TraversalAlg::Exhaustive &&
+        !manager.is_leaf(snarl)) {
+        // The SupportRestrictedTraversalFinder we use in Exhaustive mode
+        // can only handle leaf snarls.
+
+        // Todo : support nesting hierarchy!
+        if (show_progress) {
+            cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
+                << " because it isn't a leaf and traversal algorithm "
+                << alg2name[use_traversal_alg] << " only works on leaves" << endl;
+        }
+        return false;
+    }
+
+    if (use_traversal_alg == TraversalAlg::Representative && !manager.all_children_trivial(snarl, graph)) {
+        // The RepresentativeTraversalFinder works for root and leaf
+        // snarls, but unless we're in a leaf snarl, or a snarl with only
+        // trivial children, it outputs traversals with child snarls in
+        // them that the rest of genotype can't yet handle.
+
+        // Todo : support nesting hierarchy!
+        if (show_progress) {
+            cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
+                << " because it has nontrivial children and traversal algorithm "
+                << alg2name[use_traversal_alg] << " will produce nested child snarl traversals" << endl;
+        }
+        return false;
+    }
+
+
+    if (use_traversal_alg == TraversalAlg::Reads && !manager.is_root(snarl)) {
+        // The ReadRestrictedTraversalFinder only works for root snarls.
+        // TODO: How do we know this?
+        
+        // Todo : support nesting hierarchy!
+        if (show_progress) {
+            cerr << "Skip snarl " << snarl->start() << " - " << snarl->end()
+                << " because it isn't a root and traversal algorithm "
+                << alg2name[use_traversal_alg] << " only works on roots" << endl;
+        }
+        return false;
+    }
+    
+    // Report the snarl to our statistics code
+    report_snarl(snarl, manager, reference_index, graph, reference_index);
+
+    // Get the traverals
+    vector<SnarlTraversal> paths = get_snarl_traversals(augmented_graph, manager, reads_by_name,
+                                                        snarl, snarl_contents, reference_index,
+                                                        use_traversal_alg);
+
+    if(paths.empty()) {
+        // Don't do anything for ultrabubbles with no routes through
+        if(show_progress) {
+#pragma omp critical (cerr)
+            cerr << "Snarl " << snarl->start() << " - " << snarl->end() << " has " << paths.size() <<
+                " alleles: skipped for having no alleles" << endl;
+        }
+        return false;
+    }
+
+    if(show_progress) {
+#pragma omp critical (cerr)
+        cerr << "Snarl " << snarl->start() << " - " << snarl->end() << " has " << paths.size() << " alleles" << endl;
+        for(auto& path : paths) {
+            // Announce each allele in turn
+#pragma omp critical (cerr)
+            cerr << "\t" << traversal_to_string(graph, path) << endl;
+        }
+    }
+
+    // Compute the lengths of all the alleles
+    set<size_t> allele_lengths;
+    for(auto& path : paths) {
+        allele_lengths.insert(traversal_to_string(graph, path).size());
+    }
+
+    // Get the affinities for all the paths
+    map<const Alignment*, vector<Genotyper::Affinity>> affinities;
+
+    if(allele_lengths.size() > 1 && (realign_indels || !read_bounded)) {
+        // This is an indel, because we can change lengths. Use the slow route to do indel realignment.
+        affinities = get_affinities(augmented_graph, reads_by_name, snarl, snarl_contents, manager, paths);
+    } else {
+        // Just use string comparison. Don't re-align when
+        // length can't change, or when indle realignment is
+        // off.
+        affinities = get_affinities_fast(augmented_graph, reads_by_name, snarl, snarl_contents, manager, paths);
+    }
+
+    if(show_progress) {
+        report_affinities(affinities, paths, graph);
+        for(auto& alignment_and_affinities : affinities) {
+#pragma omp critical (total_affinities)
+            total_affinities += alignment_and_affinities.second.size();
+        }
+    }
+    
+    genotyped = genotype_snarl(graph, snarl, paths, affinities);
+    return true;
+}
+
 pair<pair<int64_t, int64_t>, bool> Genotyper::get_snarl_reference_bounds(const Snarl* snarl, const PathIndex& index,
     const HandleGraph* graph) {
     // Grab the start and end node IDs.
@@ -1160,322 +1469,17 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
     return to_return;
 }
 
-double Genotyper::get_genotype_log_likelihood(VG& graph, const Snarl* snarl, const vector<int>& genotype, const vector<pair<const Alignment*, vector<Affinity>>>& alignment_consistency) {
-    // For each genotype, calculate P(observed reads | genotype) as P(all reads
-    // that don't support an allele from the genotype are mismapped or
-    // miscalled) * P(all reads that do support alleles from the genotype ended
-    // up apportioned across the alleles as they are)
-
-    // This works out to the product over all reads that don't support either
-    // alleles of 1 - ((1 - MAPQ) * (1 - P(bases called wrong)), times the
-    // likelihood of the observed (censored by multi-support) read counts coming
-    // from the alleles they support, and the strands they are observed on.
-
-    // TODO: handle contamination like Freebayes
-
-    // This is the log probability that all reads that don't support either allele in this genotype are wrong.
-    double all_non_supporting_wrong = prob_to_logprob(1);
-
-    // This is the log probability that all the reads that do support alleles in this genotype were drawn from the genotype they support.
-    double all_supporting_drawn = prob_to_logprob(1);
-
-#ifdef debug
-    if(genotype.size() == 2) {
-#pragma omp critical (cerr)
-        cerr << "Calculating P(a" << genotype[0] << "/a" << genotype[1] << ")" << endl;
-    }
-#endif
-
-    // We want to keep count of how many reads support each allele in each
-    // orientation. TODO: we might be sort of double-counting reads that support
-    // multiple alleles, because we'll be treating them as having independent
-    // orientations per allele, when really they're very likely to be oriented
-    // the same way.
-
-    // Maps from int allele number (as appears in Genotype) to total reads
-    // forward and reverse giving support.
-    map<int, pair<int, int>> strand_count_by_allele_and_orientation;
-
-    for(auto& read_and_consistency : alignment_consistency) {
-        // For each read, work out if it supports a genotype we have or not.
-
-        // Split out the alignment from its consistency flags
-        auto& read = *read_and_consistency.first;
-        auto& consistency = read_and_consistency.second;
-
-        // How many of the alleles in our genotype is it consistent with?
-        int consistent_alleles = 0;
-        // We only count each allele in the genotype once.
-        set<int> alleles_seen;
-        for(int allele : genotype) {
-            if(alleles_seen.count(allele)) {
-                // Counted up consistency with this allele already.
-                continue;
-            }
-            alleles_seen.insert(allele);
-
-            // For each unique allele in the genotype...
-
-            if(consistency.size() > allele && consistency.at(allele).consistent) {
-                // We're consistent with this allele
-                consistent_alleles++;
-            }
-        }
-        
-        // Now we know how many alleles this read is consistent with.
-        
-        if (consistent_alleles == 1) {
-            // If it supports exactly one allele, we add it to the per-strand support counts for that allele
-            for(int allele : genotype) {
-                if(consistency.size() > allele && consistency.at(allele).consistent) {
-                    // We found the consustent allele again.
-                    
-                    if(consistency.at(allele).is_reverse) {
-                        // Consistent with reverse
-                        strand_count_by_allele_and_orientation[allele].second++;
-                        break;
-                    } else {
-                        // Consistent with forward
-                        strand_count_by_allele_and_orientation[allele].first++;
-                        break;
-                    }
-                }
-            }
-        }
-
-        auto read_qual = alignment_qual_score(graph, snarl, read);
-
-#ifdef debug
-#pragma omp critical (cerr)
-        cerr << "Read (qual score " << read_qual << ") consistent with " << consistent_alleles
-             << " genotype alleles observed." << endl;
-#endif
-
-        if(consistent_alleles == 0) {
-            // This read is inconsistent with all the alleles in the genotype,
-            // so, given the genotype, the read must be sequenced or mapped
-            // wrong.
-
-            double logprob_wrong;
-            if(use_mapq) {
-                // Compute P(mapped wrong or called wrong) = P(not (mapped right and called right)) = P(not (not mapped wrong and not called wrong))
-                logprob_wrong = logprob_invert(logprob_invert(phred_to_logprob(read.mapping_quality())) +
-                                               logprob_invert(phred_to_logprob(read_qual)));
-            } else {
-                // Compute P(called wrong).
-                logprob_wrong = phred_to_logprob(read_qual);
-            }
-
-#ifdef debug
-#pragma omp critical (cerr)
-            cerr << "P(wrong) = " << logprob_to_prob(logprob_wrong) << endl;
-#endif
-            all_non_supporting_wrong += logprob_wrong;
-        } else {
-            // This read is consistent with some of the alleles in the genotype,
-            // so we must have drawn one of those alleles when sequencing.
-
-            // We account for this in a framework where we consider the reads
-            // indistinguishable, so ignore it for now.
-        }
-
-    }
-
-    // Multiply in in the probability that the supporting reads all came from
-    // the strands they are on.
-    double strands_as_specified = prob_to_logprob(1);
-    // Each strand is equally likely
-    vector<double> probs_by_orientation = {0.5, 0.5};
-    for(auto& kv : strand_count_by_allele_and_orientation) {
-        // For the forward and reverse strand counts for all the alleles
-        auto& forward_count = kv.second.first;
-        auto& reverse_count = kv.second.second;
-
-        // Convert to a vector to satisfy the multinomial PMF function.
-        vector<int> obs = {forward_count, reverse_count};
-
-        // Get the log probability under multinomial.
-
-        // TODO: we're counting oriented reads supporting multiple alleles
-        // multiple times. Maybe we should look at orientation overall somehow?
-        // Or treat orientations of alleles as the thing we do our master
-        // censored multinomial likelihood over?
-        double logprob = multinomial_sampling_prob_ln(probs_by_orientation, obs);
-
-#ifdef debug
-#pragma omp critical (cerr)
-        cerr << "Allele "  << kv.first << " supported by " << forward_count << " forward, "
-             << reverse_count << " reverse (P=" << logprob_to_prob(logprob) << ")" << endl;
-#endif
-        strands_as_specified += logprob;
-
-
-    }
-
-    // Multiply in probability that the reads came from alleles they support,
-    // treating reads as indistinguishable and using a multinomial/binomial
-    // model.
-    double alleles_as_specified = prob_to_logprob(1);
-    if(genotype.size() == 2 && genotype.at(0) != genotype.at(1)) {
-        // For diploid heterozygotes, we can easily handle multi-support as
-        // censorship. We know that at least the reads that only support allele
-        // 0 are from allele 0, and that at most the reads that only support
-        // allele 0 and those that support both alleles all are from allele 0.
-        // We end up summing over a normalized choose (since the success
-        // probability is known and fixed at 1/2), as described in Frey and
-        // Marrero (2008) "A surprising MLE for Interval-Censored Binomial
-        // Data". Diploid homozygotes don't need any of this logic, and keep the
-        // default probability of 1 above for the support distribution across
-        // alleles.
-
-        // Work out how many reads support allele 0 only.
-        int first_only_reads = 0;
-        // And how many support both
-        int ambiguous_reads = 0;
-        // And how many total reads there are (# of trials).
-        int total_reads = 0;
-
-        for(auto& read_and_consistency : alignment_consistency) {
-            auto& consistency = read_and_consistency.second;
-
-            if(consistency.size() <= max(genotype.at(0), genotype.at(1))) {
-                // No consistency info calculated for this useless uninformative
-                // read.
-                continue;
-            }
-
-            if(consistency.at(genotype.at(0)).consistent) {
-                // Read is consistent with first allele
-                if(consistency.at(genotype.at(1)).consistent) {
-                    // And also second, so it's ambiguous
-                    ambiguous_reads++;
-#ifdef debug
-#pragma omp critical (cerr)
-                    cerr << "Ambiguous read: " << read_and_consistency.first->sequence() << endl;
-                    for(int i = 0; i < consistency.size(); i++) {
-#pragma omp critical (cerr)
-                        cerr << "\t" << i << ": " << consistency[i].consistent << endl;
-                    }
-#endif
-                } else {
-                    // And only first allele
-                    first_only_reads++;
-                }
-                total_reads++;
-            } else if(consistency.at(genotype.at(1)).consistent) {
-                // It's consistent with only the second allele.
-                total_reads++;
-            }
-            // Don't count reads inconsistent with the genotype in this analysis.
-        }
-
-        // Now do the likelihood. We know each atom will be weighted by the same
-        // factor (for assigning all the reads at 50% probability) so we can
-        // pull it out of the sum.
-        double log_atom_weight = prob_to_logprob(0.5) * total_reads;
-
-        // We calculate the probability of each atom, weight, then sum.
-        vector<double> weighted_atom_logprobs;
-
-        for(int i = first_only_reads; i <= first_only_reads + ambiguous_reads; i++) {
-            // For each possible actual number of reads from the first allele,
-            // add in the probability of that atom.
-            auto weighted_atom_logprob = choose_ln(total_reads, i) + log_atom_weight;
-            weighted_atom_logprobs.push_back(weighted_atom_logprob);
-
-#ifdef debug
-#pragma omp critical (cerr)
-            cerr << "P(" << i << " from first allele) = " << logprob_to_prob(weighted_atom_logprob) << endl;
-#endif
-
-        }
-
-        // Atoms are already weighted above with the shared weight, and then multiply in (to
-        // probability of 1) the probability of observing this range of possible
-        // totals of reads from each of the two alleles.
-        alleles_as_specified = logprob_sum(weighted_atom_logprobs);
-
-#ifdef debug
-#pragma omp critical (cerr)
-        cerr << "P(" << first_only_reads << " to "  << (first_only_reads + ambiguous_reads) << " from first allele) = "
-             << logprob_to_prob(logprob_sum(weighted_atom_logprobs)) 
-             << " = " << logprob_to_prob(alleles_as_specified) << endl;
-#endif
-
-    } else if(genotype.size() > 2) {
-        // This is tougher. We have to use a censored multinomial.
-        
-        // First we want to compress things down to distinct alleles in the
-        // genotype, and weight them by the number of times they occur. This
-        // saves us work because the multinomial will have fewer categories and
-        // less ambiguity.
-        double per_allele_prob = 1.0/genotype.size();
-        
-        // We'll put unique alleles in this set and store the total probability
-        // of each under it.
-        unordered_map<int, double> unique_alleles;
-        
-        for (auto& allele : genotype) {
-            unique_alleles[allele] += per_allele_prob;
-        }
-        
-        // Now convert to probs format (vector)
-        vector<double> probs;
-        for (auto& kv : unique_alleles) {
-            // For each allele in whatever order the set gave them, put in the probability.
-            probs.push_back(kv.second);
-        }
-        
-        // Now we will assign reads to ambiguity classes and count them in here.
-        unordered_map<vector<bool>, int> reads_by_class;
-        
-        for(auto& read_and_consistency : alignment_consistency) {
-            // For each read, look at what it is consistent with
-            auto& consistency = read_and_consistency.second;
-            
-            // Compute an ambiguity class for it
-            vector<bool> ambiguity_class;
-
-            for (auto& kv : unique_alleles) {
-                // For each unique allele number in the genotype, in their assigned order
-                const auto& allele_number = kv.first;
-                
-                // Add the consistency bit for this read against this allele to the class
-                ambiguity_class.push_back(consistency.at(allele_number).consistent);
-            }
-            
-            // Count the read as being in its class.
-            reads_by_class[ambiguity_class]++;    
-        }
-        
-        // Compute the censored multinomial probability of these potentially ambiguous reads given these class probabilities.
-        alleles_as_specified = multinomial_censored_sampling_prob_ln(probs, reads_by_class);
-        
-#ifdef debug
-#pragma omp critical (cerr)
-        cerr << "P(reads drawn match specified ambiguity classes) = " << alleles_as_specified << endl;
-#endif
-        
-    }
-    // Haploid or 0-ploid genotypes will always have all the reads drawn from
-    // their source alleles in the distribution observed, as only one is
-    // possible.
-
-    // Now we've looked at all the reads, so AND everything together
-    double total_logprob = all_non_supporting_wrong + all_supporting_drawn + strands_as_specified + alleles_as_specified;
-
-#ifdef debug
-    if(genotype.size() == 2) {
-#pragma omp critical (cerr)
-        cerr << "logP(a" << genotype[0] << "/a" << genotype[1] << ") = " << all_non_supporting_wrong << " + "
-             << all_supporting_drawn << " + " << strands_as_specified << " + " << alleles_as_specified << " = "
-             << total_logprob << endl;
+double Genotyper::get_read_logprob_wrong(VG& graph, const Snarl* snarl, const Alignment& alignment) {
+    auto read_qual = alignment_qual_score(graph, snarl, alignment);
+    
+    if(use_mapq) {
+        // Compute P(mapped wrong or called wrong) = P(not (mapped right and called right)) = P(not (not mapped wrong and not called wrong))
+        return logprob_invert(logprob_invert(phred_to_logprob(alignment.mapping_quality())) +
+                              logprob_invert(phred_to_logprob(read_qual)));
+    } else {
+        // Compute P(called wrong).
+        return phred_to_logprob(read_qual);
     }
-#endif
-
-    return total_logprob;
-
-
 }
 
 double Genotyper::get_genotype_log_prior(const vector<int>& genotype) {
@@ -1734,6 +1738,22 @@ Locus Genotyper::genotype_snarl(VG& graph,
     }
 #endif
 
+    // Pack the reads into a dense matrix against the alleles, working out what
+    // each read contributes if it is wrong just once, instead of once per
+    // genotype.
+    DenseGenotypeLikelihoodCalculator likelihood_calculator(snarl_paths.size());
+    for(auto& read_and_consistency : alignment_consistency) {
+        auto& consistency = read_and_consistency.second;
+        vector<bool> consistent(consistency.size());
+        vector<bool> is_reverse(consistency.size());
+        for(size_t i = 0; i < consistency.size(); i++) {
+            consistent[i] = consistency[i].consistent;
+            is_reverse[i] = consistency[i].is_reverse;
+        }
+        likelihood_calculator.add_read(consistent, is_reverse,
+                                       get_read_logprob_wrong(graph, snarl, *read_and_consistency.first));
+    }
+
     // We'll go through all the genotypes, fill in their probabilities, put them
     // in here, and then sort them to find the best.
     vector<Genotype> genotypes_sorted;
@@ -1747,7 +1767,7 @@ Locus Genotyper::genotype_snarl(VG& graph,
             vector<int> genotype_vector = {allele1, allele2};
 
             // Compute the log probability of the data given the genotype
-            double log_likelihood = get_genotype_log_likelihood(graph, snarl, genotype_vector, alignment_consistency);
+            double log_likelihood = likelihood_calculator.calculate_log_likelihood(genotype_vector);
 
             // Compute the prior
             double log_prior = get_genotype_log_prior(genotype_vector);
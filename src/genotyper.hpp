@@ -27,6 +27,7 @@
 #include "path_index.hpp"
 #include "index.hpp"
 #include "distributions.hpp"
+#include "stream_index.hpp"
 
 namespace vg {
 
@@ -156,6 +157,10 @@ public:
     // Show progress
     bool show_progress = false;
 
+    // How many snarls should run_indexed() genotype at once before writing out
+    // their sorted output?
+    size_t snarls_per_window = 1024;
+
     /// Process and write output.
     /// Alignments must be embedded in the AugmentedGraph.
     void run(AugmentedGraph& graph,
@@ -169,6 +174,43 @@ public:
              int length_override = 0,
              int variant_offset = 0);
     
+    /// Process and write output, without loading all the reads at once.
+    /// Instead, for each snarl, the reads that touch it are fetched from a
+    /// sorted GAM with a GAMIndex. Snarls are genotyped in parallel, and
+    /// output is written in reference order. The reads must already be
+    /// embedded in the graph without edits (as from vg augment -A).
+    void run_indexed(VG& graph,
+                     const GAMIndex& gam_index,
+                     const string& gam_file_name,
+                     ostream& out,
+                     string ref_path_name,
+                     string contig_name = "",
+                     string sample_name = "",
+                     bool output_vcf = false,
+                     bool output_json = false,
+                     int length_override = 0,
+                     int variant_offset = 0);
+
+    /**
+     * Genotype a single snarl from the reads embedded in the given augmented
+     * graph. Returns false if the snarl is skipped, because the traversal
+     * algorithm can't handle it or it has no alleles. Otherwise fills in the
+     * genotyped Locus and the snarl's contents in the augmented graph. The
+     * affinities computed are counted in total_affinities when showing progress.
+     */
+    bool call_snarl(AugmentedGraph& augmented_graph, SnarlManager& manager, const Snarl* snarl,
+                    map<string, const Alignment*>& reads_by_name, PathIndex* reference_index,
+                    Locus& genotyped, pair<unordered_set<id_t>, unordered_set<edge_t> >& snarl_contents,
+                    size_t& total_affinities);
+
+    /**
+     * Fill in an empty AugmentedGraph with the part of the given graph used by
+     * a snarl's nodes and the given reads (which must be entirely in the
+     * graph), along with the embedded paths on it, and embed the reads.
+     */
+    void make_snarl_augmented_graph(VG& graph, const unordered_set<id_t>& snarl_nodes,
+                                    vector<Alignment>& reads, AugmentedGraph& out);
+    
     /**
      * Given an Alignment and a Snarl, compute a phred score for the quality of
      * the alignment's bases within the snarl overall (not counting the start and
@@ -258,18 +300,11 @@ public:
     Locus genotype_snarl(VG& graph, const Snarl* snarl, const vector<SnarlTraversal>& superbubble_paths, const map<const Alignment*, vector<Affinity>>& affinities);
         
     /**
-     * Compute the probability of the observed alignments given the genotype.
-     *
-     * Takes a genotype as a vector of allele numbers, and support data as a
-     * collection of pairs of Alignments and vectors of bools marking whether
-     * each alignment is consistent with each allele.
-     *
-     * Alignments should have had their quality values trimmed down to just the
-     * part covering the superbubble.
-     *
-     * Returns a natural log likelihood.
+     * Compute the log probability that the given alignment is mapped or
+     * sequenced wrong in the snarl, which is what it contributes to the
+     * likelihood of a genotype with none of the alleles it is consistent with.
      */
-    double get_genotype_log_likelihood(VG& graph, const Snarl* snarl, const vector<int>& genotype, const vector<pair<const Alignment*, vector<Affinity>>>& alignment_consistency);
+    double get_read_logprob_wrong(VG& graph, const Snarl* snarl, const Alignment& alignment);
     
     /**
      * Compute the prior probability of the given genotype.
@@ -9,6 +9,9 @@ namespace vg {
 
 // init the static memo
 thread_local vector<size_t> BaseMapper::adaptive_reseed_length_memo;
+thread_local unique_ptr<LRUCache<string, BaseMapper::MEMSearchState>> BaseMapper::mem_search_cache;
+thread_local const gcsa::GCSA* BaseMapper::mem_search_cache_gcsa = nullptr;
+thread_local size_t BaseMapper::mem_search_cache_capacity = 0;
 
 BaseMapper::BaseMapper(PathPositionHandleGraph* xidex,
                        gcsa::GCSA* g,
@@ -330,6 +333,37 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
     size_t mem_length = 0;
     vector<int> lcp_maxima;
     
+    // reads that share a suffix pass through the same search states at the start of the backward
+    // search, so we can pick up where an earlier read left off if the whole suffix matched
+    string cache_key;
+    bool record_in_cache = false;
+    if (mem_cache_kmer_length > 0 && seq_end - seq_begin > mem_cache_kmer_length
+        && mem_cache_kmer_length <= gcsa->order()
+        && (max_mem_length <= 0 || mem_cache_kmer_length <= max_mem_length)) {
+        
+        cache_key = string(seq_end - mem_cache_kmer_length, seq_end);
+        // the search always breaks on N, so there's no state to share
+        if (cache_key.find('N') == string::npos) {
+            auto cached = get_mem_search_cache().retrieve(cache_key);
+            bool hit = cached.second && (cached.first.has_max_lcp || !record_max_lcp);
+#pragma omp atomic update
+            mem_cache_queries++;
+            if (hit) {
+#pragma omp atomic update
+                mem_cache_hits++;
+                
+                // resume the search as though we had just stepped through the suffix
+                match.range = cached.first.range;
+                max_lcp = cached.first.max_lcp;
+                mem_length = mem_cache_kmer_length;
+                cursor = seq_end - mem_cache_kmer_length - 1;
+            }
+            else {
+                record_in_cache = true;
+            }
+        }
+    }
+    
 
     // loop maintains invariant that match.range contains the hits for seq[cursor+1:match.end]
     while (cursor >= seq_begin) {
@@ -455,6 +489,12 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
             ++mem_length;
             // just step to the next position
             --cursor;
+            
+            if (record_in_cache && match.end == seq_end && seq_end - (cursor + 1) == mem_cache_kmer_length) {
+                // we matched the entire suffix without breaking the MEM, so other reads can reuse this state
+                get_mem_search_cache().put(cache_key, MEMSearchState{match.range, max_lcp, record_max_lcp});
+                record_in_cache = false;
+            }
         }
     }
     // TODO: is this where the bug with the duplicated MEMs is occurring? (when the prefix of a read
@@ -581,31 +621,26 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         }
     }
     
-    // query the locations of the hits
+    // finalize the hit counts
     // note: iterate in reverse so we remove the parent count from the children MEMs before decrementing
     // the parent count itself
-    for (int64_t i = mems.size() - 1; i >= 0; i--) {
-        
-        MaximalExactMatch& mem = mems[i];
-        
-        if (!include_parent_in_sub_mem_count) {
+    if (!include_parent_in_sub_mem_count) {
+        for (int64_t i = mems.size() - 1; i >= 0; i--) {
             // remove the redundant hits with the parent from the total count
             for (size_t parent_idx : sub_mem_containment_graph[i].second) {
-                mem.match_count -= mems[parent_idx].match_count;
+                mems[i].match_count -= mems[parent_idx].match_count;
             }
         }
+    }
+    
+    // query the locations of the hits all together
+    locate_mem_hits(mems);
+    
+    for (int64_t i = mems.size() - 1; i >= 0; i--) {
+        
+        MaximalExactMatch& mem = mems[i];
         
         if (mem.match_count > 0) {
-            if (hit_max) {
-                gcsa->locate(mem.range, hit_max, mem.nodes);
-                
-            } else {
-                gcsa->locate(mem.range, mem.nodes);
-            }
-            // keep track of the initial number of hits we query in case the nodes vector is
-            // modified later (e.g. by prefiltering)
-            mem.queried_count = mem.nodes.size();
-            
             filtered_mems += mem.match_count - mem.nodes.size();
             total_mems += mem.nodes.size();
         }
@@ -1339,6 +1374,55 @@ void BaseMapper::rescue_high_count_order_length_mems(vector<MaximalExactMatch>&
     }
 }
     
+void BaseMapper::locate_mem_hits(vector<MaximalExactMatch>& mems) {
+    
+    // gather up the MEMs that have hits to locate
+    vector<size_t> to_locate;
+    to_locate.reserve(mems.size());
+    for (size_t i = 0; i < mems.size(); i++) {
+        if (mems[i].match_count > 0) {
+            to_locate.push_back(i);
+        }
+    }
+    
+    // visit them in suffix array order so that consecutive locate queries hit nearby parts of the index,
+    // and so that MEMs with identical ranges (e.g. from repeats within the read) end up next to each other
+    sort(to_locate.begin(), to_locate.end(), [&](size_t i, size_t j) {
+        return mems[i].range < mems[j].range;
+    });
+    
+    for (size_t k = 0; k < to_locate.size(); k++) {
+        MaximalExactMatch& mem = mems[to_locate[k]];
+        if (k > 0 && mems[to_locate[k - 1]].range == mem.range) {
+            // we already located this range, no need to go back to the index
+            mem.nodes = mems[to_locate[k - 1]].nodes;
+        }
+        else if (hit_max) {
+            gcsa->locate(mem.range, hit_max, mem.nodes);
+        }
+        else {
+            gcsa->locate(mem.range, mem.nodes);
+        }
+        // keep track of the initial number of hits we query in case the nodes vector is
+        // modified later (e.g. by prefiltering)
+        mem.queried_count = mem.nodes.size();
+    }
+}
+
+LRUCache<string, BaseMapper::MEMSearchState>& BaseMapper::get_mem_search_cache() {
+    if (!mem_search_cache || mem_search_cache_gcsa != gcsa || mem_search_cache_capacity != mem_cache_size) {
+        // the cached states belong to a different index, or we were asked for a different size
+        mem_search_cache.reset(new LRUCache<string, MEMSearchState>(mem_cache_size));
+        mem_search_cache_gcsa = gcsa;
+        mem_search_cache_capacity = mem_cache_size;
+    }
+    return *mem_search_cache;
+}
+
+double BaseMapper::mem_cache_hit_rate() const {
+    return mem_cache_queries == 0 ? 0.0 : double(mem_cache_hits) / double(mem_cache_queries);
+}
+
 size_t BaseMapper::get_adaptive_min_reseed_length(size_t parent_mem_length) {
     // extend memo until it contains this parent MEM length
     while (adaptive_reseed_length_memo.size() <= parent_mem_length) {
@@ -4379,37 +4463,53 @@ FragmentLengthDistribution::~FragmentLengthDistribution() {
     
 }
 
+FragmentLengthDistribution::FragmentLengthDistribution(const FragmentLengthDistribution& other) {
+    *this = other;
+}
+
+FragmentLengthDistribution& FragmentLengthDistribution::operator=(const FragmentLengthDistribution& other) {
+    if (this != &other) {
+        lock_guard<mutex> other_lock(other.estimate_mutex);
+        lengths = other.lengths;
+        robust_estimation_fraction = other.robust_estimation_fraction;
+        maximum_sample_size = other.maximum_sample_size;
+        reestimation_frequency = other.reestimation_frequency;
+        params = other.params;
+        is_fixed.store(other.is_fixed.load());
+    }
+    return *this;
+}
+
 void FragmentLengthDistribution::force_parameters(double mean, double stddev) {
-    mu = mean;
-    sigma = stddev;
-    is_fixed = true;
+    lock_guard<mutex> lock(estimate_mutex);
+    params.mu = mean;
+    params.sigma = stddev;
+    is_fixed.store(true, std::memory_order_release);
 }
 
 void FragmentLengthDistribution::register_fragment_length(int64_t length) {
     // allow this function to operate fully in parallel once the distribution is
     // fixed (and hence threadsafe)
-    if (is_fixed) {
+    if (is_fixed.load(std::memory_order_acquire)) {
         return;
     }
-#pragma omp critical
-    {
-        // in case the distribution became fixed while this thread was waiting
-        // to execute the critical block
-        if (!is_fixed) {
-            lengths.insert((double) length);
-            if (lengths.size() == maximum_sample_size) {
-                // we've reached the maximum sample we wanted, so fix the estimation
-                estimate_distribution();
-                is_fixed = true;
-            }
-            else if (lengths.size() % reestimation_frequency == 0) {
-                estimate_distribution();
-            }
+    lock_guard<mutex> lock(estimate_mutex);
+    // in case the distribution became fixed while this thread was waiting
+    // for the lock
+    if (!is_fixed.load(std::memory_order_relaxed)) {
+        lengths.insert((double) length);
+        if (lengths.size() == maximum_sample_size) {
+            // we've reached the maximum sample we wanted, so fix the estimation
+            params = estimate_distribution();
+            is_fixed.store(true, std::memory_order_release);
+        }
+        else if (lengths.size() % reestimation_frequency == 0) {
+            params = estimate_distribution();
         }
     }
 }
     
-void FragmentLengthDistribution::estimate_distribution() {
+FragmentLengthDistribution::Parameters FragmentLengthDistribution::estimate_distribution() const {
     // remove the tails from the estimation
     size_t to_skip = (size_t) (lengths.size() * (1.0 - robust_estimation_fraction) * 0.5);
     auto begin = lengths.begin();
@@ -4429,23 +4529,34 @@ void FragmentLengthDistribution::estimate_distribution() {
         sum_of_sqs += (*iter) * (*iter);
     }
     // use cumulants to compute moments
-    mu = sum / count;
-    double raw_var = sum_of_sqs / count - mu * mu;
+    Parameters estimate;
+    estimate.mu = sum / count;
+    double raw_var = sum_of_sqs / count - estimate.mu * estimate.mu;
     // apply method of moments estimation using the appropriate truncated normal distribution
     double a = normal_inverse_cdf(1.0 - 0.5 * (1.0 - robust_estimation_fraction));
-    sigma = sqrt(raw_var / (1.0 - 2.0 * a * normal_pdf(a, 0.0, 1.0)));
+    estimate.sigma = sqrt(raw_var / (1.0 - 2.0 * a * normal_pdf(a, 0.0, 1.0)));
+    return estimate;
+}
+    
+FragmentLengthDistribution::Parameters FragmentLengthDistribution::current_parameters() const {
+    if (is_fixed.load(std::memory_order_acquire)) {
+        // the parameters will never change again, so no need to lock
+        return params;
+    }
+    lock_guard<mutex> lock(estimate_mutex);
+    return params;
 }
     
 double FragmentLengthDistribution::mean() const {
-    return mu;
+    return current_parameters().mu;
 }
 
 double FragmentLengthDistribution::stdev() const {
-    return sigma;
+    return current_parameters().sigma;
 }
 
 bool FragmentLengthDistribution::is_finalized() const {
-    return is_fixed;
+    return is_fixed.load(std::memory_order_acquire);
 }
     
 size_t FragmentLengthDistribution::max_sample_size() const {
@@ -4453,6 +4564,10 @@ size_t FragmentLengthDistribution::max_sample_size() const {
 }
     
 size_t FragmentLengthDistribution::curr_sample_size() const {
+    if (is_fixed.load(std::memory_order_acquire)) {
+        return lengths.size();
+    }
+    lock_guard<mutex> lock(estimate_mutex);
     return lengths.size();
 }
     
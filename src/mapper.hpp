@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <map>
+#include <atomic>
+#include <mutex>
 #include <chrono>
 #include <ctime>
 #include "omp.h"
@@ -111,11 +113,17 @@ public:
     FragmentLengthDistribution(void);
     ~FragmentLengthDistribution();
     
+    /// Copy a distribution. Must not be done while other threads are registering
+    /// fragment lengths.
+    FragmentLengthDistribution(const FragmentLengthDistribution& other);
+    FragmentLengthDistribution& operator=(const FragmentLengthDistribution& other);
+    
     
     /// Instead of estimating anything, just use these parameters.
     void force_parameters(double mean, double stddev);
     
-    /// Record an observed fragment length
+    /// Record an observed fragment length. Thread safe, so mapping can proceed
+    /// in parallel while the distribution is being estimated.
     void register_fragment_length(int64_t length);
 
     /// Robust mean of the distribution observed so far
@@ -125,7 +133,8 @@ public:
     double stdev() const;
     
     /// Returns true if the maximum sample size has been reached, which finalizes the
-    /// distribution estimate
+    /// distribution estimate. Once this returns true, the mean and standard deviation
+    /// are safe to read from any thread.
     bool is_finalized() const;
     
     /// Returns the max sample size up to which the distribution will continue to reestimate
@@ -144,17 +153,31 @@ public:
     multiset<double>::const_iterator measurements_end() const;
     
 private:
+    
+    /// The parameters of the distribution, published together
+    struct Parameters {
+        double mu = 0.0;
+        double sigma = 1.0;
+    };
+    
+    /// Guards the samples and the parameters until the distribution is fixed
+    mutable mutex estimate_mutex;
+    
     multiset<double> lengths;
-    bool is_fixed = false;
+    Parameters params;
+    /// Set with release semantics only after the final parameters are written,
+    /// after which neither the samples nor the parameters change
+    atomic<bool> is_fixed{false};
     
     double robust_estimation_fraction;
     size_t maximum_sample_size;
     size_t reestimation_frequency;
     
-    double mu = 0.0;
-    double sigma = 1.0;
+    /// Compute the parameters from the current samples. Caller must hold the lock.
+    Parameters estimate_distribution() const;
     
-    void estimate_distribution();
+    /// Get a consistent copy of the current parameters from any thread
+    Parameters current_parameters() const;
 };
 
 /**
@@ -228,6 +251,10 @@ public:
                      int min_mem_length = 1,
                      int reseed_length = 0);
     
+    /// fills the hit positions of all MEMs that have a nonzero match count, querying the GCSA in suffix
+    /// array order and only once for each distinct range
+    void locate_mem_hits(vector<MaximalExactMatch>& mems);
+    
     /// identifies tracts of order-length MEMs that were unfilled because their hit count was above the max
     /// and fills one MEM in the tract (the one with the smallest hit count), assumes MEMs are lexicographically
     /// ordered by read index
@@ -258,6 +285,8 @@ public:
     int max_sub_mem_recursion_depth = 2;
     int unpaired_penalty = 17;
     bool precollapse_order_length_hits = true;
+    size_t mem_cache_kmer_length = 0; // cache backward search states for read suffixes of this length (0 = disabled)
+    size_t mem_cache_size = 1 << 16; // the max number of search states each thread keeps in its cache
     double avg_node_length = 0;
     size_t total_seq_length = 0;
     
@@ -317,6 +346,29 @@ public:
     // thread_local to allow alternating reads/writes
     thread_local static vector<size_t> adaptive_reseed_length_memo;
     
+    /// The state of the backward search in find_mems_deep after it has consumed a read suffix
+    struct MEMSearchState {
+        gcsa::range_type range;
+        int max_lcp;
+        bool has_max_lcp;
+    };
+    
+    /// Get the calling thread's cache of search states, keyed by read suffix. The cache is
+    /// reset if it was last used with a different GCSA or capacity.
+    LRUCache<string, MEMSearchState>& get_mem_search_cache();
+    
+    // thread_local so that threads can look up and store search states without synchronizing
+    thread_local static unique_ptr<LRUCache<string, MEMSearchState>> mem_search_cache;
+    thread_local static const gcsa::GCSA* mem_search_cache_gcsa;
+    thread_local static size_t mem_search_cache_capacity;
+    
+    /// Returns the fraction of find_mems_deep queries that found their search state cached
+    double mem_cache_hit_rate() const;
+    
+    // tallies for the MEM search cache, updated atomically
+    uint64_t mem_cache_queries = 0;
+    uint64_t mem_cache_hits = 0;
+    
     // xg index
     PathPositionHandleGraph* xindex = nullptr;
     
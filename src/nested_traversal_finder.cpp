@@ -191,7 +191,7 @@ Support NestedTraversalFinder::min_support_in_path(const vector<Visit>& path) {
             id_t node = v.node_id();
             
             // Return the support for it, or 0 if it's not in the map.
-            return augmented.node_supports.count(node) ? augmented.node_supports.at(node) : Support();
+            return augmented.get_support(node);
         } else {
             // It's a snarl visit. We assume it goes in one side and out the
             // other.
@@ -217,7 +217,7 @@ Support NestedTraversalFinder::min_support_in_path(const vector<Visit>& path) {
                                                   augmented.graph.get_handle(to_side.node, to_side.is_end));
 
         assert(augmented.graph.has_edge(edge.first, edge.second));
-        Support edge_support = augmented.edge_supports.count(edge) ? augmented.edge_supports.at(edge) : Support();
+        Support edge_support = augmented.get_support(edge);
         min_support = support_min(min_support, edge_support);
     }
 
@@ -294,7 +294,7 @@ set<pair<size_t, list<Visit>>> NestedTraversalFinder::search_left(const Visit& r
                 edge_t edge = augmented.graph.edge_handle(augmented.graph.get_handle(from_side.node, !from_side.is_end),
                                                   augmented.graph.get_handle(to_side.node, to_side.is_end));
                 
-                if (!augmented.edge_supports.count(edge) || total(augmented.edge_supports.at(edge)) == 0) {
+                if (total(augmented.get_support(edge)) == 0) {
                     // This edge is not supported, so don't explore this extension.
                     continue;
                 }
@@ -304,7 +304,7 @@ set<pair<size_t, list<Visit>>> NestedTraversalFinder::search_left(const Visit& r
                 // sure it has coverage.
                 id_t node = to_right_side(extension).node;
                 
-                if (!augmented.node_supports.count(node) || total(augmented.node_supports.at(node)) == 0) {
+                if (total(augmented.get_support(node)) == 0) {
                     // This node is not supported, so don't explore this extension.
                     continue;
                 }
@@ -48,6 +48,11 @@ public:
      */
     virtual string get_default_value() const = 0;
     
+    /**
+     * Get the current value as a string.
+     */
+    virtual string get_value() const = 0;
+    
     /**
      * Returns true if the option takes an argument, and false otherwise.
      */
@@ -412,6 +417,13 @@ public:
         return Parser::unparse(default_value);
     };
     
+    /**
+     * Get the current value as a string.
+     */
+    virtual string get_value() const {
+        return Parser::unparse(value);
+    }
+    
     /**
      * Returns true if the option takes an argument, and false otherwise.
      */
@@ -5,6 +5,12 @@
 namespace vg {
 
 
+void Sampler::reseed(size_t seed, int64_t start_nonce) {
+    rng.seed(seed);
+    path_sampler.reset();
+    nonce = start_nonce;
+}
+
 void Sampler::set_source_paths(const vector<string>& source_paths,
                                const vector<pair<string, double>>& transcript_expressions) {
     if (!source_paths.empty() && !transcript_expressions.empty()) {
@@ -329,7 +335,7 @@ vector<Alignment> Sampler::alignment_pair(size_t read_length, size_t fragment_le
         string data;
         aln1.SerializeToString(&data);
         aln2.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -413,7 +419,7 @@ Alignment Sampler::alignment_to_path(const string& source_path, size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -466,7 +472,7 @@ Alignment Sampler::alignment_to_graph(size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -1375,6 +1381,33 @@ tuple<size_t, bool, pos_t, string> NGSSimulator::sample_start_path_pos() {
     return make_tuple(offset, rev, pos, source_path);
 }
 
+void NGSSimulator::reseed(size_t seed, size_t read_number) {
+    prng.seed(seed);
+    // Seed the quality models the same way the constructor does
+    for (size_t i = 0; i < transition_distrs_1.size(); i++) {
+        transition_distrs_1[i].reseed(seed + i + 1);
+    }
+    for (size_t i = 0; i < transition_distrs_2.size(); i++) {
+        transition_distrs_2[i].reseed(seed + i + 1);
+    }
+    joint_initial_distr.reseed(seed - 1);
+    
+    // Drop any state the distributions have carried over from earlier draws
+    path_sampler.reset();
+    for (auto& start_pos_sampler : start_pos_samplers) {
+        start_pos_sampler.reset();
+    }
+    strand_sampler.reset();
+    background_sampler.reset();
+    mut_sampler.reset();
+    prob_sampler.reset();
+    insert_sampler.reset();
+    
+    // Name reads by their global index, so names don't depend on how reads
+    // are divided among simulators.
+    sample_counter = read_number;
+}
+
 string NGSSimulator::get_read_name() {
     stringstream sstrm;
     sstrm << "seed_" << seed << "_fragment_" << sample_counter;
@@ -1474,6 +1507,14 @@ NGSSimulator::MarkovDistribution<From, To>::MarkovDistribution(size_t seed) : pr
     // nothing to do
 }
 
+template<class From, class To>
+void NGSSimulator::MarkovDistribution<From, To>::reseed(size_t seed) {
+    prng.seed(seed);
+    for (auto& sampler : samplers) {
+        sampler.second.reset();
+    }
+}
+
 template<class From, class To>
 void NGSSimulator::MarkovDistribution<From, To>::record_transition(From from, To to) {
     if (!cond_distrs.count(from)) {
@@ -78,6 +78,11 @@ public:
         set_source_paths(source_paths, transcript_expressions);
     }
 
+    /// Restart the random number generator from the given seed, and start
+    /// read name disambiguation from the given nonce, so that the reads
+    /// sampled next depend only on these values.
+    void reseed(size_t seed, int64_t start_nonce = 0);
+
     /// Make a path sampling distribution based on relative lengths or on transcript expressions
     /// (at most one should be non-empty)
     void set_source_paths(const vector<string>& source_paths,
@@ -168,6 +173,12 @@ public:
     /// Sample a pair of reads an alignments
     pair<Alignment, Alignment> sample_read_pair();
     
+    /// Restart all random number generation from the given seed, and number
+    /// the next read (or pair) sampled with the given index. Reads sampled
+    /// afterward depend only on these values and the training data, not on
+    /// what was sampled before.
+    void reseed(size_t seed, size_t read_number);
+    
 private:
     template<class From, class To>
     class MarkovDistribution {
@@ -180,6 +191,8 @@ private:
         void finalize();
         /// sample according to the training data
         To sample_transition(From from);
+        /// restart the random number generator from the given seed
+        void reseed(size_t seed);
         
     private:
         
@@ -10,6 +10,8 @@
 #include <vector>
 #include <set>
 #include <unordered_map>
+#include <list>
+#include <memory>
 #include <type_traits>
 
 #include "types.hpp"
@@ -339,6 +341,10 @@ protected:
     /// TODO: Is repeated binary search on the ranges going to be better than an unordered_set of all the individual IDs?
     static bool is_in_range(const vector<pair<id_t, id_t>>& ranges, id_t id);
     
+    // Sessions need to check ranges the same way we do.
+    template<typename Message>
+    friend class StreamIndexSession;
+    
 private:
     // Not copyable because we contain pointers.
     StreamIndexBase(const StreamIndexBase& other) = delete;
@@ -402,6 +408,87 @@ protected:
 /// Define a GAM index as a stream index over a stream of Alignments
 using GAMIndex = StreamIndex<Alignment>;
 
+/**
+ * A long-lived query context over a StreamIndex and one open, seekable file.
+ *
+ * Keeps the index and cursor for its whole lifetime, and keeps the decoded
+ * messages of recently read groups in a bounded LRU cache, so a series of
+ * queries that touch the same part of the file only decompresses and parses
+ * each group once. Batches of queries can also be answered in a single merged
+ * sweep, where the virtual offset ranges of all the queries are coalesced and
+ * each group is read at most once.
+ *
+ * Not thread safe; use one session per thread (each with its own cursor).
+ */
+template<typename Message>
+class StreamIndexSession {
+public:
+    using cursor_t = typename StreamIndex<Message>::cursor_t;
+    
+    /// Make a session over the given index and a cursor on the file it
+    /// indexes. Both must outlive the session. At most max_cached_messages
+    /// messages are kept decoded in memory, in whole groups.
+    StreamIndexSession(const StreamIndex<Message>& index, cursor_t& cursor, size_t max_cached_messages = 65536);
+    
+    /// Call the given callback with all the messages that visit a node in any
+    /// of the given inclusive ranges, which need not be sorted or coalesced.
+    /// Emits each message at most once, in file order per index run.
+    void find(const vector<pair<id_t, id_t>>& ranges, const function<void(const Message&)>& handle_result);
+    
+    /// Answer a batch of queries, each a collection of inclusive ID ranges, in
+    /// one sweep over the union of their ranges. Each matching message is
+    /// emitted once, along with the sorted numbers of all the queries it
+    /// matches.
+    void find_batch(const vector<vector<pair<id_t, id_t>>>& queries,
+        const function<void(const vector<size_t>&, const Message&)>& handle_result);
+    
+    /// Sort and coalesce overlapping or abutting inclusive ID ranges in place.
+    static void coalesce(vector<pair<id_t, id_t>>& ranges);
+    
+    /// Get the number of group reads satisfied from the cache.
+    size_t cache_hits() const;
+    
+    /// Get the number of groups that had to be read from the file.
+    size_t cache_misses() const;
+    
+protected:
+    
+    /// The decoded contents of one group in the file
+    struct Group {
+        /// The messages in the group, in file order
+        vector<Message> messages;
+        /// The virtual offset of the next group, or EOF
+        int64_t past_end_vo;
+        /// The minimum node ID touched by the group, or max() if it touches none
+        id_t min_id;
+    };
+    
+    /// Get the group starting at the given virtual offset, from the cache if
+    /// possible and from the cursor otherwise.
+    shared_ptr<const Group> get_group(int64_t group_vo);
+    
+    /// Sweep the given sorted, coalesced ranges, calling the callback with
+    /// each message in each relevant group that has any node in the ranges.
+    void sweep(const vector<pair<id_t, id_t>>& ranges, const function<void(const Message&)>& handle_result);
+    
+    const StreamIndex<Message>& index;
+    cursor_t& cursor;
+    size_t max_cached_messages;
+    
+    /// Cached groups, most recently used first
+    list<pair<int64_t, shared_ptr<const Group>>> lru;
+    /// Where each cached group's VO lives in the LRU list
+    unordered_map<int64_t, typename list<pair<int64_t, shared_ptr<const Group>>>::iterator> cached;
+    /// How many messages are in the cache now
+    size_t cached_messages = 0;
+    
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+/// Define a GAM query session as a session over a GAM index
+using GAMIndexSession = StreamIndexSession<Alignment>;
+
 
 ////////////
 // Template Implementations
@@ -938,6 +1025,177 @@ auto StreamIndex<Message>::for_each_id(const Message& msg, const function<bool(c
     IDScanner<Message>::scan(msg, iteratee);
 }
 
+template<typename Message>
+StreamIndexSession<Message>::StreamIndexSession(const StreamIndex<Message>& index, cursor_t& cursor, size_t max_cached_messages) :
+    index(index), cursor(cursor), max_cached_messages(max_cached_messages) {
+    
+    // We need seek support
+    assert(cursor.tell_group() != -1);
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::coalesce(vector<pair<id_t, id_t>>& ranges) -> void {
+    if (ranges.empty()) {
+        return;
+    }
+    sort(ranges.begin(), ranges.end());
+    
+    size_t kept = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first <= ranges[kept].second || ranges[i].first - 1 == ranges[kept].second) {
+            // Overlaps or abuts the range we are building, so extend it
+            ranges[kept].second = max(ranges[kept].second, ranges[i].second);
+        } else {
+            ranges[++kept] = ranges[i];
+        }
+    }
+    ranges.resize(kept + 1);
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::cache_hits() const -> size_t {
+    return hits;
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::cache_misses() const -> size_t {
+    return misses;
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::get_group(int64_t group_vo) -> shared_ptr<const Group> {
+    auto found = cached.find(group_vo);
+    if (found != cached.end()) {
+        // Move it to the front of the LRU list and use it.
+        hits++;
+        lru.splice(lru.begin(), lru, found->second);
+        return found->second->second;
+    }
+    
+    misses++;
+    
+    // Read the group from the file
+    auto group = make_shared<Group>();
+    group->min_id = numeric_limits<id_t>::max();
+    cursor.seek_group(group_vo);
+    while (cursor.has_current() && cursor.tell_group() == group_vo) {
+        group->messages.emplace_back(std::move(cursor.take()));
+        IDScanner<Message>::scan(group->messages.back(), [&](const id_t& found) {
+            group->min_id = min(group->min_id, found);
+            return true;
+        });
+    }
+    // Wherever the cursor landed is the start of the next group, or EOF.
+    group->past_end_vo = cursor.tell_group();
+    
+    // Remember it, evicting the least recently used groups to stay in budget.
+    // We always keep the group we just read, even if it alone is over budget.
+    lru.emplace_front(group_vo, group);
+    cached[group_vo] = lru.begin();
+    cached_messages += group->messages.size();
+    while (cached_messages > max_cached_messages && lru.size() > 1) {
+        cached_messages -= lru.back().second->messages.size();
+        cached.erase(lru.back().first);
+        lru.pop_back();
+    }
+    
+    return group;
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::sweep(const vector<pair<id_t, id_t>>& ranges,
+    const function<void(const Message&)>& handle_result) -> void {
+    
+    // Map from processed group VO to the VO of the next group, so runs
+    // overlapping across ranges are only looked at once. We chase chains in it
+    // the same way StreamIndex::find does.
+    unordered_map<int64_t, int64_t> next_unprocessed;
+    
+    for (auto& range : ranges) {
+        index.find(range.first, range.second, [&](int64_t start_vo, int64_t past_end_vo) -> bool {
+            int64_t group_vo = start_vo;
+            while (group_vo < past_end_vo) {
+                auto processed = next_unprocessed.find(group_vo);
+                if (processed != next_unprocessed.end()) {
+                    // Skip over groups we already did
+                    group_vo = processed->second;
+                    continue;
+                }
+                
+                auto group = get_group(group_vo);
+                next_unprocessed[group_vo] = group->past_end_vo;
+                
+                for (auto& message : group->messages) {
+                    bool message_match = false;
+                    IDScanner<Message>::scan(message, [&](const id_t& found) {
+                        message_match = StreamIndexBase::is_in_range(ranges, found);
+                        // Stop as soon as we match
+                        return !message_match;
+                    });
+                    if (message_match) {
+                        handle_result(message);
+                    }
+                }
+                
+                if (group->min_id != numeric_limits<id_t>::max() && group->min_id > range.second) {
+                    // Everything in this non-empty group was too high, so
+                    // nothing later in this run can match this range.
+                    return false;
+                }
+                
+                if (group->past_end_vo <= group_vo) {
+                    // We hit EOF
+                    break;
+                }
+                group_vo = group->past_end_vo;
+            }
+            return true;
+        });
+    }
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::find(const vector<pair<id_t, id_t>>& ranges,
+    const function<void(const Message&)>& handle_result) -> void {
+    
+    auto coalesced = ranges;
+    coalesce(coalesced);
+    sweep(coalesced, handle_result);
+}
+
+template<typename Message>
+auto StreamIndexSession<Message>::find_batch(const vector<vector<pair<id_t, id_t>>>& queries,
+    const function<void(const vector<size_t>&, const Message&)>& handle_result) -> void {
+    
+    // Coalesce each query so we can binary search it, and take the union of
+    // all of them to sweep.
+    vector<vector<pair<id_t, id_t>>> coalesced_queries;
+    coalesced_queries.reserve(queries.size());
+    vector<pair<id_t, id_t>> all_ranges;
+    for (auto& query : queries) {
+        coalesced_queries.push_back(query);
+        coalesce(coalesced_queries.back());
+        all_ranges.insert(all_ranges.end(), query.begin(), query.end());
+    }
+    coalesce(all_ranges);
+    
+    vector<size_t> matched;
+    sweep(all_ranges, [&](const Message& message) {
+        // Work out which queries this message belongs to
+        matched.clear();
+        for (size_t i = 0; i < coalesced_queries.size(); i++) {
+            IDScanner<Message>::scan(message, [&](const id_t& found) {
+                if (StreamIndexBase::is_in_range(coalesced_queries[i], found)) {
+                    matched.push_back(i);
+                    return false;
+                }
+                return true;
+            });
+        }
+        handle_result(matched, message);
+    });
+}
+
 }
 
 #endif
@@ -26,6 +26,8 @@
 
 #include "../vg.hpp"
 #include "../pileup_augmenter.hpp"
+#include "../packer.hpp"
+#include <vg/io/vpkg.hpp>
 
 
 using namespace std;
@@ -56,13 +58,16 @@ void help_augment(char** argv, ConfigurableParser& parser) {
          << "    -p, --progress              show progress" << endl
          << "    -v, --verbose               print information and warnings about vcf generation" << endl
          << "    -t, --threads N             number of threads to use" << endl
+         << "pack options (direct mode):" << endl
+         << "    -k, --pack FILE             only add edits seen at least -g times in this vg pack file" << endl
+         << "    -x, --xg FILE               XG index of the graph the pack was made on (required with -k)" << endl
          << "loci file options:" << endl
          << "    -l, --include-loci FILE     merge all alleles in loci into the graph" << endl       
          << "    -L, --include-gt FILE       merge only the alleles in called genotypes into the graph" << endl
          << "pileup options:" << endl
          << "    -P, --pileup FILE           save pileups to FILE" << endl
          << "    -S, --support FILE          save supports to FILE" << endl                
-         << "    -g, --min-aug-support N     minimum support to augment graph ["
+         << "    -g, --min-aug-support N     minimum support to augment graph (also for -k) ["
          << PileupAugmenter::Default_min_aug_support << "]" << endl
          << "    -U, --subgraph              expect a subgraph and ignore extra pileup entries outside it" << endl
          << "    -q, --min-quality N         ignore bases with PHRED quality < N (default=0)" << endl
@@ -146,6 +151,10 @@ int main_augment(int argc, char** argv) {
     // the graph
     bool recall_mode = false;
 
+    // Only add edits with min_aug_support in this pack file, which was made on this xg
+    string pack_file_name;
+    string xg_file_name;
+
 
     static const struct option long_options[] = {
         // General Options
@@ -159,6 +168,9 @@ int main_augment(int argc, char** argv) {
         {"progress", required_argument, 0, 'p'},
         {"verbose", no_argument, 0, 'v'},
         {"threads", required_argument, 0, 't'},
+        // Pack Options
+        {"pack", required_argument, 0, 'k'},
+        {"xg", required_argument, 0, 'x'},
         // Loci Options
         {"include-loci", required_argument, 0, 'l'},
         {"include-gt", required_argument, 0, 'L'},
@@ -174,7 +186,7 @@ int main_augment(int argc, char** argv) {
         {"recall", no_argument, 0, 'r'},
         {0, 0, 0, 0}
     };
-    static const char* short_options = "a:Z:A:iBhpvt:l:L:P:S:q:m:w:Mg:UrC";
+    static const char* short_options = "a:Z:A:iBhpvt:k:x:l:L:P:S:q:m:w:Mg:UrC";
     optind = 2; // force optind past command positional arguments
 
     // This is our command-line parser
@@ -217,6 +229,14 @@ int main_augment(int argc, char** argv) {
             thread_count = parse<int>(optarg);
             break;
 
+            // Pack Options
+        case 'k':
+            pack_file_name = optarg;
+            break;
+        case 'x':
+            xg_file_name = optarg;
+            break;
+
             // Loci Options
         case 'l':
             loci_file = optarg;
@@ -309,6 +329,26 @@ int main_augment(int argc, char** argv) {
         return 1;
     }
 
+    if (!pack_file_name.empty()) {
+        if (augmentation_mode != "direct" || label_paths) {
+            cerr << "[vg augment] error: Pack (-k) filtering only works when augmenting in \"direct\" mode" << endl;
+            return 1;
+        }
+        if (xg_file_name.empty()) {
+            cerr << "[vg augment] error: Pack (-k) filtering requires the XG index (-x) the pack was made with" << endl;
+            return 1;
+        }
+        if (gam_in_file_name == "-") {
+            cerr << "[vg augment] error: Pack (-k) filtering cannot be used with streaming input gam" << endl;
+            return 1;
+        }
+        if (!gam_out_file_name.empty()) {
+            // Filtered edits change the read's path but not its sequence
+            cerr << "[vg augment] error: Pack (-k) filtering cannot be used with GAM output (-A)" << endl;
+            return 1;
+        }
+    }
+
     if (label_paths && (!gam_out_file_name.empty() || !translation_file_name.empty())) {
         cerr << "[vg augment] error: Translation (-Z) and GAM (-A) output do not work with \"label-only\" (-B) mode" << endl;
         return 1;
@@ -417,6 +457,19 @@ int main_augment(int argc, char** argv) {
         // so it won't work with stdin
         else {
             assert(gam_in_file_name != "-");
+            
+            // Load up the edit supports, if we are filtering by them
+            unique_ptr<PathPositionHandleGraph> xgidx;
+            unique_ptr<Packer> packer;
+            if (!pack_file_name.empty()) {
+                if (show_progress) {
+                    cerr << "Reading pack file" << endl;
+                }
+                xgidx = vg::io::VPKG::load_one<PathPositionHandleGraph>(xg_file_name);
+                packer.reset(new Packer(xgidx.get()));
+                packer->load_from_file(pack_file_name);
+            }
+            
             ifstream gam_in_file(gam_in_file_name);
             ofstream gam_out_file;
             if (!gam_out_file_name.empty()) {
@@ -426,7 +479,7 @@ int main_augment(int argc, char** argv) {
                         !translation_file_name.empty() ? &translation : nullptr,
                         include_paths,
                         !gam_out_file_name.empty() ? &gam_out_file : nullptr,
-                        false, !include_softclips);
+                        false, !include_softclips, packer.get(), min_aug_support);
         }
         
         // Write the augmented graph
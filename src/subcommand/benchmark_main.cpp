@@ -8,6 +8,7 @@
 #include <getopt.h>
 
 #include <iostream>
+#include <fstream>
 
 #include "subcommand.hpp"
 
@@ -20,6 +21,8 @@
 #include "../algorithms/extract_connecting_graph.hpp"
 #include "../algorithms/topological_sort.hpp"
 #include "../algorithms/weakly_connected_components.hpp"
+#include "../algorithms/dijkstra.hpp"
+#include "../vcf_buffer.hpp"
 
 
 
@@ -30,6 +33,7 @@ using namespace vg::subcommand;
 void help_benchmark(char** argv) {
     cerr << "usage: " << argv[0] << " benchmark [options] >report.tsv" << endl
          << "options:" << endl
+         << "    -v, --vcf-samples N    also time reading a synthetic VCF with N samples" << endl
          << "    -p, --progress         show progress" << endl;
 }
 
@@ -40,19 +44,23 @@ int main_benchmark(int argc, char** argv) {
     // Which experiments should we run?
     bool sort_and_order_experiment = false;
     bool get_sequence_experiment = true;
+    bool dijkstra_experiment = true;
+    // How many samples should the VCF reading experiment use? 0 = don't run it.
+    size_t vcf_samples = 0;
     
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
         static struct option long_options[] =
             {
+                {"vcf-samples", required_argument, 0, 'v'},
                 {"progress",  no_argument, 0, 'p'},
                 {"help", no_argument, 0, 'h'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "ph?",
+        c = getopt_long (argc, argv, "v:ph?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -62,6 +70,10 @@ int main_benchmark(int argc, char** argv) {
         switch (c)
         {
 
+        case 'v':
+            vcf_samples = parse<size_t>(optarg);
+            break;
+            
         case 'p':
             show_progress = true;
             break;
@@ -176,6 +188,109 @@ int main_benchmark(int argc, char** argv) {
         
     }
     
+    if (dijkstra_experiment) {
+        
+        // Search out from a handful of nodes, the way per-seed distance
+        // queries do.
+        results.push_back(run_benchmark("vg::algorithms dijkstra", 1000, [&]() {
+            size_t reached = 0;
+            for (size_t i = 1; i < 101; i += 10) {
+                algorithms::dijkstra(&vg, vg.get_handle(i), [&](const handle_t& here, size_t distance) {
+                    reached++;
+                    return true;
+                });
+            }
+            assert(reached > 0);
+        }));
+        
+        results.push_back(run_benchmark("vg::algorithms DijkstraWorkspace", 1000, [&]() {
+            size_t reached = 0;
+            auto& workspace = algorithms::DijkstraWorkspace::get_thread_local();
+            for (size_t i = 1; i < 101; i += 10) {
+                workspace.search(&vg, {vg.get_handle(i)}, [&](const handle_t& here, size_t distance) {
+                    reached++;
+                    return true;
+                });
+            }
+            assert(reached > 0);
+        }));
+        
+        results.push_back(run_benchmark("vg::algorithms dijkstra stop at 32bp", 1000, [&]() {
+            size_t reached = 0;
+            for (size_t i = 1; i < 101; i += 10) {
+                algorithms::dijkstra(&vg, vg.get_handle(i), [&](const handle_t& here, size_t distance) {
+                    if (distance > 32) {
+                        return false;
+                    }
+                    reached++;
+                    return true;
+                });
+            }
+            assert(reached > 0);
+        }));
+        
+        results.push_back(run_benchmark("vg::algorithms bounded_dijkstra 32bp", 1000, [&]() {
+            size_t reached = 0;
+            for (size_t i = 1; i < 101; i += 10) {
+                algorithms::bounded_dijkstra(&vg, {vg.get_handle(i)}, 32, [&](const handle_t& here, size_t distance) {
+                    reached++;
+                    return true;
+                });
+            }
+            assert(reached > 0);
+        }));
+        
+    }
+    
+    if (vcf_samples != 0) {
+        
+        // Write out a VCF with a lot of samples, like a population panel.
+        auto vcf_filename = temp_file::create();
+        ofstream vcf_out(vcf_filename);
+        vcf_out << "##fileformat=VCFv4.2" << endl
+                << "##contig=<ID=ref,length=1000000>" << endl
+                << "##INFO=<ID=AC,Number=A,Type=Integer,Description=\"Allele count\">" << endl
+                << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">" << endl
+                << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+        for (size_t i = 0; i < vcf_samples; i++) {
+            vcf_out << "\tsample" << i;
+        }
+        vcf_out << endl;
+        for (size_t i = 0; i < 1000; i++) {
+            vcf_out << "ref\t" << (i * 10 + 1) << "\t.\tA\tG\t.\tPASS\tAC=" << i % vcf_samples << "\tGT";
+            for (size_t j = 0; j < vcf_samples; j++) {
+                vcf_out << ((i ^ j) % 3 == 0 ? "\t0|1" : "\t0|0");
+            }
+            vcf_out << endl;
+        }
+        vcf_out.close();
+        
+        results.push_back(run_benchmark("VcfBuffer vcflib read", 10, [&]() {
+            vcflib::VariantCallFile vcf;
+            vcf.parseSamples = false;
+            vcf.open(vcf_filename);
+            VcfBuffer buffer(&vcf);
+            size_t count = 0;
+            for (buffer.fill_buffer(); buffer.get() != nullptr; buffer.fill_buffer()) {
+                count++;
+                buffer.handle_buffer();
+            }
+            assert(count == 1000);
+        }));
+        
+        results.push_back(run_benchmark("VcfBuffer htslib read", 10, [&]() {
+            VcfBuffer buffer(vcf_filename);
+            size_t count = 0;
+            for (buffer.fill_buffer(); buffer.get() != nullptr; buffer.fill_buffer()) {
+                count++;
+                buffer.handle_buffer();
+            }
+            assert(count == 1000);
+        }));
+        
+        temp_file::remove(vcf_filename);
+    }
+    
     // Do the control against itself
     results.push_back(run_benchmark("control", 1000, benchmark_control));
 
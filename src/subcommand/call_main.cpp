@@ -28,6 +28,7 @@ using namespace vg::subcommand;
 
 void help_call(char** argv, ConfigurableParser& parser) {
     cerr << "usage: " << argv[0] << " call [options] <augmented-graph.vg> > output.vcf" << endl
+         << "       " << argv[0] << " call [options] -P <pack> -x <graph.xg> > output.vcf" << endl
          << "Output variant calls in VCF or Loci format given a graph and pileup" << endl
          << endl
          << "genotyper options:" << endl
@@ -125,18 +126,21 @@ int main_call(int argc, char** argv) {
     }
     thread_count = get_thread_count();
 
-    // Parse the arguments
-    if (optind >= argc) {
-        help_call(argv, parser);
-        return 1;
-    }
-    string graph_file_name = get_input_file_name(optind, argc, argv);
-
     if (string(support_caller.support_file_name).empty() ==
         string(support_caller.pack_file_name).empty()) {
         cerr << "[vg call]: Support file must be specified with either -s (or -P)" << endl;
         return 1;
     }
+
+    // Parse the arguments. With a pack, we can call straight from the xg
+    // index instead of the graph.
+    string graph_file_name;
+    if (optind < argc) {
+        graph_file_name = get_input_file_name(optind, argc, argv);
+    } else if (string(support_caller.pack_file_name).empty()) {
+        help_call(argv, parser);
+        return 1;
+    }
     
 
     if (string(support_caller.pack_file_name).empty() && translation_file_name.empty()) {
@@ -144,6 +148,25 @@ int main_call(int argc, char** argv) {
         return 1;
     }
 
+    if (!string(support_caller.checkpoint_dir).empty()) {
+        if (!(bool)support_caller.convert_to_vcf) {
+            cerr << "[vg call]: Checkpointing by region is only supported for VCF output" << endl;
+            return 1;
+        }
+        if ((size_t)support_caller.region_size == 0) {
+            cerr << "[vg call]: Region size must be 1 or larger" << endl;
+            return 1;
+        }
+        if ((size_t)support_caller.region_shards == 0 ||
+            (size_t)support_caller.region_shard >= (size_t)support_caller.region_shards) {
+            cerr << "[vg call]: Shard number must be less than the number of shards" << endl;
+            return 1;
+        }
+    } else if ((size_t)support_caller.region_shards != 1) {
+        cerr << "[vg call]: Splitting calling across shards requires a checkpoint directory" << endl;
+        return 1;
+    }
+
     // read the vcf and accompanying fasta files if specified
     if (!((string)(support_caller.recall_vcf_filename)).empty()) {
         if (support_caller.variant_offset != 0) {
@@ -168,14 +191,21 @@ int main_call(int argc, char** argv) {
         }
     }
     
+    SupportAugmentedGraph augmented_graph;
+
     // read the graph
-    if (show_progress) {
-        cerr << "Reading input graph" << endl;
+    if (!graph_file_name.empty()) {
+        if (show_progress) {
+            cerr << "Reading input graph" << endl;
+        }
+        VG* graph;
+        get_input_file(graph_file_name, [&](istream& in) {
+            graph = new VG(in);
+        });
+        // Move our input graph into the augmented graph
+        swap(augmented_graph.graph, *graph); 
+        delete graph;
     }
-    VG* graph;
-    get_input_file(graph_file_name, [&](istream& in) {
-        graph = new VG(in);
-    });
 
     // and the base graph
     VG* base_graph = NULL;
@@ -185,15 +215,11 @@ int main_call(int argc, char** argv) {
             });
     }
 
-    SupportAugmentedGraph augmented_graph;
-    // Move our input graph into the augmented graph
-    swap(augmented_graph.graph, *graph); 
-
     augmented_graph.base_graph = base_graph;
-    
-    delete graph;
 
-    // Load the supports
+    // Load the supports. If they come from a pack, the augmented graph reads
+    // them out of the index as it goes, so we need to keep the index around.
+    unique_ptr<PathPositionHandleGraph> xgidx;
     if (!string(support_caller.support_file_name).empty()) {
         ifstream support_file(support_caller.support_file_name);
         if (!support_file) {
@@ -208,8 +234,15 @@ int main_call(int argc, char** argv) {
             cerr << "[vg call]: pack support (-P) requires xg index (-x)" << endl;
             return 1;
         }
-        unique_ptr<PathPositionHandleGraph> xgidx = vg::io::VPKG::load_one<PathPositionHandleGraph>(support_caller.xg_file_name);
+        if (show_progress) {
+            cerr << "Reading xg index and pack" << endl;
+        }
+        xgidx = vg::io::VPKG::load_one<PathPositionHandleGraph>(support_caller.xg_file_name);
         augmented_graph.load_pack_as_supports(support_caller.pack_file_name, xgidx.get());
+        if (graph_file_name.empty()) {
+            // Without a graph, we call on the index itself
+            augmented_graph.handle_graph = xgidx.get();
+        }
         // make sure we're ignoring quality, as it's not read from the pack
         bool& usc = support_caller.use_support_count;
         usc = true;
@@ -235,7 +268,7 @@ int main_call(int argc, char** argv) {
         }
         snarl_manager = vg::io::VPKG::load_one<SnarlManager>(snarl_file);
     } else {
-        CactusSnarlFinder finder(augmented_graph.graph);
+        CactusSnarlFinder finder(augmented_graph.get_graph());
         snarl_manager = unique_ptr<SnarlManager>(new SnarlManager(std::move(finder.find_snarls())));
     }
     
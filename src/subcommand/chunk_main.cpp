@@ -8,6 +8,8 @@
 
 #include <string>
 #include <vector>
+#include <set>
+#include <algorithm>
 #include <regex>
 
 #include "subcommand.hpp"
@@ -29,6 +31,9 @@ using namespace vg::subcommand;
 static string chunk_name(const string& out_chunk_prefix, int i, const Region& region, string ext, int gi = 0);
 static int split_gam(istream& gam_stream, size_t chunk_size, const string& out_prefix,
                      size_t gam_buffer_size = 100);
+static void route_gam(istream& gam_stream, const vector<vector<pair<vg::id_t, vg::id_t>>>& chunk_id_ranges,
+                      const vector<string>& out_names, bool fully_contained,
+                      size_t batch_size = 10000, size_t flush_size = 1000);
 
 void help_chunk(char** argv) {
     cerr << "usage: " << argv[0] << " chunk [options] > [chunk.vg]" << endl
@@ -44,6 +49,8 @@ void help_chunk(char** argv) {
          << "    -G, --gbwt-name FILE     use this GBWT haplotype index for haplotype extraction" << endl
          << "    -a, --gam-name FILE      chunk this gam file (not stdin, sorted, with FILE.gai index) instead of the graph (multiple allowed)" << endl
          << "    -g, --gam-and-graph      when used in combination with -a, both gam and graph will be chunked" << endl 
+         << "    -O, --one-pass           with -a, route reads to all chunks in a single scan of each (sorted) gam" << endl
+         << "                             instead of querying its index once per chunk (no .gai required)" << endl
          << "path chunking:" << endl
          << "    -p, --path TARGET        write the chunk in the specified (0-based inclusive)\n"
          << "                             path range TARGET=path[:pos1[-pos2]] to standard output" << endl
@@ -99,6 +106,7 @@ int main_chunk(int argc, char** argv) {
     bool fully_contained = false;
     int n_chunks = 0;
     size_t gam_split_size = 0;
+    bool one_pass = false;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -126,11 +134,12 @@ int main_chunk(int argc, char** argv) {
             {"n-chunks", required_argument, 0, 'n'},
             {"context-length", required_argument, 0, 'l'},
             {"gam-split-size", required_argument, 0, 'm'},
+            {"one-pass", no_argument, 0, 'O'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:",
+        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:O",
                 long_options, &option_index);
 
 
@@ -213,6 +222,10 @@ int main_chunk(int argc, char** argv) {
             gam_split_size = parse<int>(optarg);
             break;
 
+        case 'O':
+            one_pass = true;
+            break;
+
         case 'T':
             trace = true;
             break;
@@ -245,8 +258,8 @@ int main_chunk(int argc, char** argv) {
         return 1;
     }
     // need -a if using -f
-    if ((gam_split_size != 0 || fully_contained) && gam_files.empty()) {
-        cerr << "error:[vg chunk] gam file must be specified with -a when using -f or -m" << endl;
+    if ((gam_split_size != 0 || fully_contained || one_pass) && gam_files.empty()) {
+        cerr << "error:[vg chunk] gam file must be specified with -a when using -f, -m or -O" << endl;
         return 1;
     }
     // context steps default to 1 if using id_ranges.  otherwise, force user to specify to avoid
@@ -305,7 +318,7 @@ int main_chunk(int argc, char** argv) {
     
     // We need an index on the GAM to chunk it
     vector<unique_ptr<GAMIndex>> gam_indexes;
-    if (chunk_gam) {
+    if (chunk_gam && !one_pass) {
         for (auto gam_file : gam_files) {
             get_input_file(gam_file + ".gai", [&](istream& index_stream) {
                     gam_indexes.push_back(unique_ptr<GAMIndex>(new GAMIndex()));
@@ -488,7 +501,11 @@ int main_chunk(int argc, char** argv) {
     vector<list<ifstream>> gam_streams_vec(gam_files.size());
     vector<vector<GAMIndex::cursor_t>> cursors_vec(gam_files.size());
     
-    if (chunk_gam) {
+    // In one-pass mode we just remember the ID ranges of each chunk, and route
+    // the reads to all of them in one scan after the chunks are known.
+    vector<vector<pair<vg::id_t, vg::id_t>>> chunk_id_ranges(one_pass ? num_regions : 0);
+    
+    if (chunk_gam && !one_pass) {
         for (size_t gam_i = 0; gam_i < gam_streams_vec.size(); ++gam_i) {
             auto& gam_file = gam_files[gam_i];
             auto& gam_streams = gam_streams_vec[gam_i];
@@ -580,7 +597,13 @@ int main_chunk(int argc, char** argv) {
         }
         
         // optional gam chunking
-        if (chunk_gam) {
+        if (chunk_gam && one_pass) {
+            if (subgraph != NULL) {
+                chunk_id_ranges[i] = vg::algorithms::sorted_id_ranges(subgraph);
+            } else {
+                chunk_id_ranges[i] = {{region.start, region.end}};
+            }
+        } else if (chunk_gam) {
             for (size_t gi = 0; gi < gam_indexes.size(); ++gi) {
                 auto& gam_index = gam_indexes[gi];
                 assert(gam_index.get() != nullptr);
@@ -624,6 +647,21 @@ int main_chunk(int argc, char** argv) {
 
         delete subgraph;
     }
+    
+    if (chunk_gam && one_pass) {
+        for (size_t gi = 0; gi < gam_files.size(); ++gi) {
+            vector<string> gam_names(num_regions);
+            for (int i = 0; i < num_regions; ++i) {
+                gam_names[i] = chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi);
+            }
+            ifstream gam_stream(gam_files[gi]);
+            if (!gam_stream) {
+                cerr << "error[vg chunk]: unable to open GAM file " << gam_files[gi] << endl;
+                return 1;
+            }
+            route_gam(gam_stream, chunk_id_ranges, gam_names, fully_contained);
+        }
+    }
         
     // write a bed file if asked giving a more explicit linking of chunks to files
     if (!out_bed_file.empty()) {
@@ -689,3 +727,161 @@ int split_gam(istream& gam_stream, size_t chunk_size, const string& out_prefix,
     return 0;
 }
 
+// Scan a GAM once, writing each read to every chunk whose ID ranges it touches
+// (or that contain all of its nodes, if fully_contained is set). Reads are
+// routed in parallel in batches, and kept in per-chunk buffers that are
+// appended to the chunk files, in parallel across chunks, whenever they fill
+// up. Reads keep their input order within each chunk.
+void route_gam(istream& gam_stream, const vector<vector<pair<vg::id_t, vg::id_t>>>& chunk_id_ranges,
+               const vector<string>& out_names, bool fully_contained,
+               size_t batch_size, size_t flush_size) {
+    
+    size_t num_chunks = chunk_id_ranges.size();
+    
+    // Cut the ID space into segments at every range boundary, and record the
+    // chunks covering each segment, so a node's chunks are a binary search away.
+    vector<pair<vg::id_t, int64_t>> boundaries;
+    for (size_t c = 0; c < num_chunks; c++) {
+        for (auto& range : chunk_id_ranges[c]) {
+            // Encode range starts as c + 1 and past-ends as -(c + 1)
+            boundaries.emplace_back(range.first, (int64_t) c + 1);
+            boundaries.emplace_back(range.second + 1, -((int64_t) c + 1));
+        }
+    }
+    sort(boundaries.begin(), boundaries.end());
+    
+    vector<vg::id_t> segment_starts;
+    vector<vector<size_t>> segment_chunks;
+    vector<size_t> coverage(num_chunks, 0);
+    set<size_t> active;
+    for (size_t i = 0; i < boundaries.size(); ) {
+        vg::id_t here = boundaries[i].first;
+        for (; i < boundaries.size() && boundaries[i].first == here; i++) {
+            if (boundaries[i].second > 0) {
+                size_t c = boundaries[i].second - 1;
+                if (coverage[c]++ == 0) {
+                    active.insert(c);
+                }
+            } else {
+                size_t c = -boundaries[i].second - 1;
+                if (--coverage[c] == 0) {
+                    active.erase(c);
+                }
+            }
+        }
+        segment_starts.push_back(here);
+        segment_chunks.emplace_back(active.begin(), active.end());
+    }
+    
+    // Get the sorted chunks covering a node
+    const vector<size_t> no_chunks;
+    auto chunks_of = [&](vg::id_t id) -> const vector<size_t>& {
+        auto found = upper_bound(segment_starts.begin(), segment_starts.end(), id);
+        if (found == segment_starts.begin()) {
+            return no_chunks;
+        }
+        return segment_chunks[found - segment_starts.begin() - 1];
+    };
+    
+    vector<vector<Alignment>> buffers(num_chunks);
+    // Whether each chunk file has been started yet. Not a vector<bool>, since
+    // different chunks are flushed from different threads.
+    vector<uint8_t> started(num_chunks, 0);
+    
+    // Append the buffers for the given chunks to their files
+    auto flush = [&](const vector<size_t>& to_flush) {
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t j = 0; j < to_flush.size(); j++) {
+            size_t c = to_flush[j];
+            ofstream out_file(out_names[c], started[c] ? (ios::binary | ios::app) : (ios::binary | ios::trunc));
+            if (!out_file) {
+#pragma omp critical (cerr)
+                cerr << "error[vg chunk]: can't open output gam file " << out_names[c] << endl;
+                exit(1);
+            }
+            vg::io::write_buffered(out_file, buffers[c], 0);
+            buffers[c].clear();
+            started[c] = 1;
+        }
+    };
+    
+    vector<Alignment> batch;
+    batch.reserve(batch_size);
+    vector<vector<size_t>> destinations;
+    
+    auto route_batch = [&]() {
+        destinations.resize(batch.size());
+        
+#pragma omp parallel for
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto& dest = destinations[i];
+            dest.clear();
+            
+            vector<vg::id_t> ids;
+            IDScanner<Alignment>::scan(batch[i], [&](const vg::id_t& id) {
+                ids.push_back(id);
+                return true;
+            });
+            sort(ids.begin(), ids.end());
+            ids.erase(unique(ids.begin(), ids.end()), ids.end());
+            
+            for (size_t k = 0; k < ids.size(); k++) {
+                auto& here = chunks_of(ids[k]);
+                if (!fully_contained) {
+                    // Take the union over all the nodes
+                    dest.insert(dest.end(), here.begin(), here.end());
+                } else if (k == 0) {
+                    dest = here;
+                } else {
+                    // Take the intersection over all the nodes
+                    vector<size_t> kept;
+                    set_intersection(dest.begin(), dest.end(), here.begin(), here.end(), back_inserter(kept));
+                    dest = std::move(kept);
+                }
+                if (fully_contained && dest.empty()) {
+                    break;
+                }
+            }
+            if (!fully_contained) {
+                sort(dest.begin(), dest.end());
+                dest.erase(unique(dest.begin(), dest.end()), dest.end());
+            }
+        }
+        
+        // Distribute the reads in input order, and flush any full buffers
+        vector<size_t> full;
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto& dest = destinations[i];
+            for (size_t k = 0; k < dest.size(); k++) {
+                auto& buffer = buffers[dest[k]];
+                if (k + 1 == dest.size()) {
+                    buffer.emplace_back(std::move(batch[i]));
+                } else {
+                    buffer.push_back(batch[i]);
+                }
+                if (buffer.size() == flush_size) {
+                    full.push_back(dest[k]);
+                }
+            }
+        }
+        flush(full);
+        batch.clear();
+    };
+    
+    vg::io::for_each<Alignment>(gam_stream, [&](Alignment& alignment) {
+        batch.emplace_back(std::move(alignment));
+        if (batch.size() >= batch_size) {
+            route_batch();
+        }
+    });
+    route_batch();
+    
+    // Flush everything left, and make sure every chunk has a (possibly empty) file
+    vector<size_t> remaining;
+    for (size_t c = 0; c < num_chunks; c++) {
+        if (!buffers[c].empty() || !started[c]) {
+            remaining.push_back(c);
+        }
+    }
+    flush(remaining);
+}
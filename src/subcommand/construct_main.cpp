@@ -280,10 +280,8 @@ int main_construct(int argc, char** argv) {
             }
         }
         
-        // This will own all the VCF files
-        vector<unique_ptr<vcflib::VariantCallFile>> variant_files;
         for (auto& vcf_filename : vcf_filenames) {
-            // Make sure each VCF file exists. Otherwise Tabix++ may exit with a non-
+            // Make sure each VCF file exists. Otherwise htslib may exit with a non-
             // helpful message.
             
             // We can't invoke stat woithout a place for it to write. But all we
@@ -293,14 +291,6 @@ int main_construct(int argc, char** argv) {
                 cerr << "error:[vg construct] file \"" << vcf_filename << "\" not found" << endl;
                 return 1;
             }
-            vcflib::VariantCallFile* variant_file = new vcflib::VariantCallFile();
-            variant_file->parseSamples = false; // Major speedup if there are many samples.
-            variant_files.emplace_back(variant_file);
-            variant_file->open(vcf_filename);
-            if (!variant_file->is_open()) {
-                cerr << "error:[vg construct] could not open" << vcf_filename << endl;
-                return 1;
-            }
         }
         
         if (fasta_filenames.empty()) {
@@ -324,10 +314,6 @@ int main_construct(int argc, char** argv) {
         }
         
         // Make vectors of just bare pointers
-        vector<vcflib::VariantCallFile*> vcf_pointers;
-        for(auto& vcf : variant_files) {
-            vcf_pointers.push_back(vcf.get());
-        }
         vector<FastaReference*> fasta_pointers;
         for(auto& fasta : references) {
             fasta_pointers.push_back(fasta.get());
@@ -342,8 +328,10 @@ int main_construct(int argc, char** argv) {
             exit(1);
         }
         
-        // Construct the graph.
-        constructor.construct_graph(fasta_pointers, vcf_pointers,
+        // Construct the graph. The Constructor reads the VCFs itself through
+        // htslib, skipping the sample columns, which is a major speedup if
+        // there are many samples.
+        constructor.construct_graph(fasta_pointers, vcf_filenames,
                                     ins_pointers, callback);
                                     
         // The output will be flushed when the ProtobufEmitter we use in the callback goes away.
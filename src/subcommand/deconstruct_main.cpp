@@ -14,6 +14,7 @@
 
 #include "../vg.hpp"
 #include "../deconstructor.hpp"
+#include "../gbwt_helper.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 
@@ -30,6 +31,7 @@ void help_deconstruct(char** argv){
          << "    -A, --alt-prefix NAME  Non-reference paths beginning with NAME get lumped together to same sample in VCF (comma-separated list accepted)." << endl
          << "    -r, --snarls FILE      Snarls file (from vg snarls) to avoid recomputing." << endl
          << "    -e, --path-traversals  Only consider traversals that correspond to paths in the grpah." << endl
+         << "    -g, --gbwt FILE        Consider the traversals of the haplotypes in this GBWT, and genotype its samples." << endl
          << "    -t, --threads N        Use N threads" << endl
          << "    -v, --verbose          Print some status messages" << endl
          << endl;
@@ -46,6 +48,7 @@ int main_deconstruct(int argc, char** argv){
     vector<string> altpath_prefixes;
     string graphname;
     string snarl_file_name;
+    string gbwt_file_name;
     bool path_restricted_traversals = false;
     bool show_progress = false;
     
@@ -60,6 +63,7 @@ int main_deconstruct(int argc, char** argv){
                 {"alt-prefix", required_argument, 0, 'A'},
                 {"snarls", required_argument, 0, 'r'},
                 {"path-traversals", no_argument, 0, 'e'},
+                {"gbwt", required_argument, 0, 'g'},
                 {"threads", required_argument, 0, 't'},
                 {"verbose", no_argument, 0, 'v'},
                 {0, 0, 0, 0}
@@ -67,7 +71,7 @@ int main_deconstruct(int argc, char** argv){
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp:P:A:r:et:v",
+        c = getopt_long (argc, argv, "hp:P:A:r:eg:t:v",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -91,6 +95,9 @@ int main_deconstruct(int argc, char** argv){
         case 'e':
             path_restricted_traversals = true;
             break;
+        case 'g':
+            gbwt_file_name = optarg;
+            break;
         case 't':
             omp_set_num_threads(parse<int>(optarg));
             break;
@@ -116,6 +123,11 @@ int main_deconstruct(int argc, char** argv){
     if (!altpath_prefixes.empty() && !path_restricted_traversals) {
         cerr << "Error [vg decontruct]: -A can only be used with -e" << endl;
     }
+
+    if (!altpath_prefixes.empty() && !gbwt_file_name.empty()) {
+        cerr << "Error [vg deconstruct]: -A cannot be used with -g" << endl;
+        return 1;
+    }
     
     // Read the graph
     unique_ptr<PathPositionHandleGraph> graph;
@@ -143,6 +155,24 @@ int main_deconstruct(int argc, char** argv){
         snarl_manager = unique_ptr<SnarlManager>(new SnarlManager(std::move(finder.find_snarls())));
     }
 
+    // Load the haplotypes
+    unique_ptr<gbwt::GBWT> gbwt_index;
+    if (!gbwt_file_name.empty()) {
+        if (show_progress) {
+            cerr << "Loading GBWT" << endl;
+        }
+        gbwt_index = vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_file_name);
+        if (gbwt_index.get() == nullptr) {
+            cerr << "Error [vg deconstruct]: Unable to load GBWT file: " << gbwt_file_name << endl;
+            return 1;
+        }
+        if (!gbwt_index->hasMetadata() || !gbwt_index->metadata.hasSampleNames() ||
+            !gbwt_index->metadata.hasPathNames()) {
+            cerr << "Error [vg deconstruct]: GBWT must have sample and path names to be used for genotypes" << endl;
+            return 1;
+        }
+    }
+
     // We use this to map, for example, from chromosome to genome (eg S288C.chrXVI --> S288C)
     unordered_map<string, string> alt_path_to_prefix;
     
@@ -185,7 +215,8 @@ int main_deconstruct(int argc, char** argv){
         cerr << "Decsontructing top-level snarls" << endl;
     }
     dd.deconstruct(refpaths, graph.get(), snarl_manager.get(), path_restricted_traversals,
-                   !alt_path_to_prefix.empty() ? &alt_path_to_prefix : nullptr);
+                   !alt_path_to_prefix.empty() ? &alt_path_to_prefix : nullptr,
+                   gbwt_index.get());
     return 0;
 }
 
@@ -39,6 +39,8 @@ void help_find(char** argv) {
          << "    -l, --sorted-gam FILE  use this sorted, indexed GAM file" << endl
          << "    -a, --alignments       write all alignments from input sorted GAM or RocksDB" << endl
          << "    -o, --alns-on N:M      write alignments which align to any of the nodes between N and M (inclusive)" << endl
+         << "    -b, --alns-batch FILE  write alignments for a batch of queries, one per line of N:M ranges or node IDs," << endl
+         << "                           in one pass over the sorted GAM, each alignment once (- for stdin)" << endl
          << "    -A, --to-graph VG      get alignments to the provided subgraph" << endl
          << "sequences:" << endl
          << "    -g, --gcsa FILE        use this GCSA2 index of the sequence space of the graph" << endl
@@ -90,6 +92,7 @@ int main_find(int argc, char** argv) {
     bool get_alignments = false;
     bool get_mappings = false;
     string aln_on_id_range;
+    string aln_batch_file;
     vg::id_t start_id = 0;
     vg::id_t end_id = 0;
     bool pairwise_distance = false;
@@ -136,6 +139,7 @@ int main_find(int argc, char** argv) {
                 {"alignments", no_argument, 0, 'a'},
                 {"mappings", no_argument, 0, 'm'},
                 {"alns-on", required_argument, 0, 'o'},
+                {"alns-batch", required_argument, 0, 'b'},
                 {"distance", no_argument, 0, 'D'},
                 {"gam", required_argument, 0, 'G'},
                 {"to-graph", required_argument, 0, 'A'},
@@ -147,7 +151,7 @@ int main_find(int argc, char** argv) {
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "d:x:n:e:s:o:k:hc:LS:z:j:CTp:P:r:l:amg:M:B:fDG:N:A:Y:Z:IQ:E:",
+        c = getopt_long (argc, argv, "d:x:n:e:s:o:b:k:hc:LS:z:j:CTp:P:r:l:amg:M:B:fDG:N:A:Y:Z:IQ:E:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -275,6 +279,10 @@ int main_find(int argc, char** argv) {
             aln_on_id_range = optarg;
             break;
 
+        case 'b':
+            aln_batch_file = optarg;
+            break;
+
         case 'D':
             pairwise_distance = true;
             break;
@@ -481,6 +489,44 @@ int main_find(int argc, char** argv) {
         
     }
 
+    if (!aln_batch_file.empty()) {
+        // Answer a whole batch of range queries against the sorted GAM
+        if (gam_index.get() == nullptr) {
+            cerr << "error [vg find]: Cannot find alignments for a query batch without a sorted GAM" << endl;
+            exit(1);
+        }
+
+        // Parse all the queries up front so their ranges can be merged
+        vector<vector<pair<vg::id_t, vg::id_t>>> queries;
+        get_input_file(aln_batch_file, [&](istream& in) {
+            string line;
+            while (getline(in, line)) {
+                vector<pair<vg::id_t, vg::id_t>> query;
+                for (auto& item : split_delims(line, " \t")) {
+                    vector<string> parts = split_delims(item, ":");
+                    vg::id_t first, last;
+                    convert(parts.front(), first);
+                    convert(parts.back(), last);
+                    query.emplace_back(first, last);
+                }
+                if (!query.empty()) {
+                    queries.emplace_back(std::move(query));
+                }
+            }
+        });
+
+        get_input_file(sorted_gam_name, [&](istream& in) {
+            // Keep one cursor and decoded group cache for the whole batch
+            vg::io::ProtobufIterator<Alignment> cursor(in);
+            GAMIndexSession session(*gam_index, cursor);
+
+            auto emit = vg::io::emit_to<Alignment>(cout);
+            session.find_batch(queries, [&](const vector<size_t>& matched, const Alignment& aln) {
+                emit(aln);
+            });
+        });
+    }
+
     if (!xg_name.empty()) {
         if (!node_ids.empty() && path_name.empty() && !pairwise_distance) {
             VG graph;
@@ -7,17 +7,120 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <mutex>
+#include <unordered_map>
+#include <deque>
 
 #include <subcommand.hpp>
 
 #include "../alignment.hpp"
 #include "../vg.hpp"
 #include <vg/io/stream.hpp>
+#include <vg/io/protobuf_iterator.hpp>
 
 using namespace std;
 using namespace vg;
 using namespace vg::subcommand;
 
+/**
+ * The true positions of a read, as (path number, offset, is_reverse) entries.
+ * Path names are stored once, in a TruthTable, instead of once per read.
+ */
+using CompactTruth = vector<tuple<uint32_t, size_t, bool>>;
+
+/**
+ * Concurrent table from read name to true positions, for truth sets too big to
+ * load under a single lock. Reads are spread over independently locked shards
+ * by name hash.
+ */
+class TruthTable {
+public:
+    
+    TruthTable(size_t shard_count = 256) : shards(shard_count), known_numbers(get_thread_count()) {
+        // Nothing to do
+    }
+    
+    /// Record the true positions of the given read. Thread safe.
+    void insert(const Alignment& aln) {
+        CompactTruth truth;
+        truth.reserve(aln.refpos_size());
+        for (auto& refpos : aln.refpos()) {
+            truth.emplace_back(get_path_number(refpos.name()), refpos.offset(), refpos.is_reverse());
+        }
+        
+        auto& shard = shard_for(aln.name());
+        lock_guard<mutex> guard(shard.lock);
+        shard.table[aln.name()] = std::move(truth);
+    }
+    
+    /// Get the true positions of the named read in the format
+    /// alignment_set_distance_to_correct() wants, and return true, or return
+    /// false if the read is not in the table. Safe to call from multiple
+    /// threads once all insert() calls are done.
+    bool find(const string& name, map<string, vector<pair<size_t, bool>>>& offsets_out) const {
+        auto& shard = shard_for(name);
+        auto found = shard.table.find(name);
+        if (found == shard.table.end()) {
+            return false;
+        }
+        offsets_out.clear();
+        for (auto& entry : found->second) {
+            offsets_out[path_names[get<0>(entry)]].emplace_back(get<1>(entry), get<2>(entry));
+        }
+        return true;
+    }
+    
+private:
+    
+    struct Shard {
+        mutex lock;
+        string_hash_map<string, CompactTruth> table;
+    };
+    
+    Shard& shard_for(const string& name) {
+        return shards[hash<string>()(name) % shards.size()];
+    }
+    
+    const Shard& shard_for(const string& name) const {
+        return shards[hash<string>()(name) % shards.size()];
+    }
+    
+    /// Get the number for a path name, assigning one if needed.
+    uint32_t get_path_number(const string& path_name) {
+        // There are few paths, so each thread keeps its own copy of the
+        // numbering and only takes the lock for names it hasn't seen.
+        auto& thread_numbers = known_numbers.at(omp_get_thread_num());
+        auto found = thread_numbers.find(path_name);
+        if (found != thread_numbers.end()) {
+            return found->second;
+        }
+        
+        uint32_t number;
+        {
+            lock_guard<mutex> guard(path_names_lock);
+            auto assigned = path_numbers.find(path_name);
+            if (assigned == path_numbers.end()) {
+                number = path_names.size();
+                path_numbers[path_name] = number;
+                path_names.push_back(path_name);
+            } else {
+                number = assigned->second;
+            }
+        }
+        thread_numbers[path_name] = number;
+        return number;
+    }
+    
+    vector<Shard> shards;
+    
+    /// Each thread's cache of path numbers
+    vector<unordered_map<string, uint32_t>> known_numbers;
+    
+    mutex path_names_lock;
+    unordered_map<string, uint32_t> path_numbers;
+    vector<string> path_names;
+};
+
 void help_gamcompare(char** argv) {
     cerr << "usage: " << argv[0] << " gamcompare aln.gam truth.gam >output.gam" << endl
          << endl
@@ -25,6 +128,9 @@ void help_gamcompare(char** argv) {
          << "    -r, --range N            distance within which to consider reads correct" << endl
          << "    -T, --tsv                output TSV (correct, mq, aligner, read) comaptible with plot-qq.R instead of GAM" << endl
          << "    -a, --aligner            aligner name for TSV output [\"vg\"]" << endl
+         << "    -s, --same-order         the reads under test appear in the same order as in the truth (as" << endl
+         << "                             when both are sorted by name); compare them in a single streaming pass" << endl
+         << "                             (reads not found in the truth are passed through unannotated)" << endl
          << "    -t, --threads N          number of threads to use" << endl;
 }
 
@@ -39,6 +145,7 @@ int main_gamcompare(int argc, char** argv) {
     int64_t range = -1;
     bool output_tsv = false;
     string aligner_name = "vg";
+    bool same_order = false;
 
     int c;
     optind = 2;
@@ -49,12 +156,13 @@ int main_gamcompare(int argc, char** argv) {
             {"range", required_argument, 0, 'r'},
             {"tsv", no_argument, 0, 'T'},
             {"aligner", required_argument, 0, 'a'},
+            {"same-order", no_argument, 0, 's'},
             {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hr:Ta:t:",
+        c = getopt_long (argc, argv, "hr:Ta:st:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -74,6 +182,10 @@ int main_gamcompare(int argc, char** argv) {
         case 'a':
             aligner_name = optarg;
             break;
+            
+        case 's':
+            same_order = true;
+            break;
 
         case 't':
             threads = parse<int>(optarg);
@@ -95,34 +207,26 @@ int main_gamcompare(int argc, char** argv) {
     string test_file_name = get_input_file_name(optind, argc, argv);
     string truth_file_name = get_input_file_name(optind, argc, argv);
 
-    // We will collect all the truth positions
-    string_hash_map<string, map<string ,vector<pair<size_t, bool> > > > true_positions;
-    function<void(Alignment&)> record_truth = [&true_positions](Alignment& aln) {
-        auto val = alignment_refpos_to_path_offsets(aln);
-#pragma omp critical (truth_table)
-        true_positions[aln.name()] = val;
-    };
+    if (test_file_name == "-" && truth_file_name == "-") {
+        cerr << "error[vg gamcompare]: Standard input can only be used for truth or test file, not both" << endl;
+        exit(1);
+    }
     
-    if (truth_file_name == "-") {
-        // Read truth fropm standard input, if it looks good.
-        if (test_file_name == "-") {
-            cerr << "error[vg gamcompare]: Standard input can only be used for truth or test file, not both" << endl;
-            exit(1);
-        }
-        if (!std::cin) {
-            cerr << "error[vg gamcompare]: Unable to read standard input when looking for true reads" << endl;
-            exit(1);
+    // Open an input file or standard input, or fail
+    auto open_input = [](const string& file_name, const string& purpose) {
+        unique_ptr<ifstream> file_in;
+        if (file_name != "-") {
+            file_in.reset(new ifstream(file_name));
         }
-        vg::io::for_each_parallel(std::cin, record_truth);
-    } else {
-        // Read truth from this file, if it looks good.
-        ifstream truth_file_in(truth_file_name);
-        if (!truth_file_in) {
-            cerr << "error[vg gamcompare]: Unable to read " << truth_file_name << " when looking for true reads" << endl;
+        istream& in = file_in ? *file_in : std::cin;
+        if (!in) {
+            cerr << "error[vg gamcompare]: Unable to read "
+                 << (file_name == "-" ? string("standard input") : file_name)
+                 << " when looking for " << purpose << endl;
             exit(1);
         }
-        vg::io::for_each_parallel(truth_file_in, record_truth);
-    }
+        return file_in;
+    };
 
     // We have a buffered emitter for annotated alignments, if we're not outputting text
     std::unique_ptr<vg::io::ProtobufEmitter<Alignment>> emitter;
@@ -156,54 +260,145 @@ int main_gamcompare(int argc, char** argv) {
    
     // We want to count correct reads
     vector<size_t> correct_counts(get_thread_count(), 0);
-   
-    // This function annotates every read with distance and correctness, and batch-outputs them.
-    function<void(Alignment&)> annotate_test = [&](Alignment& aln) {
-        auto f = true_positions.find(aln.name());
-        if (f != true_positions.end()) {
-            auto& true_position = f->second;
-            alignment_set_distance_to_correct(aln, true_position);
+    
+    // This function annotates a read with distance and correctness, given its true positions.
+    auto annotate_with_truth = [&](Alignment& aln, const map<string, vector<pair<size_t, bool>>>& true_position) {
+        alignment_set_distance_to_correct(aln, true_position);
+        
+        if (range != -1) {
+            // We are flagging reads correct/incorrect.
+            // It is correct if there is a path for its minimum distance and it is in range on that path.
+            bool correctly_mapped = (aln.to_correct().name() != "" && aln.to_correct().offset() <= range);
             
-            if (range != -1) {
-                // We are flagging reads correct/incorrect.
-                // It is correct if there is a path for its minimum distance and it is in range on that path.
-                bool correctly_mapped = (aln.to_correct().name() != "" && aln.to_correct().offset() <= range);
-                
-                // Annotate it as such
-                aln.set_correctly_mapped(correctly_mapped);
-                
-                if (correctly_mapped) {
-                    correct_counts.at(omp_get_thread_num()) += 1;
-                }
-            }
+            // Annotate it as such
+            aln.set_correctly_mapped(correctly_mapped);
             
+            if (correctly_mapped) {
+                correct_counts.at(omp_get_thread_num()) += 1;
+            }
         }
-#pragma omp critical
-        {
-            if (output_tsv) {
-                text_buffer.emplace_back(std::move(aln));
-                if (text_buffer.size() > 1000) {
-                    flush_text_buffer();
-                }
-            } else {
-                emitter->write(std::move(aln));
+    };
+    
+    // This function batch-outputs annotated reads. Must be called in a critical section.
+    auto output_annotated = [&](Alignment& aln) {
+        if (output_tsv) {
+            text_buffer.emplace_back(std::move(aln));
+            if (text_buffer.size() > 1000) {
+                flush_text_buffer();
             }
+        } else {
+            emitter->write(std::move(aln));
         }
     };
-
-    if (test_file_name == "-") {
-        if (!std::cin) {
-            cerr << "error[vg gamcompare]: Unable to read standard input when looking for reads under test" << endl;
-            exit(1);
+    
+    if (same_order) {
+        // Walk the truth alongside the reads under test, so we never have to
+        // hold more than a batch of either.
+        auto truth_file_in = open_input(truth_file_name, "true reads");
+        auto test_file_in = open_input(test_file_name, "reads under test");
+        
+        vg::io::ProtobufIterator<Alignment> truth_cursor(truth_file_in ? *truth_file_in : std::cin);
+        
+        // True positions for reads we have read past in the truth but not yet
+        // matched, in file order, so that a read missing from the truth
+        // doesn't make us lose the true reads after it. The index maps read
+        // names to positions counted from the start of the truth.
+        deque<pair<string, map<string, vector<pair<size_t, bool>>>>> truth_window;
+        unordered_map<string, size_t> truth_window_index;
+        size_t truth_window_start = 0;
+        // Reads under test with no truth, which are passed through unannotated
+        size_t missing_truth = 0;
+        
+        // Reads under test, and the true positions for each of them if found
+        vector<Alignment> test_batch;
+        vector<map<string, vector<pair<size_t, bool>>>> truth_batch;
+        vector<bool> truth_found;
+        size_t batch_size = 1000 * get_thread_count();
+        
+        auto process_batch = [&]() {
+#pragma omp parallel for
+            for (size_t i = 0; i < test_batch.size(); i++) {
+                if (truth_found[i]) {
+                    annotate_with_truth(test_batch[i], truth_batch[i]);
+                }
+            }
+            for (auto& aln : test_batch) {
+                output_annotated(aln);
+            }
+            test_batch.clear();
+            truth_batch.clear();
+            truth_found.clear();
+        };
+        
+        function<void(Alignment&)> join_test = [&](Alignment& aln) {
+            auto found = truth_window_index.find(aln.name());
+            while (found == truth_window_index.end() && truth_cursor.has_current()) {
+                // Read ahead in the truth until we find this read
+                Alignment truth = truth_cursor.take();
+                size_t index = truth_window_start + truth_window.size();
+                truth_window.emplace_back(truth.name(), alignment_refpos_to_path_offsets(truth));
+                auto inserted = truth_window_index.emplace(truth.name(), index);
+                if (truth.name() == aln.name()) {
+                    found = inserted.first;
+                }
+            }
+            
+            if (found == truth_window_index.end()) {
+                // Pass it through like we would if the reads were unordered
+                missing_truth++;
+                truth_batch.emplace_back();
+                truth_found.push_back(false);
+            } else {
+                // Everything before the match is truth for reads not under test
+                size_t index = found->second;
+                while (truth_window_start < index) {
+                    truth_window_index.erase(truth_window.front().first);
+                    truth_window.pop_front();
+                    truth_window_start++;
+                }
+                truth_batch.emplace_back(std::move(truth_window.front().second));
+                truth_found.push_back(true);
+                truth_window_index.erase(truth_window.front().first);
+                truth_window.pop_front();
+                truth_window_start++;
+            }
+            test_batch.emplace_back(std::move(aln));
+            
+            if (test_batch.size() >= batch_size) {
+                process_batch();
+            }
+        };
+        vg::io::for_each(test_file_in ? *test_file_in : std::cin, join_test);
+        process_batch();
+        
+        if (missing_truth != 0) {
+            cerr << "warning[vg gamcompare]: " << missing_truth << " reads under test were not found in the true reads "
+                 << "after the previous read, and were not annotated" << endl;
         }
-        vg::io::for_each_parallel(std::cin, annotate_test);
     } else {
-        ifstream test_file_in(test_file_name);
-        if (!test_file_in) {
-            cerr << "error[vg gamcompare]: Unable to read " << test_file_name << " when looking for reads under test" << endl;
-            exit(1);
-        }
-        vg::io::for_each_parallel(test_file_in, annotate_test);
+        // We will collect all the truth positions
+        TruthTable true_positions;
+        function<void(Alignment&)> record_truth = [&true_positions](Alignment& aln) {
+            true_positions.insert(aln);
+        };
+        
+        // Read truth from the file, or standard input
+        auto truth_file_in = open_input(truth_file_name, "true reads");
+        vg::io::for_each_parallel(truth_file_in ? *truth_file_in : std::cin, record_truth);
+        truth_file_in.reset();
+        
+        // This function annotates every read with distance and correctness, and batch-outputs them.
+        function<void(Alignment&)> annotate_test = [&](Alignment& aln) {
+            map<string, vector<pair<size_t, bool>>> true_position;
+            if (true_positions.find(aln.name(), true_position)) {
+                annotate_with_truth(aln, true_position);
+            }
+#pragma omp critical
+            output_annotated(aln);
+        };
+        
+        auto test_file_in = open_input(test_file_name, "reads under test");
+        vg::io::for_each_parallel(test_file_in ? *test_file_in : std::cin, annotate_test);
     }
 
     if (output_tsv) {
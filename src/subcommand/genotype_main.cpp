@@ -21,6 +21,8 @@ void help_genotype(char** argv) {
          << "    -j, --json              output in JSON" << endl
          << "    -v, --vcf               output in VCF" << endl
          << "    -G, --gam   GAM         a GAM file to use with variant recall (or in place of index)" << endl
+         << "    -S, --sorted-gam GAM    stream the reads for each snarl from a sorted GAM with a .gai index" << endl
+         << "                            (in place of index; graph must already be augmented with the reads)" << endl
          << "    -V, --recall-vcf VCF    recall variants in a specific VCF file." << endl
          << "    -F, --fasta  FASTA" << endl
          << "    -I, --insertions INS" << endl
@@ -74,6 +76,7 @@ int main_genotype(int argc, char** argv) {
     // based on this VCF and GAM, then exit?
     string recall_vcf;
     string gam_file;
+    string sorted_gam_file;
     string fasta;
     string insertions_file;
     bool useindex = true;
@@ -113,6 +116,7 @@ int main_genotype(int argc, char** argv) {
                 {"threads", required_argument, 0, 't'},
                 {"recall-vcf", required_argument, 0, 'V'},
                 {"gam", required_argument, 0, 'G'},
+                {"sorted-gam", required_argument, 0, 'S'},
                 {"fasta", required_argument, 0, 'F'},
                 {"insertions", required_argument, 0, 'I'},
                 {"call", no_argument, 0, 'z'},
@@ -122,7 +126,7 @@ int main_genotype(int argc, char** argv) {
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hjvr:c:s:o:l:a:QAd:P:pt:V:I:G:F:zET:",
+        c = getopt_long (argc, argv, "hjvr:c:s:o:l:a:QAd:P:pt:V:I:G:S:F:zET:",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -199,6 +203,10 @@ int main_genotype(int argc, char** argv) {
             gam_file = optarg;
             useindex = false;
             break;
+        case 'S':
+            sorted_gam_file = optarg;
+            useindex = false;
+            break;
         case 'E':
             embed_gam_edits = false;
             break;
@@ -247,11 +255,17 @@ int main_genotype(int argc, char** argv) {
         reads_index_name = get_input_file_name(optind, argc, argv);
 
     } else {
-        if (gam_file.empty()) {
-            cerr << "[vg genotype] Index argument must be specified when not using -G" << endl;
+        if (gam_file.empty() && sorted_gam_file.empty()) {
+            cerr << "[vg genotype] Index argument must be specified when not using -G or -S" << endl;
             return 1;
         }
     }
+
+    if (!sorted_gam_file.empty() && (!gam_file.empty() || !reads_index_name.empty() ||
+                                     !recall_vcf.empty() || !augmented_file_name.empty())) {
+        cerr << "[vg genotype] -S cannot be used with a reads index, -G, -V or -a" << endl;
+        return 1;
+    }
     
     // This holds the RocksDB index that has all our reads, indexed by the nodes they visit.
     Index index;
@@ -284,6 +298,61 @@ int main_genotype(int argc, char** argv) {
 
     }
 
+    // Make a Genotyper to do the genotyping
+    Genotyper genotyper;
+    // Configure it
+    genotyper.use_mapq = use_mapq;
+    genotyper.realign_indels = realign_indels;
+    assert(het_prior_denominator > 0);
+    genotyper.het_prior_logprob = prob_to_logprob(1.0/het_prior_denominator);
+    genotyper.min_unique_per_strand = min_unique_per_strand;
+    if (traversal_finder == "reads") {
+        genotyper.traversal_alg = Genotyper::TraversalAlg::Reads;
+    } else if (traversal_finder == "exhaustive") {
+        genotyper.traversal_alg = Genotyper::TraversalAlg::Exhaustive;
+    } else if (traversal_finder == "representative") {
+        genotyper.traversal_alg = Genotyper::TraversalAlg::Representative;
+    } else if (traversal_finder == "adaptive") {
+      genotyper.traversal_alg = Genotyper::TraversalAlg::Adaptive;
+    } else {
+        cerr << "Invalid value for traversal finder: " << traversal_finder
+             << ".  Must be in {reads, representative, exhaustive, adaptive}" << endl;
+        return 1;
+    }
+    genotyper.show_progress = show_progress;
+
+    // Guess the reference path if not given
+    if(ref_path_name.empty()) {
+        // Guess the ref path name
+        if(graph->paths.size() == 1) {
+            // Autodetect the reference path name as the name of the only path
+            ref_path_name = (*graph->paths._paths.begin()).first;
+        } else {
+            ref_path_name = "ref";
+        }
+    }
+
+    if (!sorted_gam_file.empty()) {
+        // Leave the reads on disk, and fetch them for each snarl as we need them
+        GAMIndex gam_index;
+        get_input_file(sorted_gam_file + ".gai", [&](istream& in) {
+            gam_index.load(in);
+        });
+        genotyper.run_indexed(*graph,
+                              gam_index,
+                              sorted_gam_file,
+                              cout,
+                              ref_path_name,
+                              contig_name,
+                              sample_name,
+                              output_vcf,
+                              output_json,
+                              length_override,
+                              variant_offset);
+        delete graph;
+        return 0;
+    }
+
     // Load all the reads matching the graph into memory
     vector<Alignment> alignments;
 
@@ -328,40 +397,6 @@ int main_genotype(int argc, char** argv) {
         cerr << "Loaded " << alignments.size() << " alignments" << endl;
     }
     
-    // Make a Genotyper to do the genotyping
-    Genotyper genotyper;
-    // Configure it
-    genotyper.use_mapq = use_mapq;
-    genotyper.realign_indels = realign_indels;
-    assert(het_prior_denominator > 0);
-    genotyper.het_prior_logprob = prob_to_logprob(1.0/het_prior_denominator);
-    genotyper.min_unique_per_strand = min_unique_per_strand;
-    if (traversal_finder == "reads") {
-        genotyper.traversal_alg = Genotyper::TraversalAlg::Reads;
-    } else if (traversal_finder == "exhaustive") {
-        genotyper.traversal_alg = Genotyper::TraversalAlg::Exhaustive;
-    } else if (traversal_finder == "representative") {
-        genotyper.traversal_alg = Genotyper::TraversalAlg::Representative;
-    } else if (traversal_finder == "adaptive") {
-      genotyper.traversal_alg = Genotyper::TraversalAlg::Adaptive;
-    } else {
-        cerr << "Invalid value for traversal finder: " << traversal_finder
-             << ".  Must be in {reads, representative, exhaustive, adaptive}" << endl;
-        return 1;
-    }
-    genotyper.show_progress = show_progress;
-
-    // Guess the reference path if not given
-    if(ref_path_name.empty()) {
-        // Guess the ref path name
-        if(graph->paths.size() == 1) {
-            // Autodetect the reference path name as the name of the only path
-            ref_path_name = (*graph->paths._paths.begin()).first;
-        } else {
-            ref_path_name = "ref";
-        }
-    }
-
     // Augment the graph with all the reads
     AugmentedGraph augmented_graph;
 
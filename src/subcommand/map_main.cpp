@@ -29,6 +29,7 @@ void help_map(char** argv) {
          << "    -e, --mem-chance FLOAT        set {-k} such that this fraction of {-k} length hits will by chance [5e-4]" << endl
          << "    -c, --hit-max N               ignore MEMs who have >N hits in our index (0 for no limit) [2048]" << endl
          << "    -Y, --max-mem INT             ignore mems longer than this length (unset if 0) [0]" << endl
+         << "    --mem-cache-k INT             reuse MEM search work between reads sharing a suffix of this length (0 to disable) [0]" << endl
          << "    -r, --reseed-x FLOAT          look for internal seeds inside a seed longer than FLOAT*--min-seed [1.5]" << endl
          << "    -u, --try-up-to INT           attempt to align up to the INT best candidate chains of seeds (1/2 for paired) [128]" << endl
          << "    -l, --try-at-least INT        attempt to align at least the INT best candidate chains of seeds [1]" << endl
@@ -105,6 +106,7 @@ int main_map(int argc, char** argv) {
     #define OPT_SCORE_MATRIX 1000
     #define OPT_RECOMBINATION_PENALTY 1001
     #define OPT_EXCLUDE_UNALIGNED 1002
+    #define OPT_MEM_CACHE_K 1003
     string matrix_file_name;
     string seq;
     string qual;
@@ -181,6 +183,7 @@ int main_map(int argc, char** argv) {
     int max_sub_mem_recursion_depth = 2;
     bool xdrop_alignment = false;
     uint32_t max_gap_length = 40;
+    size_t mem_cache_kmer_length = 0;
     bool surject_subpath_global = true; // force full length alignment in mpmap surjection resolution
 
     int c;
@@ -257,6 +260,7 @@ int main_map(int argc, char** argv) {
                 {"unpaired-cost", required_argument, 0, 'S'},
                 {"max-gap-length", required_argument, 0, 1},
                 {"xdrop-alignment", no_argument, 0, 2},
+                {"mem-cache-k", required_argument, 0, OPT_MEM_CACHE_K},
                 {0, 0, 0, 0}
             };
 
@@ -368,6 +372,10 @@ int main_map(int argc, char** argv) {
             exclude_unaligned = true;
             break;
 
+        case OPT_MEM_CACHE_K:
+            mem_cache_kmer_length = parse<size_t>(optarg);
+            break;
+
         case 'f':
             if (fastq1.empty()) fastq1 = optarg;
             else if (fastq2.empty()) fastq2 = optarg;
@@ -808,6 +816,7 @@ int main_map(int argc, char** argv) {
                  << ", min_cluster_length = " << m->min_cluster_length << endl;
         }
         m->fast_reseed = use_fast_reseed;
+        m->mem_cache_kmer_length = mem_cache_kmer_length;
         m->max_sub_mem_recursion_depth = max_sub_mem_recursion_depth;
         m->max_target_factor = max_target_factor;
         m->set_alignment_scores(match, mismatch, gap_open, gap_extend, full_length_bonus, max_gap_length, haplotype_consistency_exponent);
@@ -1210,6 +1219,18 @@ int main_map(int argc, char** argv) {
         }
     }
 
+    if (mem_cache_kmer_length > 0) {
+        // report how much MEM search work we managed to share between reads
+        uint64_t queries = 0;
+        uint64_t hits = 0;
+        for (Mapper* m : mapper) {
+            queries += m->mem_cache_queries;
+            hits += m->mem_cache_hits;
+        }
+        cerr << "[vg map] MEM search cache hit rate: " << (queries == 0 ? 0.0 : double(hits) / queries)
+             << " (" << hits << "/" << queries << ")" << endl;
+    }
+
     if (haplo_score_provider) {
         delete haplo_score_provider;
         haplo_score_provider = nullptr;
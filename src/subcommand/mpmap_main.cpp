@@ -13,6 +13,7 @@
 #include "../path.hpp"
 #include "../xg.hpp"
 #include "../watchdog.hpp"
+#include "../alignment_emitter.hpp"
 
 //#define record_read_run_times
 
@@ -75,6 +76,7 @@ void help_mpmap(char** argv) {
     << "  -W, --reseed-diff FLOAT       require internal MEMs to have length within this much of the SMEM's length [0.45]" << endl
     << "  -K, --clust-length INT        minimum MEM length used in clustering [automatic]" << endl
     << "  -c, --hit-max INT             use at most this many hits for any MEM (0 for no limit) [1024]" << endl
+    << "  --mem-cache-k INT             reuse MEM search work between reads sharing a suffix of this length (0 to disable) [0]" << endl
     << "  -w, --approx-exp FLOAT        let the approximate likelihood miscalculate likelihood ratios by this power [10.0]" << endl
     << "  --recombination-penalty FLOAT use this log recombination penalty for GBWT haplotype scoring [20.7]" << endl
     << "  --always-check-population     always try to population-score reads, even if there is only a single mapping" << endl
@@ -112,6 +114,7 @@ int main_mpmap(int argc, char** argv) {
     #define OPT_SUPPRESS_TAIL_ANCHORS 1005
     #define OPT_TOP_TRACEBACKS 1006
     #define OPT_MIN_DIST_CLUSTER 1007
+    #define OPT_MEM_CACHE_K 1008
     string matrix_file_name;
     string xg_name;
     string gcsa_name;
@@ -154,6 +157,7 @@ int main_mpmap(int argc, char** argv) {
     double cluster_ratio = 0.2;
     bool use_tvs_clusterer = false;
     bool use_min_dist_clusterer = false;
+    size_t mem_cache_kmer_length = 0;
     bool qual_adjusted = true;
     bool strip_full_length_bonus = false;
     MappingQualityMethod mapq_method = Adaptive;
@@ -249,6 +253,7 @@ int main_mpmap(int argc, char** argv) {
             {"delay-population", no_argument, 0, OPT_DELAY_POPULATION_SCORING},
             {"force-haplotype-count", required_argument, 0, OPT_FORCE_HAPLOTYPE_COUNT},
             {"min-dist-cluster", no_argument, 0, OPT_MIN_DIST_CLUSTER},
+            {"mem-cache-k", required_argument, 0, OPT_MEM_CACHE_K},
             {"drop-subgraph", required_argument, 0, 'C'},
             {"prune-exp", required_argument, 0, 'U'},
             {"long-read-scoring", no_argument, 0, 'E'},
@@ -485,6 +490,10 @@ int main_mpmap(int argc, char** argv) {
                 use_min_dist_clusterer = true;
                 break;
                 
+            case OPT_MEM_CACHE_K:
+                mem_cache_kmer_length = parse<size_t>(optarg);
+                break;
+                
             case 'C':
                 cluster_ratio = parse<double>(optarg);
                 break;
@@ -960,6 +969,7 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.sub_mem_thinning_burn_in = sub_mem_thinning_burn_in;
     multipath_mapper.order_length_repeat_hit_max = order_length_repeat_hit_max;
     multipath_mapper.min_mem_length = min_mem_length;
+    multipath_mapper.mem_cache_kmer_length = mem_cache_kmer_length;
     multipath_mapper.adaptive_reseed_diff = use_adaptive_reseed;
     multipath_mapper.adaptive_diff_exponent = reseed_exp;
     multipath_mapper.use_approx_sub_mem_count = false;
@@ -1052,15 +1062,39 @@ int main_mpmap(int argc, char** argv) {
     ofstream read_time_file(READ_TIME_FILE);
 #endif
     
-    // a buffer to hold read pairs that can't be unambiguously mapped before the fragment length distribution
+    // buffers to hold read pairs that can't be unambiguously mapped before the fragment length distribution
     // is estimated
-    // note: sufficient to have only one buffer because multithreading code enforces single threaded mode
-    // during distribution estimation
-    vector<pair<Alignment, Alignment>> ambiguous_pair_buffer;
+    // note: we keep one buffer per thread so that we can keep mapping in parallel while the distribution
+    // is being estimated
+    vector<vector<pair<Alignment, Alignment>>> ambiguous_pair_buffer(thread_count);
     
     vector<vector<Alignment> > single_path_output_buffer(thread_count);
     vector<vector<MultipathAlignment> > multipath_output_buffer(thread_count);
     
+    // emitters that let each thread hand off its full output buffer without waiting on the other threads
+    unique_ptr<AlignmentEmitter> single_path_emitter;
+    unique_ptr<MultipathAlignmentEmitter> multipath_emitter;
+    if (single_path_alignment_mode) {
+        single_path_emitter = get_alignment_emitter("-", "GAM", map<string, int64_t>(), thread_count);
+    }
+    else {
+        multipath_emitter = unique_ptr<MultipathAlignmentEmitter>(new MultipathAlignmentEmitter("-", thread_count));
+    }
+    
+    // send a thread's output buffer to the emitter once it's full (or always, if the limit is 0)
+    auto flush_single_path_buffer = [&](vector<Alignment>& output_buf, size_t buffer_limit) {
+        if (!output_buf.empty() && output_buf.size() >= buffer_limit) {
+            single_path_emitter->emit_singles(std::move(output_buf));
+            output_buf.clear();
+        }
+    };
+    auto flush_multipath_buffer = [&](vector<MultipathAlignment>& output_buf, size_t buffer_limit) {
+        if (!output_buf.empty() && output_buf.size() >= buffer_limit) {
+            multipath_emitter->emit_singles(std::move(output_buf));
+            output_buf.clear();
+        }
+    };
+    
     // write unpaired multipath alignments to stdout buffer
     auto output_multipath_alignments = [&](vector<MultipathAlignment>& mp_alns) {
         auto& output_buf = multipath_output_buffer[omp_get_thread_num()];
@@ -1078,7 +1112,7 @@ int main_mpmap(int argc, char** argv) {
             }
         }
         
-        vg::io::write_buffered(cout, output_buf, buffer_size);
+        flush_multipath_buffer(output_buf, buffer_size);
     };
     
     // convert to unpaired single path alignments and write stdout buffer
@@ -1112,7 +1146,7 @@ int main_mpmap(int argc, char** argv) {
             }
         }
         
-        vg::io::write_buffered(cout, output_buf, buffer_size);
+        flush_single_path_buffer(output_buf, buffer_size);
     };
     
     // write paired multipath alignments to stdout buffer
@@ -1156,7 +1190,7 @@ int main_mpmap(int argc, char** argv) {
             }
         }
         
-        vg::io::write_buffered(cout, output_buf, buffer_size);
+        flush_multipath_buffer(output_buf, buffer_size);
     };
     
     // convert to paired single path alignments and write stdout buffer
@@ -1220,7 +1254,7 @@ int main_mpmap(int argc, char** argv) {
             // arbitrarily decide that this is the "next" fragment
             output_buf.back().mutable_fragment_prev()->set_name(mp_aln_pair.first.name());
         }
-        vg::io::write_buffered(cout, output_buf, buffer_size);
+        flush_single_path_buffer(output_buf, buffer_size);
     };
     
     // do unpaired multipath alignment and write to buffer
@@ -1277,7 +1311,8 @@ int main_mpmap(int argc, char** argv) {
         }
                 
         vector<pair<MultipathAlignment, MultipathAlignment>> mp_aln_pairs;
-        multipath_mapper.multipath_map_paired(alignment_1, alignment_2, mp_aln_pairs, ambiguous_pair_buffer, max_num_mappings);
+        multipath_mapper.multipath_map_paired(alignment_1, alignment_2, mp_aln_pairs, ambiguous_pair_buffer[thread_num],
+                                              max_num_mappings);
         if (single_path_alignment_mode) {
             output_single_path_paired_alignments(mp_aln_pairs);
         }
@@ -1350,24 +1385,20 @@ int main_mpmap(int argc, char** argv) {
 #endif
     };
     
-    // for streaming paired input, don't spawn parallel tasks unless this evalutes to true
-    function<bool(void)> multi_threaded_condition = [&](void) {
-        return multipath_mapper.has_fixed_fragment_length_distr();
-    };
-    
+    // note: we don't need to wait for the fragment length distribution to be estimated before going
+    // multithreaded, because unambiguous pairs are mapped and output in parallel while it is being
+    // learned, and the rest are held in the per-thread ambiguous pair buffers
     
     // FASTQ input
     if (!fastq_name_1.empty()) {
         if (interleaved_input) {
-            fastq_paired_interleaved_for_each_parallel_after_wait(fastq_name_1, do_paired_alignments,
-                                                                  multi_threaded_condition);
+            fastq_paired_interleaved_for_each_parallel(fastq_name_1, do_paired_alignments);
         }
         else if (fastq_name_2.empty()) {
             fastq_unpaired_for_each_parallel(fastq_name_1, do_unpaired_alignments);
         }
         else {
-            fastq_paired_two_files_for_each_parallel_after_wait(fastq_name_1, fastq_name_2, do_paired_alignments,
-                                                                multi_threaded_condition);
+            fastq_paired_two_files_for_each_parallel(fastq_name_1, fastq_name_2, do_paired_alignments);
         }
     }
     
@@ -1379,8 +1410,7 @@ int main_mpmap(int argc, char** argv) {
                 exit(1);
             }
             if (interleaved_input) {
-                vg::io::for_each_interleaved_pair_parallel_after_wait(gam_in, do_paired_alignments,
-                                                                      multi_threaded_condition);
+                vg::io::for_each_interleaved_pair_parallel(gam_in, do_paired_alignments);
             }
             else {
                 vg::io::for_each_parallel(gam_in, do_unpaired_alignments);
@@ -1391,11 +1421,18 @@ int main_mpmap(int argc, char** argv) {
 
     // take care of any read pairs that we couldn't map unambiguously before the fragment length distribution
     // had been estimated
-    if (!ambiguous_pair_buffer.empty()) {
+    vector<pair<Alignment, Alignment>> ambiguous_pairs;
+    for (auto& thread_ambiguous_pairs : ambiguous_pair_buffer) {
+        for (auto& aln_pair : thread_ambiguous_pairs) {
+            ambiguous_pairs.emplace_back(move(aln_pair));
+        }
+        thread_ambiguous_pairs.clear();
+    }
+    if (!ambiguous_pairs.empty()) {
         if (multipath_mapper.has_fixed_fragment_length_distr()) {
 #pragma omp parallel for
-            for (size_t i = 0; i < ambiguous_pair_buffer.size(); i++) {
-                pair<Alignment, Alignment>& aln_pair = ambiguous_pair_buffer[i];
+            for (size_t i = 0; i < ambiguous_pairs.size(); i++) {
+                pair<Alignment, Alignment>& aln_pair = ambiguous_pairs[i];
                 // we reverse complemented the alignment on the first pass, so switch back so we don't break
                 // the alignment functions expectations
                 // TODO: slightly wasteful, inelegant
@@ -1410,8 +1447,8 @@ int main_mpmap(int argc, char** argv) {
             cerr << "warning:[vg mpmap] Could not find " << frag_length_sample_size << " unambiguous read pair mappings to estimate fragment length ditribution. Mapping read pairs as independent single-ended reads. Consider decreasing sample size (-b)." << endl;
             
 #pragma omp parallel for
-            for (size_t i = 0; i < ambiguous_pair_buffer.size(); i++) {
-                pair<Alignment, Alignment>& aln_pair = ambiguous_pair_buffer[i];
+            for (size_t i = 0; i < ambiguous_pairs.size(); i++) {
+                pair<Alignment, Alignment>& aln_pair = ambiguous_pairs[i];
                 // we reverse complemented the alignment on the first pass, so switch back so we don't break
                 // the alignment function's expectations
                 // TODO: slightly wasteful, inelegant
@@ -1427,18 +1464,26 @@ int main_mpmap(int argc, char** argv) {
     // flush output buffers
     for (int i = 0; i < thread_count; i++) {
         if (single_path_alignment_mode) {
-            vg::io::write_buffered(cout, single_path_output_buffer[i], 0);
+            flush_single_path_buffer(single_path_output_buffer[i], 0);
         }
         else {
-            vg::io::write_buffered(cout, multipath_output_buffer[i], 0);
+            flush_multipath_buffer(multipath_output_buffer[i], 0);
         }
     }
+    // destroying the emitters finishes writing everything out
+    single_path_emitter.reset();
+    multipath_emitter.reset();
     cout.flush();
     
 #ifdef record_read_run_times
     read_time_file.close();
 #endif
     
+    if (mem_cache_kmer_length > 0) {
+        cerr << "[vg mpmap] MEM search cache hit rate: " << multipath_mapper.mem_cache_hit_rate()
+             << " (" << multipath_mapper.mem_cache_hits << "/" << multipath_mapper.mem_cache_queries << ")" << endl;
+    }
+    
     //cerr << "MEM length filtering efficiency: " << ((double) OrientedDistanceClusterer::MEM_FILTER_COUNTER) / OrientedDistanceClusterer::MEM_TOTAL << " (" << OrientedDistanceClusterer::MEM_FILTER_COUNTER << "/" << OrientedDistanceClusterer::MEM_TOTAL << ")" << endl;
     //cerr << "MEM cluster filtering efficiency: " << ((double) OrientedDistanceClusterer::PRUNE_COUNTER) / OrientedDistanceClusterer::CLUSTER_TOTAL << " (" << OrientedDistanceClusterer::PRUNE_COUNTER << "/" << OrientedDistanceClusterer::CLUSTER_TOTAL << ")" << endl;
     //cerr << "subgraph filtering efficiency: " << ((double) MultipathMapper::PRUNE_COUNTER) / MultipathMapper::SUBGRAPH_TOTAL << " (" << MultipathMapper::PRUNE_COUNTER << "/" << MultipathMapper::SUBGRAPH_TOTAL << ")" << endl;
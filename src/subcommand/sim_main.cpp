@@ -49,6 +49,54 @@ vector<pair<string, double>> parse_rsem_expression_file(istream& rsem_in) {
     return return_val;
 }
 
+/**
+ * Produce num_reads reads or read pairs with sample(), using one simulator per
+ * thread. Reads are made in fixed-size batches, and each batch starts with a
+ * call to reseed() with the batch number and the index of the batch's first
+ * read. Batches are passed to emit() in order, so as long as reseed() fully
+ * determines what sample() produces, the output does not depend on the number
+ * of threads.
+ */
+template<typename Simulator>
+void simulate_in_batches(vector<unique_ptr<Simulator>>& simulators, size_t num_reads,
+                         const function<void(Simulator&, size_t, size_t)>& reseed,
+                         const function<vector<Alignment>(Simulator&)>& sample,
+                         const function<void(vector<Alignment>&)>& emit) {
+    
+    // How many reads or read pairs go in each batch
+    const size_t batch_size = 1000;
+    size_t num_batches = (num_reads + batch_size - 1) / batch_size;
+    // How many batches do we make before writing them out?
+    size_t batches_per_round = simulators.size() * 4;
+    
+    vector<vector<vector<Alignment>>> round_results(batches_per_round);
+    for (size_t round_start = 0; round_start < num_batches; round_start += batches_per_round) {
+        size_t round_end = min(num_batches, round_start + batches_per_round);
+        
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t batch = round_start; batch < round_end; batch++) {
+            Simulator& simulator = *simulators.at(omp_get_thread_num());
+            size_t first_read = batch * batch_size;
+            reseed(simulator, batch, first_read);
+            
+            auto& results = round_results[batch - round_start];
+            size_t batch_reads = min(batch_size, num_reads - first_read);
+            results.reserve(batch_reads);
+            for (size_t i = 0; i < batch_reads; i++) {
+                results.emplace_back(sample(simulator));
+            }
+        }
+        
+        // Write out the batches in order
+        for (size_t i = 0; i < round_end - round_start; i++) {
+            for (auto& alns : round_results[i]) {
+                emit(alns);
+            }
+            round_results[i].clear();
+        }
+    }
+}
+
 void help_sim(char** argv) {
     cerr << "usage: " << argv[0] << " sim [options]" << endl
          << "Samples sequences from the xg-indexed graph." << endl
@@ -71,7 +119,9 @@ void help_sim(char** argv) {
          << "    -v, --frag-std-dev FLOAT    use this standard deviation for fragment length estimation" << endl
          << "    -N, --allow-Ns              allow reads to be sampled from the graph with Ns in them" << endl
          << "    -a, --align-out             generate true alignments on stdout rather than reads" << endl
-         << "    -J, --json-out              write alignments in json" << endl;
+         << "    -J, --json-out              write alignments in json" << endl
+         << "    -t, --threads N             simulate in batches using N threads; output for a given" << endl
+         << "                                seed is the same for any N, but differs from unthreaded output" << endl;
 }
 
 int main_sim(int argc, char** argv) {
@@ -103,6 +153,8 @@ int main_sim(int argc, char** argv) {
     // Alternatively, which transcripts with how much expression?
     string rsem_file_name;
     vector<pair<string, double>> transcript_expressions;
+    // How many threads should we simulate in? 0 = simulate serially, unbatched.
+    int num_threads = 0;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -128,11 +180,12 @@ int main_sim(int argc, char** argv) {
             {"scale-err", required_argument, 0, 'S'},
             {"frag-len", required_argument, 0, 'p'},
             {"frag-std-dev", required_argument, 0, 'v'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hl:n:s:e:i:fax:Jp:v:Nd:F:P:T:S:I",
+        c = getopt_long (argc, argv, "hl:n:s:e:i:fax:Jp:v:Nd:F:P:T:S:It:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -220,6 +273,15 @@ int main_sim(int argc, char** argv) {
             fragment_std_dev = parse<double>(optarg);
             break;
             
+        case 't':
+            num_threads = parse<int>(optarg);
+            if (num_threads <= 0) {
+                cerr << "error:[vg sim] thread count (-t) set to " << num_threads << ", must set to a positive integer." << endl;
+                exit(1);
+            }
+            omp_set_num_threads(num_threads);
+            break;
+            
         case 'h':
         case '?':
             help_sim(argv);
@@ -270,12 +332,26 @@ int main_sim(int argc, char** argv) {
         aln_emitter = unique_ptr<vg::io::ProtobufEmitter<Alignment>>(new vg::io::ProtobufEmitter<Alignment>(cout));
     }
     
+    // Write out a read, or a pair of reads, in the requested format
+    auto emit = [&](vector<Alignment>& alns) {
+        if (align_out) {
+            for (auto& aln : alns) {
+                if (json_out) {
+                    cout << pb2json(aln) << endl;
+                } else {
+                    aln_emitter->write(std::move(aln));
+                }
+            }
+        } else if (alns.size() == 2) {
+            cout << alns.front().sequence() << "\t" << alns.back().sequence() << endl;
+        } else {
+            cout << alns.front().sequence() << endl;
+        }
+    };
+    
     if (fastq_name.empty()) {
         // Use the fixed error rate sampler
         
-        // Make a sample to sample reads with
-        Sampler sampler(xgidx.get(), seed_val, forward_only, reads_may_contain_Ns, path_names, transcript_expressions);
-        
         Aligner rescorer(default_match, default_mismatch, default_gap_open, default_gap_extension, default_full_length_bonus);
 
         // We define a function to score a using the aligner
@@ -285,10 +361,9 @@ int main_sim(int argc, char** argv) {
         };
         
         size_t max_iter = 1000;
-        int nonce = 1;
-        for (int i = 0; i < num_reads; ++i) {
-            // For each read we are going to generate
-            
+        
+        // Make one read or read pair with the given sampler
+        function<vector<Alignment>(Sampler&)> sample = [&](Sampler& sampler) {
             if (fragment_length) {
                 // fragment_lenght is nonzero so make it two paired reads
                 auto alns = sampler.alignment_pair(read_length, fragment_length, fragment_std_dev, base_error, indel_error);
@@ -303,24 +378,12 @@ int main_sim(int argc, char** argv) {
                     }
                 }
                 
-                // write the alignment or its string
                 if (align_out) {
-                    // write it out as requested
-                    
                     // We will need scores
                     rescore(alns.front());
                     rescore(alns.back());
-                    
-                    if (json_out) {
-                        cout << pb2json(alns.front()) << endl;
-                        cout << pb2json(alns.back()) << endl;
-                    } else {
-                        aln_emitter->write_copy(alns.front());
-                        aln_emitter->write_copy(alns.back());
-                    }
-                } else {
-                    cout << alns.front().sequence() << "\t" << alns.back().sequence() << endl;
                 }
+                return alns;
             } else {
                 // Do single-end reads
                 auto aln = sampler.alignment_with_error(read_length, base_error, indel_error);
@@ -338,22 +401,35 @@ int main_sim(int argc, char** argv) {
                     }
                 }
                 
-                // write the alignment or its string
                 if (align_out) {
-                    // write it out as requested
-                    
                     // We will need scores
                     rescore(aln);
-                    
-                    if (json_out) {
-                        cout << pb2json(aln) << endl;
-                    } else {
-                        aln_emitter->write_copy(aln);
-                    }
-                } else {
-                    cout << aln.sequence() << endl;
                 }
+                return vector<Alignment>{aln};
             }
+        };
+        
+        if (num_threads == 0) {
+            // Make a sample to sample reads with
+            Sampler sampler(xgidx.get(), seed_val, forward_only, reads_may_contain_Ns, path_names, transcript_expressions);
+            
+            for (int i = 0; i < num_reads; ++i) {
+                // For each read we are going to generate
+                auto alns = sample(sampler);
+                emit(alns);
+            }
+        } else {
+            // Make a sampler for each thread
+            vector<unique_ptr<Sampler>> samplers;
+            for (int i = 0; i < num_threads; i++) {
+                samplers.emplace_back(new Sampler(xgidx.get(), seed_val, forward_only, reads_may_contain_Ns,
+                                                  path_names, transcript_expressions));
+            }
+            
+            simulate_in_batches<Sampler>(samplers, num_reads, [&](Sampler& sampler, size_t batch, size_t first_read) {
+                // Keep read name nonces distinct between batches
+                sampler.reseed(hash<pair<size_t, size_t>>()(make_pair((size_t) seed_val, batch)), (int64_t) batch << 32);
+            }, sample, emit);
         }
         
     }
@@ -362,58 +438,56 @@ int main_sim(int argc, char** argv) {
         
         Aligner aligner(default_match, default_mismatch, default_gap_open, default_gap_extension, 5);
         
-        NGSSimulator sampler(*xgidx,
-                             fastq_name,
-                             interleaved,
-                             path_names,
-                             transcript_expressions,
-                             base_error,
-                             indel_error,
-                             indel_prop,
-                             fragment_length ? fragment_length : std::numeric_limits<double>::max(), // suppresses warnings about fragment length
-                             fragment_std_dev ? fragment_std_dev : 0.000001, // eliminates errors from having 0 as stddev without substantial difference
-                             error_scale_factor,
-                             !reads_may_contain_Ns,
-                             seed_val);
+        auto make_simulator = [&]() {
+            return new NGSSimulator(*xgidx,
+                                    fastq_name,
+                                    interleaved,
+                                    path_names,
+                                    transcript_expressions,
+                                    base_error,
+                                    indel_error,
+                                    indel_prop,
+                                    fragment_length ? fragment_length : std::numeric_limits<double>::max(), // suppresses warnings about fragment length
+                                    fragment_std_dev ? fragment_std_dev : 0.000001, // eliminates errors from having 0 as stddev without substantial difference
+                                    error_scale_factor,
+                                    !reads_may_contain_Ns,
+                                    seed_val);
+        };
         
-        if (fragment_length) {
-            for (size_t i = 0; i < num_reads; i++) {
+        // Make one read or read pair with the given simulator
+        function<vector<Alignment>(NGSSimulator&)> sample = [&](NGSSimulator& sampler) {
+            vector<Alignment> alns;
+            if (fragment_length) {
                 pair<Alignment, Alignment> read_pair = sampler.sample_read_pair();
-                read_pair.first.set_score(aligner.score_ungapped_alignment(read_pair.first, strip_bonuses));
-                read_pair.second.set_score(aligner.score_ungapped_alignment(read_pair.second, strip_bonuses));
-                
-                if (align_out) {
-                    if (json_out) {
-                        cout << pb2json(read_pair.first) << endl;
-                        cout << pb2json(read_pair.second) << endl;
-                    }
-                    else {
-                        aln_emitter->write_copy(read_pair.first);
-                        aln_emitter->write_copy(read_pair.second);
-                    }
-                }
-                else {
-                    cout << read_pair.first.sequence() << "\t" << read_pair.second.sequence() << endl;
-                }
+                alns.emplace_back(std::move(read_pair.first));
+                alns.emplace_back(std::move(read_pair.second));
             }
-        }
-        else {
+            else {
+                alns.emplace_back(sampler.sample_read());
+            }
+            for (auto& aln : alns) {
+                aln.set_score(aligner.score_ungapped_alignment(aln, strip_bonuses));
+            }
+            return alns;
+        };
+        
+        if (num_threads == 0) {
+            unique_ptr<NGSSimulator> sampler(make_simulator());
             for (size_t i = 0; i < num_reads; i++) {
-                Alignment read = sampler.sample_read();
-                read.set_score(aligner.score_ungapped_alignment(read, strip_bonuses));
-                
-                if (align_out) {
-                    if (json_out) {
-                        cout << pb2json(read) << endl;
-                    }
-                    else {
-                        aln_emitter->write_copy(read);
-                    }
-                }
-                else {
-                    cout << read.sequence() << endl;
-                }
+                auto alns = sample(*sampler);
+                emit(alns);
+            }
+        } else {
+            // Train a simulator for each thread
+            vector<unique_ptr<NGSSimulator>> samplers(num_threads);
+#pragma omp parallel for
+            for (int i = 0; i < num_threads; i++) {
+                samplers[i].reset(make_simulator());
             }
+            
+            simulate_in_batches<NGSSimulator>(samplers, num_reads, [&](NGSSimulator& sampler, size_t batch, size_t first_read) {
+                sampler.reseed(hash<pair<size_t, size_t>>()(make_pair((size_t) seed_val, batch)), first_read);
+            }, sample, emit);
         }
     }
     
@@ -32,6 +32,7 @@ void help_sort(char** argv){
          << "    -r, --ref              reference name, for eades and max-flow algorithms; makes -a default to max-flow" << endl
          << "    -w, --without-grooming no grooming mode for eades" << endl
          << "    -I, --index-to FILE    produce an index of an id-sorted vg file to the given filename" << endl
+         << "    -t, --threads N        sort weakly connected components (topo) or ID chunks (id) using N threads" << endl
          << endl;
 }
 
@@ -57,11 +58,12 @@ int main_sort(int argc, char *argv[]) {
                 {"ref", required_argument, 0, 'r'},
                 {"without-grooming", no_argument, 0, 'w'},
                 {"index-to", no_argument, 0, 'I'},
+                {"threads", required_argument, 0, 't'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "a:gr:wI:",
+        c = getopt_long (argc, argv, "a:gr:wI:t:",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -88,6 +90,9 @@ int main_sort(int argc, char *argv[]) {
         case 'I':
             sorted_index_filename = optarg;
             break;
+        case 't':
+            omp_set_num_threads(parse<int>(optarg));
+            break;
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
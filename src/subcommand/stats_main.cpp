@@ -10,6 +10,9 @@
 
 #include <list>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 
 #include "subcommand.hpp"
 #include "../algorithms/distance_to_head.hpp"
@@ -438,9 +441,6 @@ int main_stats(int argc, char** argv) {
             size_t total_perfect = 0; // Number of reads with no indels or substitutions relative to their paths
             size_t total_gapless = 0; // Number of reads with no indels relative to their paths
 
-            // These are for tracking which nodes are covered and which are not
-            map<vg::id_t, size_t> node_visit_counts;
-
             // And for counting indels
             // Inserted bases also counts softclips
             size_t total_insertions = 0;
@@ -475,10 +475,6 @@ int main_stats(int argc, char** argv) {
                 total_perfect += other.total_perfect;
                 total_gapless += other.total_gapless;
                 
-                for (auto& kv : other.node_visit_counts) {
-                    node_visit_counts[kv.first] += kv.second;
-                }
-                
                 total_insertions += other.total_insertions;
                 total_inserted_bases += other.total_inserted_bases;
                 total_deletions += other.total_deletions;
@@ -560,14 +556,47 @@ int main_stats(int argc, char** argv) {
 
 
                     #pragma omp critical (allele_path_for_node)
-                    allele_path_for_node[node->id()] = make_pair(site, allele);
-
-                    #pragma omp critical (reads_on_allele)
-                    combined.reads_on_allele[site][allele] = 0;
+                    {
+                        allele_path_for_node[node->id()] = make_pair(site, allele);
+                        combined.reads_on_allele[site][allele] = 0;
+                    }
                 }
             });
             
         }
+        
+        // These are for tracking which nodes are covered and which are not.
+        // Visits are counted in one dense array shared by all threads, indexed
+        // by node rank. Ranks are offsets from the min ID if the IDs are dense
+        // enough, and looked up otherwise.
+        vector<atomic<size_t>> node_visit_counts;
+        vg::id_t min_node_id = 0;
+        bool rank_by_offset = true;
+        unordered_map<vg::id_t, size_t> rank_of_node;
+        if (graph.get() != nullptr && graph->node_count() > 0) {
+            min_node_id = graph->min_node_id();
+            size_t id_range = graph->max_node_id() - min_node_id + 1;
+            rank_by_offset = id_range <= 2 * graph->node_count();
+            if (rank_by_offset) {
+                node_visit_counts = vector<atomic<size_t>>(id_range);
+            } else {
+                node_visit_counts = vector<atomic<size_t>>(graph->node_count());
+                rank_of_node.reserve(graph->node_count());
+                for (size_t i = 0; i < graph->graph.node_size(); i++) {
+                    rank_of_node[graph->graph.node(i).id()] = i;
+                }
+            }
+        }
+        // Get the rank of a node, or numeric_limits<size_t>::max() if it isn't in the graph.
+        auto node_rank = [&](vg::id_t node_id) -> size_t {
+            if (rank_by_offset) {
+                size_t rank = node_id - min_node_id;
+                return (node_id >= min_node_id && rank < node_visit_counts.size()) ? rank : numeric_limits<size_t>::max();
+            } else {
+                auto found = rank_of_node.find(node_id);
+                return found == rank_of_node.end() ? numeric_limits<size_t>::max() : found->second;
+            }
+        };
 
         // Allocate per-thread storage for stats
         size_t thread_count = get_thread_count();
@@ -617,7 +646,10 @@ int main_stats(int argc, char** argv) {
                     }
 
                     // Record that there was a visit to this node.
-                    stats.node_visit_counts[node_id]++;
+                    size_t rank = node_rank(node_id);
+                    if (rank != numeric_limits<size_t>::max()) {
+                        node_visit_counts[rank].fetch_add(1, memory_order_relaxed);
+                    }
 
                     for(size_t j = 0; j < mapping.edit_size(); j++) {
                         // Go through edits and look for each type.
@@ -695,13 +727,21 @@ int main_stats(int argc, char** argv) {
         };
 
         // Actually go through all the reads and count stuff up.
+        auto start_time = chrono::steady_clock::now();
         vg::io::for_each_parallel(alignment_stream, lambda);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start_time;
         
         // Now combine into a single ReadStats object (for which we pre-populated reads_on_allele with 0s).
         for (auto& per_thread : read_stats) {
             combined += per_thread;
         }
         read_stats.clear();
+        
+        if (verbose) {
+            cerr << "Processed " << combined.total_alignments << " alignments in " << elapsed.count() << " s ("
+                << combined.total_alignments / max(elapsed.count(), 1e-9) << " alignments/s on "
+                << thread_count << " threads)" << endl;
+        }
 
         // Go through all the nodes again and sum up unvisited nodes
         size_t unvisited_nodes = 0;
@@ -767,30 +807,29 @@ int main_stats(int argc, char** argv) {
                 }
             }
 
-            graph->for_each_node_parallel([&](Node* node) {
+            #pragma omp parallel for reduction(+:unvisited_nodes,unvisited_node_bases,single_visited_nodes,single_visited_node_bases)
+            for (size_t i = 0; i < graph->graph.node_size(); i++) {
                 // For every node
-                if(!combined.node_visit_counts.count(node->id()) || combined.node_visit_counts.at(node->id()) == 0) {
+                const Node& node = graph->graph.node(i);
+                size_t visits = node_visit_counts[node_rank(node.id())].load(memory_order_relaxed);
+                if(visits == 0) {
                     // If we never visited it with a read, count it.
-                    #pragma omp critical (unvisited_nodes)
                     unvisited_nodes++;
-                    #pragma omp critical (unvisited_node_bases)
-                    unvisited_node_bases += node->sequence().size();
+                    unvisited_node_bases += node.sequence().size();
                     if(verbose) {
                         #pragma omp critical (unvisited_ids)
-                        unvisited_ids.insert(node->id());
+                        unvisited_ids.insert(node.id());
                     }
-                } else if(combined.node_visit_counts.at(node->id()) == 1) {
+                } else if(visits == 1) {
                     // If we visited it with only one read, count it.
-                    #pragma omp critical (single_visited_nodes)
                     single_visited_nodes++;
-                    #pragma omp critical (single_visited_node_bases)
-                    single_visited_node_bases += node->sequence().size();
+                    single_visited_node_bases += node.sequence().size();
                     if(verbose) {
                         #pragma omp critical (single_visited_ids)
-                        single_visited_ids.insert(node->id());
+                        single_visited_ids.insert(node.id());
                     }
                 }
-            });
+            }
             
         }
 
@@ -24,6 +24,102 @@ using namespace vg;
 using namespace vg::subcommand;
 
 
+/**
+ * Convert a stream of records in batches, preserving their order. Records from
+ * for_each_input are collected into a batch, the batch is converted with
+ * convert() on all threads, and then the results are passed to write() in
+ * input order on a single thread.
+ */
+template<typename In, typename Out>
+void convert_in_order(const function<void(const function<void(In&)>&)>& for_each_input,
+                      const function<void(In&, Out&)>& convert,
+                      const function<void(Out&)>& write) {
+    
+    size_t batch_size = 1000 * get_thread_count();
+    vector<In> inputs;
+    vector<Out> outputs;
+    inputs.reserve(batch_size);
+    
+    auto flush = [&]() {
+        outputs.resize(inputs.size());
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < inputs.size(); i++) {
+            convert(inputs[i], outputs[i]);
+        }
+        for (auto& output : outputs) {
+            write(output);
+        }
+        inputs.clear();
+        outputs.clear();
+    };
+    
+    for_each_input([&](In& input) {
+        inputs.emplace_back(std::move(input));
+        if (inputs.size() >= batch_size) {
+            flush();
+        }
+    });
+    flush();
+}
+
+/**
+ * Get a function that feeds each message of the given type in the named file
+ * (or standard input) to a callback.
+ */
+template<typename Message>
+function<void(const function<void(Message&)>&)> for_each_message_in(const string& file_name) {
+    return [file_name](const function<void(Message&)>& callback) {
+        get_input_file(file_name, [&](istream& in) {
+            vg::io::for_each(in, callback);
+        });
+    };
+}
+
+/**
+ * Get a function that feeds each nonempty line of the named file (or standard
+ * input) to a callback. Used to parse line-delimited JSON in parallel.
+ */
+function<void(const function<void(string&)>&)> for_each_line_in(const string& file_name) {
+    return [file_name](const function<void(string&)>& callback) {
+        get_input_file(file_name, [&](istream& in) {
+            string line;
+            while (getline(in, line)) {
+                if (!line.empty()) {
+                    callback(line);
+                }
+            }
+        });
+    };
+}
+
+/**
+ * Dump all the messages of the given type in the named file as JSON, one per
+ * line, converting them in parallel.
+ */
+template<typename Message>
+void messages_to_json(const string& file_name) {
+    convert_in_order<Message, string>(for_each_message_in<Message>(file_name), [](Message& message, string& json) {
+        json = pb2json(message);
+    }, [](string& json) {
+        cout << json << "\n";
+    });
+}
+
+/// Format a read as a FASTQ record.
+template<typename Read>
+string to_fastq(const Read& read) {
+    stringstream record;
+    record << "@" << read.name() << "\n"
+           << read.sequence() << "\n"
+           << "+" << "\n";
+    if (read.quality().empty()) {
+        record << string(read.sequence().size(), quality_short_to_char(30)) << "\n";
+    } else {
+        record << string_quality_short_to_char(read.quality()) << "\n";
+    }
+    return record.str();
+}
+
 void help_view(char** argv) {
     cerr << "usage: " << argv[0] << " view [options] [ <graph.vg> | <graph.json> | <aln.gam> | <read1.fq> [<read2.fq>] ]" << endl
          << "options:" << endl
@@ -82,7 +178,9 @@ void help_view(char** argv) {
          << "    -k, --multipath            output VG MultipathAlignment format (GAMP)" << endl
          << "    -D, --expect-duplicates    don't warn if encountering the same node or edge multiple times" << endl
          << "    -x, --extract-tag TAG      extract and concatenate messages with the given tag" << endl
-         << "    --threads N                for parallel operations use this many threads [1]" << endl;
+         << "    --threads N                for parallel operations use this many threads [1]" << endl
+         << "                               (record conversions keep their order; with more than one" << endl
+         << "                               thread, JSON record input must have one record per line)" << endl;
     
     // TODO: Can we regularize the option names for input and output types?
 
@@ -504,43 +602,33 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "gam") {
         if (!input_json) {
             if (output_type == "json") {
-                // convert values to printable ones
-                function<void(Alignment&)> lambda = [](Alignment& a) {
+                convert_in_order<Alignment, string>(for_each_message_in<Alignment>(file_name), [](Alignment& a, string& json) {
+                    // convert values to printable ones
                     if(std::isnan(a.identity())) {
                         // Fix up NAN identities that can't be serialized in
                         // JSON. We shouldn't generate these any more, and they
                         // are out of spec, but they can be in files.
                         a.set_identity(0);
                     }
-                    cout << pb2json(a) << "\n";
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
+                    json = pb2json(a);
+                }, [](string& json) {
+                    cout << json << "\n";
                 });
             } else if (output_type == "fastq") {
-                function<void(Alignment&)> lambda = [](Alignment& a) {
-                    cout << "@" << a.name() << endl
-                         << a.sequence() << endl
-                    << "+" << endl;
-                    if (a.quality().empty()) {
-                        cout << string(a.sequence().size(), quality_short_to_char(30)) << endl;
-                    } else {
-                        cout << string_quality_short_to_char(a.quality()) << endl;
-                    }
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
+                convert_in_order<Alignment, string>(for_each_message_in<Alignment>(file_name), [](Alignment& a, string& fastq) {
+                    fastq = to_fastq(a);
+                }, [](string& fastq) {
+                    cout << fastq;
                 });
             }
             else if (output_type == "multipath") {
                 vector<MultipathAlignment> buf;
-                function<void(Alignment&)> lambda = [&buf](Alignment& aln) {
-                    buf.emplace_back();
-                    to_multipath_alignment(aln, buf.back());
+                convert_in_order<Alignment, MultipathAlignment>(for_each_message_in<Alignment>(file_name),
+                    [](Alignment& aln, MultipathAlignment& mp_aln) {
+                    to_multipath_alignment(aln, mp_aln);
+                }, [&buf](MultipathAlignment& mp_aln) {
+                    buf.emplace_back(std::move(mp_aln));
                     vg::io::write_buffered(cout, buf, 1000);
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
                 });
                 vg::io::write_buffered(cout, buf, 0);
             }
@@ -549,6 +637,43 @@ int main_view(int argc, char** argv) {
                 cerr << "[vg view] error: (binary) GAM can only be converted to JSON, GAMP or FASTQ" << endl;
                 return 1;
             }
+        } else if (get_thread_count() > 1) {
+            // Parse the JSON lines in parallel
+            if (output_type == "json") {
+                convert_in_order<string, string>(for_each_line_in(file_name), [](string& line, string& json) {
+                    Alignment aln;
+                    json2pb(aln, line);
+                    json = pb2json(aln);
+                }, [](string& json) {
+                    cout << json << "\n";
+                });
+            }
+            else if (output_type == "gam") {
+                vector<Alignment> buf;
+                convert_in_order<string, Alignment>(for_each_line_in(file_name), [](string& line, Alignment& aln) {
+                    json2pb(aln, line);
+                }, [&buf](Alignment& aln) {
+                    buf.emplace_back(std::move(aln));
+                    vg::io::write_buffered(cout, buf, 1000);
+                });
+                vg::io::write_buffered(cout, buf, 0);
+            }
+            else if (output_type == "multipath") {
+                vector<MultipathAlignment> buf;
+                convert_in_order<string, MultipathAlignment>(for_each_line_in(file_name), [](string& line, MultipathAlignment& mp_aln) {
+                    Alignment aln;
+                    json2pb(aln, line);
+                    to_multipath_alignment(aln, mp_aln);
+                }, [&buf](MultipathAlignment& mp_aln) {
+                    buf.emplace_back(std::move(mp_aln));
+                    vg::io::write_buffered(cout, buf, 1000);
+                });
+                vg::io::write_buffered(cout, buf, 0);
+            }
+            else {
+                cerr << "[vg view] error: JSON GAM can only be converted to GAM, GAMP, or JSON" << endl;
+                return 1;
+            }
         } else {
             vg::io::JSONStreamHelper<Alignment> json_helper(file_name);
             if (output_type == "json" || output_type == "gam") {
@@ -639,39 +764,26 @@ int main_view(int argc, char** argv) {
                 vg::io::write_buffered(std::cout, buf, 0);
             }
             else if (output_type == "fastq") {
-                function<void(MultipathAlignment&)> lambda = [](MultipathAlignment& mp_aln) {
-                    cout << "@" << mp_aln.name() << endl
-                         << mp_aln.sequence() << endl
-                         << "+" << endl;
-                    if (mp_aln.quality().empty()) {
-                        cout << string(mp_aln.sequence().size(), quality_short_to_char(30)) << endl;
-                    } else {
-                        cout << string_quality_short_to_char(mp_aln.quality()) << endl;
-                    }
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
+                convert_in_order<MultipathAlignment, string>(for_each_message_in<MultipathAlignment>(file_name),
+                    [](MultipathAlignment& mp_aln, string& fastq) {
+                    fastq = to_fastq(mp_aln);
+                }, [](string& fastq) {
+                    cout << fastq;
                 });
             }
             else if (output_type == "gam") {
                 vector<Alignment> buf;
-                function<void(MultipathAlignment&)> lambda = [&buf](MultipathAlignment& mp_aln) {
-                    buf.emplace_back();
-                    optimal_alignment(mp_aln, buf.back());
+                convert_in_order<MultipathAlignment, Alignment>(for_each_message_in<MultipathAlignment>(file_name),
+                    [](MultipathAlignment& mp_aln, Alignment& aln) {
+                    optimal_alignment(mp_aln, aln);
+                }, [&buf](Alignment& aln) {
+                    buf.emplace_back(std::move(aln));
                     vg::io::write_buffered(cout, buf, 1000);
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
                 });
                 vg::io::write_buffered(std::cout, buf, 0);
             }
             else if (output_type == "json") {
-                function<void(MultipathAlignment&)> lambda = [&](MultipathAlignment& mp_aln) {
-                    cout << pb2json(mp_aln) << endl;
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
-                });
+                messages_to_json<MultipathAlignment>(file_name);
             }
             else {
                 cerr << "[vg view] error: Unrecognized output format for MultipathAlignment (GAMP)" << endl;
@@ -716,13 +828,7 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "pileup") {
         if (!input_json) {
             if (output_type == "json") {
-                // convert values to printable ones
-                function<void(Pileup&)> lambda = [](Pileup& p) {
-                    cout << pb2json(p) << "\n";
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
-                });
+                messages_to_json<Pileup>(file_name);
             } else {
                 // todo
                 cerr << "[vg view] error: (binary) Pileup can only be converted to JSON" << endl;
@@ -741,12 +847,7 @@ int main_view(int argc, char** argv) {
         return 0;
     } else if (input_type == "translation") {
         if (output_type == "json") {
-            function<void(Translation&)> lambda = [](Translation& t) {
-                cout << pb2json(t) << "\n";
-            };
-            get_input_file(file_name, [&](istream& in) {
-                vg::io::for_each(in, lambda);
-            });
+            messages_to_json<Translation>(file_name);
         } else {
             cerr << "[vg view] error: (binary) Translation can only be converted to JSON" << endl;
             return 1;
@@ -755,13 +856,7 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "locus") {
         if (!input_json) {
             if (output_type == "json") {
-                // convert values to printable ones
-                function<void(Locus&)> lambda = [](Locus& l) {
-                    cout << pb2json(l) << "\n";
-                };
-                get_input_file(file_name, [&](istream& in) {
-                    vg::io::for_each(in, lambda);
-                });
+                messages_to_json<Locus>(file_name);
             } else {
                 // todo
                 cerr << "[vg view] error: (binary) Locus can only be converted to JSON" << endl;
@@ -780,12 +875,7 @@ int main_view(int argc, char** argv) {
         return 0;
     } else if (input_type == "snarls") {
         if (output_type == "json") {
-            function<void(Snarl&)> lambda = [](Snarl& s) {
-                cout << pb2json(s) << "\n";
-            };
-            get_input_file(file_name, [&](istream& in) {
-                vg::io::for_each(in, lambda);
-            });
+            messages_to_json<Snarl>(file_name);
         } else {
             cerr << "[vg view] error: (binary) Snarls can only be converted to JSON" << endl;
             return 1;
@@ -793,12 +883,7 @@ int main_view(int argc, char** argv) {
         return 0;
     } else if (input_type == "snarltraversals") {
         if (output_type == "json") {
-            function<void(SnarlTraversal&)> lambda = [](SnarlTraversal& s) {
-                cout << pb2json(s) << "\n";
-            };
-            get_input_file(file_name, [&](istream& in) {
-                vg::io::for_each(in, lambda);
-            });
+            messages_to_json<SnarlTraversal>(file_name);
         } else {
             cerr << "[vg view] error: (binary) SnarlTraversals can only be converted to JSON" << endl;
             return 1;
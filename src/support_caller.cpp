@@ -8,7 +8,12 @@
 #include <unordered_set>
 #include <utility>
 #include <algorithm>
+#include <atomic>
+#include <limits>
+#include <cstdio>
 #include <getopt.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "vg.hpp"
 #include "index.hpp"
@@ -33,6 +38,27 @@ const static int MAX_ALLELE_LENGTH = 0;
 // Minimum log likelihood
 const static double LOG_ZERO = (double)-1e100;
 
+/**
+ * A fixed-size set of bits that many threads can set at once without locking.
+ */
+class AtomicBitset {
+public:
+    AtomicBitset(size_t size) : words((size + 63) / 64) {
+        // Nothing to do
+    }
+    
+    void set(size_t i) {
+        words[i / 64].fetch_or((uint64_t)1 << (i % 64), std::memory_order_relaxed);
+    }
+    
+    bool test(size_t i) const {
+        return words[i / 64].load(std::memory_order_relaxed) & ((uint64_t)1 << (i % 64));
+    }
+    
+private:
+    vector<atomic<uint64_t>> words;
+};
+
 // convert to string using stringstream (to replace to_string when we want sci. notation)
 template <typename T>
 string to_string_ss(T val) {
@@ -216,11 +242,13 @@ string get_pileup_line(const map<int64_t, NodePileup>& node_pileups,
 }
 
 SupportCaller::PrimaryPath::PrimaryPath(SupportAugmentedGraph& augmented, const string& ref_path_name, size_t ref_bin_size):
-    ref_bin_size(ref_bin_size), index(augmented.graph, ref_path_name, true), name(ref_path_name)  {
+    ref_bin_size(ref_bin_size), index(augmented.get_graph(), ref_path_name, true), name(ref_path_name)  {
+
+    const PathHandleGraph& graph = augmented.get_graph();
 
     // Follow the reference path and extract indexes we need: index by node ID,
     // index by node start, and the reconstructed path sequence.
-    PathIndex index(augmented.graph, ref_path_name, true);
+    PathIndex index(graph, ref_path_name, true);
 
     if (index.sequence.size() == 0) {
         // No empty reference paths allowed
@@ -250,19 +278,20 @@ SupportCaller::PrimaryPath::PrimaryPath(SupportAugmentedGraph& augmented, const
     // Crunch the numbers on the reference and its read support. How much read
     // support in total (node length * aligned reads) does the primary path get?
     total_support = Support();
-    for(auto& pointerAndSupport : augmented.node_supports) {
-        if(index.by_id.count(pointerAndSupport.first)) {
-            // This is a primary path node. Add in the total read bases supporting it
-            total_support += augmented.graph.get_length(augmented.graph.get_handle(pointerAndSupport.first)) * pointerAndSupport.second;
-            
-            // We also update the total for the appropriate bin
-            size_t bin = index.by_id[pointerAndSupport.first].first / ref_bin_size;
-            if (bin == binned_support.size()) {
-                --bin;
-            }
-            binned_support[bin] = binned_support[bin] + 
-               augmented.graph.get_length(augmented.graph.get_handle(pointerAndSupport.first)) * pointerAndSupport.second;
+    for(auto& idAndPosition : index.by_id) {
+        // This is a primary path node. Add in the total read bases supporting
+        // it. Ask the augmented graph rather than its support map, since the
+        // supports may be looked up on demand.
+        Support node_support = augmented.get_support(idAndPosition.first);
+        total_support += graph.get_length(graph.get_handle(idAndPosition.first)) * node_support;
+        
+        // We also update the total for the appropriate bin
+        size_t bin = idAndPosition.second.first / ref_bin_size;
+        if (bin == binned_support.size()) {
+            --bin;
         }
+        binned_support[bin] = binned_support[bin] + 
+           graph.get_length(graph.get_handle(idAndPosition.first)) * node_support;
     }
     
     // Average out the support bins too (in place)
@@ -380,11 +409,11 @@ size_t SupportCaller::get_deletion_length(const NodeSide& end1, const NodeSide&
             // find the positions of our nodesides in the path.
             size_t pos1 = idx_it1->second.first;
             if (end1.is_end != idx_it1->second.second) {
-                pos1 += augmented.graph.get_length(augmented.graph.get_handle(idx_it1->first));
+                pos1 += augmented.get_graph().get_length(augmented.get_graph().get_handle(idx_it1->first));
             }
             size_t pos2 = idx_it2->second.first;
             if (end2.is_end != idx_it2->second.second) {
-                pos2 += augmented.graph.get_length(augmented.graph.get_handle(idx_it2->first));
+                pos2 += augmented.get_graph().get_length(augmented.get_graph().get_handle(idx_it2->first));
             }
 
             if (pos1 > pos2) {
@@ -397,6 +426,14 @@ size_t SupportCaller::get_deletion_length(const NodeSide& end1, const NodeSide&
     return 0;
 }
 
+/**
+ * Get the edge leaving the first NodeSide and entering the second.
+ */
+static edge_t edge_between(const HandleGraph& graph, const NodeSide& end1, const NodeSide& end2) {
+    return graph.edge_handle(graph.get_handle(end1.node, !end1.is_end),
+                             graph.get_handle(end2.node, end2.is_end));
+}
+
 /**
  * Trace out the given traversal, handling nodes, child snarls, and edges
  * associated with particular visit numbers.
@@ -480,16 +517,18 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
     }
 #endif
 
+    const PathHandleGraph& graph = augmented.get_graph();
+
     // First work out the stuff we need to share
     multiset<id_t> shared_nodes;
     multiset<Snarl> shared_children;
-    multiset<Edge*> shared_edges;
+    unordered_multiset<edge_t> shared_edges;
     for (auto shared_trav : already_used) {
         // Mark all the nodes and edges that the other traverasl uses.
         trace_traversal(*shared_trav, site, [&](size_t i, id_t node, bool is_reverse) {
             shared_nodes.insert(node);
         }, [&](size_t i, NodeSide end1, NodeSide end2) {
-            shared_edges.insert(augmented.graph.get_edge(end1, end2));
+            shared_edges.insert(edge_between(graph, end1, end2));
         }, [&](size_t i, Snarl child, bool is_reverse) {
             shared_children.insert(child);
         });
@@ -498,13 +537,13 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
     // And the reference stuff we want to average out separately
     set<id_t> ref_nodes;
     set<Snarl> ref_children;
-    set<Edge*> ref_edges;
+    unordered_set<edge_t> ref_edges;
     if (ref_traversal != nullptr && ref_traversal != &traversal) {
         // Mark all the nodes and edges that the ref traverasl uses.
         trace_traversal(*ref_traversal, site, [&](size_t i, id_t node, bool is_reverse) {
             ref_nodes.insert(node);
         }, [&](size_t i, NodeSide end1, NodeSide end2) {
-            ref_edges.insert(augmented.graph.get_edge(end1, end2));
+            ref_edges.insert(edge_between(graph, end1, end2));
             ref_nodes.insert(end1.node);
             ref_nodes.insert(end2.node);
         }, [&](size_t i, Snarl child, bool is_reverse) {
@@ -533,16 +572,16 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
     bool zero_avg_support = false;
     
     // Don't count nodes shared between child snarls more than once.
-    set<Node*> coverage_counted;
+    set<id_t> coverage_counted;
     
     trace_traversal(traversal, site, [&](size_t i, id_t node_id, bool is_reverse) {
-        // Find the node
-        Node* node = augmented.graph.get_node(node_id);
+        // Find the node's length
+        size_t node_length = graph.get_length(graph.get_handle(node_id));
     
         // Grab this node's total support along its length
         // Make sure to only use half the support if the node is shared or none if its shared twice
         double shared_factor = 1. - 0.5 * (double) min(2UL, shared_nodes.count(node_id));
-        auto got_support = augmented.get_support(node->id()) * node->sequence().size() * shared_factor;
+        auto got_support = augmented.get_support(node_id) * node_length * shared_factor;
         
         if (is_reverse) {
             // Put the support relative to the traversal's strand
@@ -550,7 +589,7 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
         }
         
 #ifdef debug
-        cerr << "From node " << node->id() << " get " << got_support << endl;
+        cerr << "From node " << node_id << " get " << got_support << endl;
 #endif
         // don't count inverted nodes as reference
         bool count_as_ref = ref_nodes.count(node_id) && !ref_reversed;
@@ -558,20 +597,20 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
         if (!count_as_ref) { 
             // update totals for averaging
             total_supports[i] += got_support;
-            visit_sizes[i] += node->sequence().size();
+            visit_sizes[i] += node_length;
         } else {
             // reference-overlapping support kept separate for later filters
             total_ref_supports[i] += got_support;
-            ref_visit_sizes[i] += node->sequence().size();
+            ref_visit_sizes[i] += node_length;
         }
         
         // And update its min support
-        min_supports[i] = support_min(min_supports[i], augmented.get_support(node->id()) * shared_factor);
+        min_supports[i] = support_min(min_supports[i], augmented.get_support(node_id) * shared_factor);
         
     }, [&](size_t i, NodeSide end1, NodeSide end2) {
         // This is an edge
-        Edge* edge = augmented.graph.get_edge(end1, end2);
-        assert(edge != nullptr);
+        edge_t edge = edge_between(graph, end1, end2);
+        assert(graph.has_edge(edge.first, edge.second));
 
         // edges between adjacent nodes or ones that go off primary path count for size 1
         // otherwise, they count as the number of deleted bases on the primary path
@@ -580,9 +619,7 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
         // Count as 1 base worth for the total/average support
         // Make sure to only use half the support if the edge is shared
         double shared_factor = 1. - 0.5 * (double) min(2UL, shared_edges.count(edge));
-        edge_t edge_handle = augmented.graph.edge_handle(augmented.graph.get_handle(end1.node, !end1.is_end),
-                                                         augmented.graph.get_handle(end2.node, end2.is_end));
-        auto got_support = (double)edge_size * augmented.get_support(edge_handle) * shared_factor;
+        auto got_support = (double)edge_size * augmented.get_support(edge) * shared_factor;
 
         // Prevent averaging over SVs with 0 support, just because the reference part of the traversal has support
         if (edge_size > max_unsupported_edge_size && support_val(got_support) == 0) {
@@ -597,8 +634,7 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
         }
         
 #ifdef debug
-        cerr << "From edge " << edge->from() << " " << edge->from_start() << " to "
-            << edge->to() << " " << edge->to_end() << " get " << got_support << endl;
+        cerr << "From edge " << end1 << " to " << end2 << " get " << got_support << endl;
 #endif
 
         if (!ref_edges.count(edge)) {
@@ -616,25 +652,24 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
         }
         
         // Min in its support
-        min_supports[i] = support_min(min_supports[i], augmented.get_support(edge_handle) * shared_factor);        
+        min_supports[i] = support_min(min_supports[i], augmented.get_support(edge) * shared_factor);        
     }, [&](size_t i, Snarl child, bool is_reverse) {
         // This is a child snarl, so get its max support.
         
         Support child_max;
         size_t child_size = 0;
         for (id_t node_id : snarl_manager.deep_contents(snarl_manager.manage(child),
-            augmented.graph, true).first) {
+            graph, true).first) {
             // For every node in the child
-            Node* node = augmented.graph.get_node(node_id);
             
-            if (coverage_counted.count(node)) {
+            if (coverage_counted.count(node_id)) {
                 // Already used by another child snarl on this traversal
                 continue;
             }
             // Claim this node for this child.
-            coverage_counted.insert(node);
+            coverage_counted.insert(node_id);
             
-            Support child_support = augmented.get_support(node->id());
+            Support child_support = augmented.get_support(node_id);
             
             // TODO: We can't tell which strand of a child snarl's contained
             // nodes corresponds to which strand of the child snarl. Just
@@ -644,13 +679,13 @@ tuple<Support, Support, size_t> SupportCaller::get_traversal_support(SupportAugm
             child_support.set_reverse(average_support);
             
             // How many distinct reads must use the child, given the distinct reads on this node?
-            child_max = support_max(child_max, augmented.get_support(node->id()));
+            child_max = support_max(child_max, augmented.get_support(node_id));
             
             // Add in the node's size to the child
-            child_size += node->sequence().size();
+            child_size += graph.get_length(graph.get_handle(node_id));
             
 #ifdef debug
-            cerr << "From child snarl node " << node->id() << " get "
+            cerr << "From child snarl node " << node_id << " get "
                 << child_support << " for distinct " << child_max << endl;
 #endif
         }
@@ -844,9 +879,10 @@ vector<Support> SupportCaller::get_inversion_supports(
             bool next_backward = traversals[allele].visit(1).node_id() ?
                 traversals[allele].visit(1).backward() :
                 next_visit.backward() != traversals[allele].visit(1).backward();
-            Edge* edge1 = augmented.graph.get_edge(NodeSide(traversals[allele].visit(0).node_id(),
-                                                            !traversals[allele].visit(0).backward()),
-                                                   NodeSide(next_visit.node_id(), next_backward));
+            edge_t edge1 = edge_between(augmented.get_graph(),
+                                        NodeSide(traversals[allele].visit(0).node_id(),
+                                                 !traversals[allele].visit(0).backward()),
+                                        NodeSide(next_visit.node_id(), next_backward));
             
             // the edge going into the site's end
             const Visit& prev_visit = traversals[allele].visit(trav_size - 2).node_id() ?
@@ -857,21 +893,18 @@ vector<Support> SupportCaller::get_inversion_supports(
             bool prev_backward = traversals[allele].visit(trav_size - 2).node_id() ?
                 traversals[allele].visit(trav_size - 2).backward() :
                 prev_visit.backward() != traversals[allele].visit(trav_size - 2).backward();
-            Edge* edge2 = augmented.graph.get_edge(NodeSide(prev_visit.node_id(), !prev_backward),
-                                                   NodeSide(traversals[allele].visit(trav_size - 1).node_id(),
-                                                            traversals[allele].visit(trav_size - 1).backward()));
-
-            assert(edge1 != nullptr && edge2 != nullptr);
+            edge_t edge2 = edge_between(augmented.get_graph(),
+                                        NodeSide(prev_visit.node_id(), !prev_backward),
+                                        NodeSide(traversals[allele].visit(trav_size - 1).node_id(),
+                                                 traversals[allele].visit(trav_size - 1).backward()));
 
-            edge_t edge_handle1 = augmented.graph.edge_handle(augmented.graph.get_handle(edge1->from(), edge1->from_start()),
-                                                              augmented.graph.get_handle(edge1->to(), edge2->to_end()));
-            edge_t edge_handle2 = augmented.graph.edge_handle(augmented.graph.get_handle(edge2->from(), edge2->from_start()),
-                                                              augmented.graph.get_handle(edge2->to(), edge2->to_end()));
+            assert(augmented.get_graph().has_edge(edge1.first, edge1.second) &&
+                   augmented.get_graph().has_edge(edge2.first, edge2.second));
 
             if (longest_traversal_length > average_support_switch_threshold || use_average_support) {
-                inversion_supports[allele] = (augmented.get_support(edge_handle1) + augmented.get_support(edge_handle2) / 2);
+                inversion_supports[allele] = (augmented.get_support(edge1) + augmented.get_support(edge2)) / 2;
             } else {
-                inversion_supports[allele] = min(augmented.get_support(edge_handle2), augmented.get_support(edge_handle2));
+                inversion_supports[allele] = min(augmented.get_support(edge1), augmented.get_support(edge2));
             }
         }
     }
@@ -1364,7 +1397,7 @@ vector<SnarlTraversal> SupportCaller::find_best_traversals(
         
         for (size_t i = 0; i < concrete_traversal.visit_size(); i++) {
             // Convert all the visits to Mappings and stick them in the Locus's Paths
-            *converted->add_mapping() = to_mapping(concrete_traversal.visit(i), augmented.graph);
+            *converted->add_mapping() = to_mapping(concrete_traversal.visit(i), augmented.get_graph());
         }
     }
 
@@ -1439,7 +1472,8 @@ void SupportCaller::emit_variant(map<string, string>& contig_names_by_path_name,
                                  SupportAugmentedGraph& augmented,
                                  Support& baseline_support,
                                  Support& global_baseline_support, 
-                                 const Locus& locus, PrimaryPath& primary_path, const Snarl* site) {
+                                 const Locus& locus, PrimaryPath& primary_path, const Snarl* site,
+                                 vector<BufferedVariant>& buffer) {
             
     // Note that the locus paths will traverse our site forward, which
     // may make them backward along the primary path.
@@ -1481,10 +1515,9 @@ void SupportCaller::emit_variant(map<string, string>& contig_names_by_path_name,
             auto& mapping = path.mapping(j);
                     
             // Record the sequence
-            string node_sequence = augmented.graph.get_node(mapping.position().node_id())->sequence();
-            if (mapping.position().is_reverse()) {
-                node_sequence = reverse_complement(node_sequence);
-            }
+            const PathHandleGraph& graph = augmented.get_graph();
+            string node_sequence = graph.get_sequence(graph.get_handle(mapping.position().node_id(),
+                                                                       mapping.position().is_reverse()));
             sequence_stream << node_sequence;
 #ifdef debug
             cerr << "\tMapping: " << pb2json(mapping) << ", sequence " << node_sequence << endl;
@@ -1726,7 +1759,7 @@ void SupportCaller::emit_variant(map<string, string>& contig_names_by_path_name,
 
     // Now fill in all the other variant info/format stuff and emit it 
     add_variant_info_and_emit(variant, augmented, locus, genotype, best_allele, second_best_allele, used_alleles,
-                              baseline_support, global_baseline_support);
+                              baseline_support, global_baseline_support, buffer);
 }
 
 void SupportCaller::emit_recall_variant(map<string, string>& contig_names_by_path_name,
@@ -1735,7 +1768,8 @@ void SupportCaller::emit_recall_variant(map<string, string>& contig_names_by_pat
                                         Support& baseline_support,
                                         Support& global_baseline_support, 
                                         const Locus& locus, PrimaryPath& primary_path, const Snarl* site,
-                                        const vcflib::Variant* recall_variant) {
+                                        const vcflib::Variant* recall_variant,
+                                        vector<BufferedVariant>& buffer) {
 
     vcflib::Variant variant;
     variant.setVariantCallFile(vcf);
@@ -1793,7 +1827,7 @@ void SupportCaller::emit_recall_variant(map<string, string>& contig_names_by_pat
     
     
     add_variant_info_and_emit(variant, augmented, locus, genotype, best_allele, second_best_allele,
-                              used_alleles, baseline_support, global_baseline_support);
+                              used_alleles, baseline_support, global_baseline_support, buffer);
 }
 
 
@@ -1801,7 +1835,8 @@ void SupportCaller::add_variant_info_and_emit(vcflib::Variant& variant, SupportA
                                               const Locus& locus, const Genotype& genotype,
                                               int best_allele, int second_best_allele,
                                               const vector<int>& used_alleles,
-                                              Support& baseline_support, Support& global_baseline_support) {
+                                              Support& baseline_support, Support& global_baseline_support,
+                                              vector<BufferedVariant>& buffer) {
     
     // Set up the depth format field
     variant.format.push_back("DP");
@@ -1924,9 +1959,10 @@ void SupportCaller::add_variant_info_and_emit(vcflib::Variant& variant, SupportA
             
         if(can_write_alleles(variant)) {
             // No need to check for collisions because we assume sites are correctly found.
-            // Output the created VCF variant.
-#pragma omp critical (cout)
-            cout << variant << endl;
+            // Save the created VCF variant for output.
+            stringstream line;
+            line << variant;
+            buffer.push_back({variant.position, line.str()});
             
         } else {
             if (verbose) {
@@ -1953,18 +1989,23 @@ void SupportCaller::call(
     augmented.graph.paths.sort_by_mapping_rank();
     augmented.graph.paths.rebuild_mapping_aux();
 
+    // Work on the augmented VG, or on the graph standing in for it
+    const PathHandleGraph& graph = augmented.get_graph();
+
     // Make a list of the specified or autodetected primary reference paths.
     vector<string> primary_path_names = ref_path_names;
     if (primary_path_names.empty()) {
         // Try and guess reference path names for VCF conversion or coverage measurement.
         if (verbose) {
-          std:cerr << "Graph has " << augmented.graph.paths.size() << " paths to choose from."
+          std:cerr << "Graph has " << graph.get_path_count() << " paths to choose from."
                    << endl;
         }
-        if(augmented.graph.paths.size() == 1) {
+        if(graph.get_path_count() == 1) {
             // Autodetect the reference path name as the name of the only path
-            primary_path_names.push_back((*augmented.graph.paths._paths.begin()).first);
-        } else if (augmented.graph.paths.has_path("ref")) {
+            graph.for_each_path_handle([&](const path_handle_t& path_handle) {
+                primary_path_names.push_back(graph.get_path_name(path_handle));
+            });
+        } else if (graph.has_path("ref")) {
             // Take any "ref" path.
             primary_path_names.push_back("ref");
         }
@@ -2023,6 +2064,9 @@ void SupportCaller::call(
     // We also might need to fillin this contig names by path name map
     map<string, string> contig_names_by_path_name;
     
+    // And we keep the VCF header text, in case we can't write it out right away.
+    string vcf_header;
+    
     if (convert_to_vcf) {
         // Do initial setup for VCF output
         
@@ -2065,11 +2109,14 @@ void SupportCaller::call(
             min_ad_log_likelihood_for_filter, augmented.has_base_graph());
         
         // Load the headers into a the VCF file object
-        string header_string = header_stream.str();
-        assert(vcf.openForOutput(header_string));
+        vcf_header = header_stream.str();
+        assert(vcf.openForOutput(vcf_header));
         
-        // Spit out the header
-        cout << header_stream.str();
+        if (((string)checkpoint_dir).empty()) {
+            // Spit out the header. When checkpointing, it goes out with the
+            // regions once they are all done.
+            cout << vcf_header;
+        }
     }
     
     // Find all the top-level sites
@@ -2199,7 +2246,7 @@ void SupportCaller::call(
         for (const auto& primary_path : primary_paths) {
             ref_path_names.push_back(primary_path.first);
         }
-        traversal_finder = unique_ptr<TraversalFinder>(new VCFTraversalFinder(augmented.graph, site_manager,
+        traversal_finder = unique_ptr<TraversalFinder>(new VCFTraversalFinder(graph, site_manager,
                                                                               variant_file, ref_path_names,
                                                                               ref_fasta.get(),
                                                                               ins_fasta.get(),
@@ -2219,7 +2266,7 @@ void SupportCaller::call(
                 return augmented.get_support(edge);
             };
         }
-        RepresentativeTraversalFinder* rep_trav_finder = new RepresentativeTraversalFinder(augmented.graph, site_manager,
+        RepresentativeTraversalFinder* rep_trav_finder = new RepresentativeTraversalFinder(graph, site_manager,
                                                                                            max_search_depth,
                                                                                            max_search_width,
                                                                                            max_bubble_paths,
@@ -2229,14 +2276,27 @@ void SupportCaller::call(
                                                                                            get_node_support,
                                                                                            get_edge_support);
         rep_trav_finder->other_orientation_timeout = max_inversion_size;
+        rep_trav_finder->report_site_times = verbose;
         traversal_finder = unique_ptr<TraversalFinder>(rep_trav_finder);
     }
     
-    // We're going to remember what nodes and edges are covered by sites, so we
-    // will know which nodes/edges aren't in any sites and may need generic
-    // presence/absence calls.
-    set<Node*> covered_nodes;
-    set<Edge*> covered_edges;
+    // We're going to remember what edges are covered by sites, so we will know
+    // which edges aren't in any sites and may need generic presence/absence
+    // calls. We mark both sides of every node inside a called site, and the
+    // inward sides of its boundary nodes. Any edge touching those sides must
+    // be in the site, so an edge is covered exactly when both its sides are
+    // marked.
+    id_t covered_min_id = graph.get_node_count() > 0 ? graph.min_node_id() : 0;
+    size_t covered_id_span = graph.get_node_count() > 0 ? graph.max_node_id() - covered_min_id + 1 : 0;
+    AtomicBitset covered_sides(2 * covered_id_span);
+    auto side_index = [&](id_t node_id, bool is_end) {
+        return (size_t) (node_id - covered_min_id) * 2 + is_end;
+    };
+    auto is_covered = [&](const edge_t& edge) {
+        // The edge leaves the end of its first handle and enters the start of its second
+        return covered_sides.test(side_index(graph.get_id(edge.first), !graph.get_is_reverse(edge.first))) &&
+            covered_sides.test(side_index(graph.get_id(edge.second), graph.get_is_reverse(edge.second)));
+    };
     
     // When we genotype the sites into Locus objects, we will use this buffer for outputting them.
     vector<Locus> locus_buffer;
@@ -2244,107 +2304,264 @@ void SupportCaller::call(
     // How many sites result in output?
     size_t called_loci = 0;
 
-
-#pragma omp parallel for
-    for(size_t site_number = 0; site_number < sites.size(); ++site_number) {
-        const Snarl* site = sites[site_number];
-        // For every site, we're going to make a bunch of Locus objects
-        
-        // See if the site is on a primary path, so we can use binned support.
-        map<string, PrimaryPath>::iterator found_path = find_path(*site);
-        
-        // We need to figure out how much support a site ought to have.
-        // Within its local bin?
-        Support baseline_support;
-        // On its primary path?
-        Support global_baseline_support;
-        if (expected_coverage != 0.0) {
-            // Use the specified coverage override
-            baseline_support.set_forward(expected_coverage / 2);
-            baseline_support.set_reverse(expected_coverage / 2);
-            global_baseline_support = baseline_support;
-        } else if (found_path != primary_paths.end()) {
-            // We're on a primary path, so we can find the appropriate bin
-        
-            // Since the variable part of the site is after the first anchoring node, where does it start?
-            // Account for the site possibly being backward on the path.
-            size_t variation_start = min(found_path->second.get_index().by_id.at(site->start().node_id()).first
-                    + augmented.graph.get_node(site->start().node_id())->sequence().size(),
-                found_path->second.get_index().by_id.at(site->end().node_id()).first
-                    + augmented.graph.get_node(site->end().node_id())->sequence().size());
-            
-            // Look in the bins for the primary path to get the support there.
-            baseline_support = found_path->second.get_support_at(variation_start);
-            
-            // And grab the path's overall support
-            global_baseline_support = found_path->second.get_average_support();
+    // Put the sites in order along the primary paths, so we can write out
+    // their calls in order. Sites not on a primary path go at the end.
+    map<string, size_t> path_ranks;
+    for (size_t i = 0; i < primary_path_names.size(); i++) {
+        path_ranks.emplace(primary_path_names[i], i);
+    }
+    vector<pair<pair<size_t, size_t>, size_t>> site_order(sites.size());
+    for (size_t i = 0; i < sites.size(); i++) {
+        pair<size_t, size_t> key(numeric_limits<size_t>::max(), numeric_limits<size_t>::max());
+        auto found = find_path(*sites[i]);
+        if (found != primary_paths.end()) {
+            auto& index = found->second.get_index();
+            key = make_pair(path_ranks.at(found->first),
+                            min(index.by_id.at(sites[i]->start().node_id()).first,
+                                index.by_id.at(sites[i]->end().node_id()).first));
+        }
+        site_order[i] = make_pair(key, i);
+    }
+    std::sort(site_order.begin(), site_order.end());
+
+    // Call the sites in the given range of site_order, and write out their
+    // calls in order to the given stream.
+    auto call_sites = [&](size_t sites_begin, size_t sites_end, ostream& out) {
+        for (size_t window_start = sites_begin; window_start < sites_end; window_start += sites_per_window) {
+            size_t window_end = min(window_start + sites_per_window, sites_end);
+
+            // Each site in the window gets its own output buffers, so the threads
+            // never have to wait on each other to save their results
+            vector<vector<BufferedVariant>> window_variants(window_end - window_start);
+            vector<vector<Locus>> window_loci(window_end - window_start);
+
+#pragma omp parallel for schedule(dynamic, 1)
+            for(size_t order_number = window_start; order_number < window_end; ++order_number) {
+                const Snarl* site = sites[site_order[order_number].second];
+                vector<BufferedVariant>& site_variants = window_variants[order_number - window_start];
+                vector<Locus>& site_loci = window_loci[order_number - window_start];
+                // For every site, we're going to make a bunch of Locus objects
+        
+                // See if the site is on a primary path, so we can use binned support.
+                map<string, PrimaryPath>::iterator found_path = find_path(*site);
+        
+                // We need to figure out how much support a site ought to have.
+                // Within its local bin?
+                Support baseline_support;
+                // On its primary path?
+                Support global_baseline_support;
+                if (expected_coverage != 0.0) {
+                    // Use the specified coverage override
+                    baseline_support.set_forward(expected_coverage / 2);
+                    baseline_support.set_reverse(expected_coverage / 2);
+                    global_baseline_support = baseline_support;
+                } else if (found_path != primary_paths.end()) {
+                    // We're on a primary path, so we can find the appropriate bin
+        
+                    // Since the variable part of the site is after the first anchoring node, where does it start?
+                    // Account for the site possibly being backward on the path.
+                    size_t variation_start = min(found_path->second.get_index().by_id.at(site->start().node_id()).first
+                            + graph.get_length(graph.get_handle(site->start().node_id())),
+                        found_path->second.get_index().by_id.at(site->end().node_id()).first
+                            + graph.get_length(graph.get_handle(site->end().node_id())));
+            
+                    // Look in the bins for the primary path to get the support there.
+                    baseline_support = found_path->second.get_support_at(variation_start);
+            
+                    // And grab the path's overall support
+                    global_baseline_support = found_path->second.get_average_support();
             
-        } else {
-            // Just use the primary paths' average support, which may be 0 if there are none.
-            // How much support is expected across all the primary paths? May be 0 if there are no primary paths.
-            global_baseline_support = PrimaryPath::get_average_support(primary_paths);
-            baseline_support = global_baseline_support;
-        }
+                } else {
+                    // Just use the primary paths' average support, which may be 0 if there are none.
+                    // How much support is expected across all the primary paths? May be 0 if there are no primary paths.
+                    global_baseline_support = PrimaryPath::get_average_support(primary_paths);
+                    baseline_support = global_baseline_support;
+                }
            
-        // Recursively type the site, using that support and an assumption of a diploid sample.
-        find_best_traversals(augmented, site_manager, traversal_finder.get(), *site, baseline_support, 2,
-            [&](const Locus& locus, const Snarl* site, const vcflib::Variant* recall_variant = nullptr) {
-            
-            // Now we have the Locus with call information, and the site (either
-            // the root snarl we passed in or a child snarl) that the call is
-            // for. We need to output the call.
-            if (convert_to_vcf) {
-                // We want to emit VCF
+                // Recursively type the site, using that support and an assumption of a diploid sample.
+                find_best_traversals(augmented, site_manager, traversal_finder.get(), *site, baseline_support, 2,
+                    [&](const Locus& locus, const Snarl* site, const vcflib::Variant* recall_variant = nullptr) {
+            
+                    // Now we have the Locus with call information, and the site (either
+                    // the root snarl we passed in or a child snarl) that the call is
+                    // for. We need to output the call.
+                    if (convert_to_vcf) {
+                        // We want to emit VCF
                 
-                // Look up the path this child site lives on. (TODO: just capture and use the path the parent lives on?)
-                auto found_path = find_path(*site);
-                if(found_path != primary_paths.end()) {
-                    // And this site is on a primary path
+                        // Look up the path this child site lives on. (TODO: just capture and use the path the parent lives on?)
+                        auto found_path = find_path(*site);
+                        if(found_path != primary_paths.end()) {
+                            // And this site is on a primary path
                     
-                    // Emit the variant for this Locus
-                    if (recall_variant != nullptr) {
-                        emit_recall_variant(contig_names_by_path_name, vcf, augmented, baseline_support,
-                                            global_baseline_support, locus, found_path->second, site, recall_variant);
+                            // Emit the variant for this Locus
+                            if (recall_variant != nullptr) {
+                                emit_recall_variant(contig_names_by_path_name, vcf, augmented, baseline_support,
+                                                    global_baseline_support, locus, found_path->second, site, recall_variant,
+                                                    site_variants);
+                            } else {
+                                emit_variant(contig_names_by_path_name, vcf, augmented, baseline_support,
+                                             global_baseline_support, locus, found_path->second, site, site_variants);
+                            }
+                        }
+                        // Otherwise discard it as off-path
+                        // TODO: update bases lost
                     } else {
-                        emit_variant(contig_names_by_path_name, vcf, augmented, baseline_support,
-                                     global_baseline_support, locus, found_path->second, site);
+                        // Emit the locus itself
+                        site_loci.push_back(locus);
+                    }
+            
+                    // We called a site
+#pragma omp atomic
+                    called_loci++;
+            
+                    // Mark all the edges in the site as covered
+                    if (!convert_to_vcf) {
+                        auto contents = site_manager.deep_contents(site, graph, false);
+                        for (id_t node_id : contents.first) {
+                            covered_sides.set(side_index(node_id, false));
+                            covered_sides.set(side_index(node_id, true));
+                        }
+                        covered_sides.set(side_index(site->start().node_id(), !site->start().backward()));
+                        covered_sides.set(side_index(site->end().node_id(), site->end().backward()));
                     }
+                });
+            }
+
+            // Write out the window's calls in site order, and in position order within each site
+            for (size_t i = 0; i < window_variants.size(); i++) {
+                std::stable_sort(window_variants[i].begin(), window_variants[i].end(),
+                                 [](const BufferedVariant& a, const BufferedVariant& b) {
+                                     return a.position < b.position;
+                                 });
+                for (auto& variant : window_variants[i]) {
+                    out << variant.line << endl;
                 }
-                // Otherwise discard it as off-path
-                // TODO: update bases lost
-            } else {
-#pragma omp critical (cout)
-                {
-                    // Emit the locus itself
-                    locus_buffer.push_back(locus);
-                    vg::io::write_buffered(cout, locus_buffer, locus_buffer_size);
+                for (auto& locus : window_loci[i]) {
+                    locus_buffer.push_back(std::move(locus));
+                    vg::io::write_buffered(out, locus_buffer, locus_buffer_size);
                 }
             }
+        }
+    };
+
+    if (((string)checkpoint_dir).empty()) {
+        // Call everything in one go
+        call_sites(0, site_order.size(), cout);
+    } else {
+        // Call region by region, saving each region's VCF records in the
+        // checkpoint directory. A region's fragment only gets its final name
+        // once it is complete, so any fragment we find there is finished, by
+        // this run or by an earlier or concurrent one.
+        string dir = checkpoint_dir;
+        mkdir(dir.c_str(), 0755);
+        
+        // Record the options the calls were made with, so we don't mix
+        // fragments called different ways. The directory and shard options
+        // can differ between runs that share the same fragments.
+        stringstream manifest;
+        for (OptionInterface* option : get_options()) {
+            const string& name = option->get_long_option();
+            if (name != "checkpoint-dir" && name != "shards" && name != "shard") {
+                manifest << "#" << name << "\t" << option->get_value() << endl;
+            }
+        }
+        
+        // Cut each primary path, in order, into regions, as path rank, start
+        // and past-end offsets. Sites belong to the region they start in.
+        // Sites not on a primary path are never called, since their VCF
+        // records would be thrown out as off-path anyway.
+        vector<tuple<size_t, size_t, size_t>> regions;
+        for (size_t i = 0; i < primary_path_names.size(); i++) {
+            size_t path_length = primary_paths.at(primary_path_names[i]).get_index().sequence.size();
+            for (size_t start = 0; start < path_length; start += region_size) {
+                regions.emplace_back(i, start, min(start + region_size, path_length));
+                manifest << primary_path_names[i] << "\t" << start << "\t" << get<2>(regions.back()) << endl;
+            }
+        }
+        
+        // Make sure the directory's fragments are for the same options and
+        // regions.
+        string manifest_name = dir + "/regions.tsv";
+        ifstream old_manifest(manifest_name);
+        if (old_manifest) {
+            stringstream old_contents;
+            old_contents << old_manifest.rdbuf();
+            if (old_contents.str() != manifest.str()) {
+                cerr << "error:[vg call] checkpoint directory " << dir
+                     << " holds calls made with different options or regions; use a new directory" << endl;
+                exit(1);
+            }
+        } else {
+            string temp_name = manifest_name + "." + to_string(getpid());
+            ofstream new_manifest(temp_name);
+            new_manifest << manifest.str();
+            new_manifest.close();
+            if (!new_manifest || rename(temp_name.c_str(), manifest_name.c_str()) != 0) {
+                cerr << "error:[vg call] could not write to checkpoint directory " << dir << endl;
+                exit(1);
+            }
+        }
+        
+        auto fragment_name = [&](size_t region_number) {
+            return dir + "/region_" + to_string(region_number) + ".vcf";
+        };
+        auto region_done = [&](size_t region_number) {
+            return ifstream(fragment_name(region_number)).good();
+        };
+        
+        for (size_t i = region_shard; i < regions.size(); i += region_shards) {
+            // Do our share of the regions
+            if (region_done(i)) {
+                if (verbose) {
+                    cerr << "Skipping finished region " << i << endl;
+                }
+                continue;
+            }
             
-            // We called a site
-#pragma omp atomic
-            called_loci++;
-            
-            // Mark all the nodes and edges in the site as covered
-            if (!convert_to_vcf) {
-                auto contents = site_manager.deep_contents(site, augmented.graph, true);
-#pragma omp critical (covered)            
-                {
-                    for (auto& node_id : contents.first) {
-                        Node* node = augmented.graph.get_node(node_id);
-                        covered_nodes.insert(node);
-                    }
-                    for (auto& edge_handle : contents.second) {
-                        Edge* edge = augmented.graph.get_edge(
-                            NodeTraversal(augmented.graph.get_node(augmented.graph.get_id(edge_handle.first)),
-                                          augmented.graph.get_is_reverse(edge_handle.first)),
-                            NodeTraversal(augmented.graph.get_node(augmented.graph.get_id(edge_handle.second)),
-                                          augmented.graph.get_is_reverse(edge_handle.second)));
-                        covered_edges.insert(edge);
-                    }
+            // Find the sites that start in the region
+            auto& region = regions[i];
+            size_t region_begin = lower_bound(site_order.begin(), site_order.end(),
+                make_pair(make_pair(get<0>(region), get<1>(region)), (size_t) 0)) - site_order.begin();
+            size_t region_end = lower_bound(site_order.begin(), site_order.end(),
+                make_pair(make_pair(get<0>(region), get<2>(region)), (size_t) 0)) - site_order.begin();
+            
+            // Other shards may be working in the same directory, so keep our
+            // unfinished fragment under a name of our own.
+            string temp_name = fragment_name(i) + "." + to_string(getpid()) + ".tmp";
+            ofstream fragment(temp_name);
+            call_sites(region_begin, region_end, fragment);
+            fragment.close();
+            if (!fragment || rename(temp_name.c_str(), fragment_name(i).c_str()) != 0) {
+                cerr << "error:[vg call] could not write region " << i << " to checkpoint directory " << dir << endl;
+                exit(1);
+            }
+            
+            if (verbose) {
+                cerr << "Finished region " << i << " (" << primary_path_names[get<0>(region)] << ":"
+                     << get<1>(region) << "-" << get<2>(region) << ", " << (region_end - region_begin)
+                     << " sites)" << endl;
+            }
+        }
+        
+        size_t regions_left = 0;
+        for (size_t i = 0; i < regions.size(); i++) {
+            regions_left += !region_done(i);
+        }
+        
+        if (regions_left == 0) {
+            // Everything is called, so put the regions together in order.
+            cout << vcf_header;
+            for (size_t i = 0; i < regions.size(); i++) {
+                ifstream fragment(fragment_name(i));
+                if (fragment.peek() != EOF) {
+                    // Don't stream empty fragments, which would fail cout
+                    cout << fragment.rdbuf();
                 }
             }
-        });
+        } else {
+            cerr << "[vg call]: " << regions_left << " of " << regions.size() << " regions in " << dir
+                 << " remain to be called by other shards; run again once they are done to write the VCF" << endl;
+        }
     }
     
     if (verbose) {
@@ -2363,20 +2580,20 @@ void SupportCaller::call(
             // We should look at the coverage of things off the primary path and
             // make calls on them.
         
-            augmented.graph.for_each_edge([&](Edge* e) {
+            graph.for_each_edge([&](const edge_t& e) {
                 // We want to make calls on all the edges that aren't covered yet
-                if (covered_edges.count(e)) {
+                if (is_covered(e)) {
                     // Skip this edge
                     return;
                 }
                 
                 // Make a couple of fake Visits
                 Visit from_visit;
-                from_visit.set_node_id(e->from());
-                from_visit.set_backward(e->from_start());
+                from_visit.set_node_id(graph.get_id(e.first));
+                from_visit.set_backward(graph.get_is_reverse(e.first));
                 Visit to_visit;
-                to_visit.set_node_id(e->to());
-                to_visit.set_backward(e->to_end());
+                to_visit.set_node_id(graph.get_id(e.second));
+                to_visit.set_backward(graph.get_is_reverse(e.second));
                 
                 // Make a Locus for the edge
                 Locus locus;
@@ -2385,14 +2602,12 @@ void SupportCaller::call(
                 Path* path = locus.add_allele();
                 
                 // Fill in 
-                *path->add_mapping() = to_mapping(from_visit, augmented.graph);
-                *path->add_mapping() = to_mapping(to_visit, augmented.graph);
+                *path->add_mapping() = to_mapping(from_visit, graph);
+                *path->add_mapping() = to_mapping(to_visit, graph);
                 
                 // Set the support
-                edge_t edge_handle = augmented.graph.edge_handle(augmented.graph.get_handle(e->from(), e->from_start()),
-                                                                 augmented.graph.get_handle(e->to(), e->to_end()));
-                *locus.add_support() = augmented.get_support(edge_handle);
-                *locus.mutable_overall_support() = augmented.get_support(edge_handle);
+                *locus.add_support() = augmented.get_support(e);
+                *locus.mutable_overall_support() = augmented.get_support(e);
                 
                 // Decide on the genotype
                 Genotype gt;
@@ -2445,10 +2660,10 @@ void SupportCaller::call(
                     }
                     
                     // Find the edge we crossed
-                    Edge* crossed = augmented.graph.get_edge(previous_end, here);
-                    assert(crossed != nullptr);
+                    edge_t crossed = edge_between(graph, previous_end, here);
+                    assert(graph.has_edge(crossed.first, crossed.second));
                     
-                    if (covered_edges.count(crossed)) {
+                    if (is_covered(crossed)) {
                         // If the edge we crossed is covered by a snarl, don't
                         // emit anything.
                         previous_end = here.flip();
@@ -2458,13 +2673,13 @@ void SupportCaller::call(
                     // If the edge we're crossing isn't covered, we should
                     // assert the primary path here.
                     
-                    // Make a couple of fake Visits
+                    // Make a couple of fake Visits, along the path
                     Visit from_visit;
-                    from_visit.set_node_id(crossed->from());
-                    from_visit.set_backward(crossed->from_start());
+                    from_visit.set_node_id(previous_end.node);
+                    from_visit.set_backward(!previous_end.is_end);
                     Visit to_visit;
-                    to_visit.set_node_id(crossed->to());
-                    to_visit.set_backward(crossed->to_end());
+                    to_visit.set_node_id(here.node);
+                    to_visit.set_backward(here.is_end);
                     
                     // Make a Locus for the edge
                     Locus locus;
@@ -2473,14 +2688,12 @@ void SupportCaller::call(
                     Path* path = locus.add_allele();
                     
                     // Fill in 
-                    *path->add_mapping() = to_mapping(from_visit, augmented.graph);
-                    *path->add_mapping() = to_mapping(to_visit, augmented.graph);
+                    *path->add_mapping() = to_mapping(from_visit, graph);
+                    *path->add_mapping() = to_mapping(to_visit, graph);
 
-                    edge_t crossed_handle = augmented.graph.edge_handle(augmented.graph.get_handle(crossed->from(), crossed->from_start()),
-                                                                        augmented.graph.get_handle(crossed->to(), crossed->to_end()));
                     // Set the support
-                    *locus.add_support() = augmented.get_support(crossed_handle);
-                    *locus.mutable_overall_support() = augmented.get_support(crossed_handle);
+                    *locus.add_support() = augmented.get_support(crossed);
+                    *locus.mutable_overall_support() = augmented.get_support(crossed);
                     
                     // Decide on the genotype of hom ref.
                     Genotype* gt = locus.add_genotype();
@@ -2525,15 +2738,13 @@ bool SupportCaller::is_reference(const SnarlTraversal& trav, AugmentedGraph& aug
         
         if (previous.node != 0) {
             // Consider the edge from the previous visit
-            Edge* edge = augmented.graph.get_edge(previous, to_left_side(visit));
-            
-            if (augmented.is_novel_edge(edge)) {
+            if (augmented.is_novel_edge(previous, to_left_side(visit))) {
                 // Found a novel edge!
                 return false;
             }
         }
 
-        if (augmented.is_novel_node(augmented.graph.get_node(visit.node_id()))) {
+        if (augmented.is_novel_node(visit.node_id())) {
             // This node itself is novel
             return false;         
         }
@@ -2568,7 +2779,7 @@ bool SupportCaller::is_reference(const Path& path, AugmentedGraph& augmented) {
         // Check each mapping
         auto& mapping = path.mapping(i);
 
-        if (augmented.is_novel_node(augmented.graph.get_node(mapping.position().node_id()))) {
+        if (augmented.is_novel_node(mapping.position().node_id())) {
             // We use a novel node
             return false;
         }
@@ -2578,8 +2789,7 @@ bool SupportCaller::is_reference(const Path& path, AugmentedGraph& augmented) {
             auto& next_mapping = path.mapping(i + 1);
             
             // And see about the edge to it
-            Edge* edge = augmented.graph.get_edge(to_right_side(to_visit(mapping)), to_left_side(to_visit(next_mapping)));
-            if (augmented.is_novel_edge(edge)) {
+            if (augmented.is_novel_edge(to_right_side(to_visit(mapping)), to_left_side(to_visit(next_mapping)))) {
                 // We used a novel edge
                 return false;
             }
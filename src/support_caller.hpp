@@ -210,16 +210,25 @@ public:
                       vector<vcflib::Variant*>& site_variants,
                       function<void(const Locus&, const Snarl*, const vcflib::Variant*)> emit_locus);
 
+    /// A VCF record that has been made for a site but not written out yet,
+    /// with the position it sorts by among the site's records
+    struct BufferedVariant {
+        long position;
+        string line;
+    };
+
     /** This function emits the given variant on the given primary path, as
-     * VCF. It needs to take the site as an argument because it may be
-     * called for children of the site we're working on right now.
+     * VCF, into the given buffer. It needs to take the site as an argument
+     * because it may be called for children of the site we're working on
+     * right now.
      */
     void emit_variant(map<string, string>& contig_names_by_path_name,
                       vcflib::VariantCallFile& vcf,
                       SupportAugmentedGraph& augmented,
                       Support& baseline_support,
                       Support& global_baseline_support, 
-                      const Locus& locus, PrimaryPath& primary_path, const Snarl* site);
+                      const Locus& locus, PrimaryPath& primary_path, const Snarl* site,
+                      vector<BufferedVariant>& buffer);
 
     /** Like emit_variant, but use the given vcf variant as a template and just 
      * compute the genotype and info */
@@ -229,7 +238,8 @@ public:
                              Support& baseline_support,
                              Support& global_baseline_support, 
                              const Locus& locus, PrimaryPath& primary_path, const Snarl* site,
-                             const vcflib::Variant* recall_variant);
+                             const vcflib::Variant* recall_variant,
+                             vector<BufferedVariant>& buffer);
 
     /** add the info fields to a variant and actually emit it 
      * (used by both emit_variant and emit_recall_variant) */
@@ -237,7 +247,8 @@ public:
                                    const Locus& locus, const Genotype& genotype,
                                    int best_allele, int second_best_allele,
                                    const vector<int>& used_alleles,
-                                   Support& baseline_support, Support& global_baseline_support);
+                                   Support& baseline_support, Support& global_baseline_support,
+                                   vector<BufferedVariant>& buffer);
 
     /**
      * Decide if the given SnarlTraversal is included in the original base graph
@@ -292,6 +303,8 @@ public:
         "output variants in binary Loci format instead of text VCF format"};
     /// How big should our output buffer be?
     size_t locus_buffer_size = 1000;
+    /// How many sites should we call at once before writing out their output in order?
+    size_t sites_per_window = 4096;
     
     /// What are the names of the reference paths, if any, in the graph?
     Option<vector<string>> ref_path_names{this, "ref", "r", {},
@@ -425,11 +438,31 @@ public:
 
     /// Path of pack file generated from vg pack
     Option<string> pack_file_name{this, "pack-file", "P", {}, 
-            "path of pack file from vg pack"};
+            "path of pack file from vg pack (the graph can then be left out, to call on the -x index)"};
 
     Option<string> xg_file_name{this, "xg-file", "x", {},
             "path of xg file (required to read pack file with -P)"};
 
+    /// If set, call the reference paths region by region, keeping each
+    /// finished region's VCF records in this directory so an interrupted run
+    /// can pick up where it left off. The directory's regions.tsv records the
+    /// regions and the other options, and a run with different ones is
+    /// refused.
+    Option<string> checkpoint_dir{this, "checkpoint-dir", "kK", "",
+            "call by region, saving finished regions in this directory and skipping those already there"};
+
+    /// How long are the reference path regions we checkpoint?
+    Option<size_t> region_size{this, "region-size", "LQ", 10000000,
+            "length in bp of the reference regions to checkpoint with --checkpoint-dir"};
+
+    /// How many independent runs are the regions split across?
+    Option<size_t> region_shards{this, "shards", "NJ", 1,
+            "split the regions across this many runs sharing the --checkpoint-dir"};
+
+    /// Which of those runs is this one?
+    Option<size_t> region_shard{this, "shard", "yY", 0,
+            "0-based number of this run when using --shards"};
+
     /// structures to hold the recall vcf and fastas
     vcflib::VariantCallFile variant_file;
     unique_ptr<FastaReference> ref_fasta;
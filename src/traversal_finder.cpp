@@ -4,6 +4,8 @@
 #include "algorithms/is_acyclic.hpp"
 #include "cactus.hpp"
 
+#include <chrono>
+
 //#define debug
 
 namespace vg {
@@ -1043,6 +1045,9 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
     // TODO: We don't ignore children, but this check does!
     assert(site.directed_acyclic_net_graph());
     
+    // Time the whole site, so expensive ones can be found
+    auto site_start_time = chrono::steady_clock::now();
+    
     const Snarl* managed_site = snarl_manager.manage(site);
     
     // We may need to make a new index for a backbone for this site, if it's not
@@ -1529,6 +1534,11 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
         
     };
 
+    // Bubble searches from different nodes, edges, and children of the site
+    // start out from many of the same visits, so remember the searches we
+    // have done.
+    SearchMemo memo;
+
 #ifdef debug
     cerr << "Explore " << contents.first.size() << " nodes" << endl;
 #endif
@@ -1556,7 +1566,7 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
 #endif
         
         // Find bubbles that backend into the backbone path
-        pair<Support, vector<Visit>> sup_path = find_bubble(node_id, nullptr, nullptr, index, site);
+        pair<Support, vector<Visit>> sup_path = find_bubble(node_id, nullptr, nullptr, index, site, &memo);
 
         vector<Visit>& path = sup_path.second;
         
@@ -1611,7 +1621,7 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
 #endif
         
         // Find a path based around this edge
-        pair<Support, vector<Visit>> sup_path = find_bubble(0, &edge, nullptr, index, site);
+        pair<Support, vector<Visit>> sup_path = find_bubble(0, &edge, nullptr, index, site, &memo);
         vector<Visit>& path = sup_path.second;
         
 #ifdef debug
@@ -1657,7 +1667,7 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
 #endif
         
         // Find a path based around this child snarl
-        pair<Support, vector<Visit>> sup_path = find_bubble(0, nullptr, child, index, site);
+        pair<Support, vector<Visit>> sup_path = find_bubble(0, nullptr, child, index, site, &memo);
         vector<Visit>& path = sup_path.second;
         
         if(path.empty()) {
@@ -1735,11 +1745,20 @@ vector<SnarlTraversal> RepresentativeTraversalFinder::find_traversals(const Snar
         
     }
     
+    if (report_site_times) {
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - site_start_time).count();
+#pragma omp critical (cerr)
+        cerr << "Site " << site.start() << " -> " << site.end() << ": " << unique_traversals.size()
+             << " traversals in " << seconds << " s, " << memo.searches << " searches, "
+             << memo.hits << " reused" << endl;
+    }
+    
     return unique_traversals;
 }
 
 pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t node, const edge_t* edge,
-                                                                        const Snarl* snarl, PathIndex& index, const Snarl& site) {
+                                                                        const Snarl* snarl, PathIndex& index, const Snarl& site,
+                                                                        SearchMemo* memo) {
 
     // What are we going to find our left and right path halves based on?
     Visit left_visit;
@@ -1817,56 +1836,19 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
 #endif
 
     // Find paths on both sides, with nodes or snarls on the primary path at
-    // the outsides and this visit in the middle. Returns path lengths,
-    // orientatioins in which the reference path was encountered, and paths in
-    // tuples in a set.
-    // Make sure to keep looking for the other orientation of the ref path
-    // after we find a first one, to handle inversions of up to a certain size.
-    auto leftPaths = bfs_left(left_visit, index, false, managed_site, other_orientation_timeout);
-    auto rightPaths = bfs_right(right_visit, index, false, managed_site, other_orientation_timeout);
-    
-    // Sort out the paths not just by whether they are left or right from here,
-    // but also by whether they hit the reference path in forward or reverse
-    // ref-path-relative orientation.
-    // TODO: give ImmutableList a .back() so we can avoid converting to real lists here.
-    list<list<Visit>> left_forward;
-    list<list<Visit>> right_forward;
-    list<list<Visit>> left_reverse;
-    list<list<Visit>> right_reverse;
-    
-    for (auto& annotatedPath : leftPaths) {
-        // Break up the paths on the left by orientation
-        auto& ref_reverse = get<1>(annotatedPath);
-        auto& path = get<2>(annotatedPath);
-        // TODO: ImmutableList iterators don't actually satisfy
-        // https://en.cppreference.com/w/cpp/named_req/Iterator because they
-        // lack the tyypedefs for std::iterator_traits. So we can't use them to
-        // construct lists. So we have to build the lists manually.
-        list<Visit> converted;
-        for (auto& item : path) {
-            converted.push_back(item);
-        }
-        (ref_reverse ? left_reverse : left_forward).emplace_back(move(converted));
-    }
-    
-    for (auto& annotatedPath : rightPaths) {
-        // Break up the paths on the right by orientation
-        auto& ref_reverse = get<1>(annotatedPath);
-        auto& path = get<2>(annotatedPath);
-        // TODO: ImmutableList iterators don't actually satisfy
-        // https://en.cppreference.com/w/cpp/named_req/Iterator because they
-        // lack the tyypedefs for std::iterator_traits. So we can't use them to
-        // construct lists. So we have to build the lists manually.
-        list<Visit> converted;
-        for (auto& item : path) {
-            converted.push_back(item);
-        }
-        (ref_reverse ? right_reverse : right_forward).emplace_back(move(converted));
-    }
+    // the outsides and this visit in the middle, sorted out not just by
+    // whether they are left or right from here, but also by whether they hit
+    // the reference path in forward or reverse ref-path-relative orientation.
+    // These may come from the memo if a neighboring node or edge in the site
+    // already searched from the same visit.
+    SearchFrontier left_scratch;
+    SearchFrontier right_scratch;
+    const SearchFrontier& left_paths = search_frontier(left_visit, false, index, managed_site, memo, left_scratch);
+    const SearchFrontier& right_paths = search_frontier(right_visit, true, index, managed_site, memo, right_scratch);
     
     // We need to look in different combinations of lists.
-    auto testCombinations = [&](const list<list<Visit>>& leftList,
-                                const list<list<Visit>>& rightList) -> pair<Support, vector<Visit>> {
+    auto testCombinations = [&](const list<pair<list<Visit>, Support>>& leftList,
+                                const list<pair<list<Visit>, Support>>& rightList) -> pair<Support, vector<Visit>> {
                                 
                                 
         // Find a combination of two paths which gets us to the reference and
@@ -1894,7 +1876,8 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
         // We know the left list starts and the right list ends with an actual
         // node visit, if only to the snarl's start or end.
 
-        for(auto leftPath : leftList) {
+        for(auto& leftPathAndSupport : leftList) {
+            auto& leftPath = leftPathAndSupport.first;
 #ifdef debug        
             cerr << "Left path: " << endl;
             for(auto visit : leftPath ) {
@@ -1938,9 +1921,10 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
             }
 
             // Get the minimum support in the left path
-            Support minLeftSupport = min_support_in_path(leftPath);
+            const Support& minLeftSupport = leftPathAndSupport.second;
             
-            for(auto rightPath : rightList) {
+            for(auto& rightPathAndSupport : rightList) {
+                auto& rightPath = rightPathAndSupport.first;
                 // Figure out the relative orientation for the rightmost node.
 #ifdef debug            
                 cerr << "Right path: " << endl;
@@ -1965,7 +1949,7 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
                 bool rightRelativeOrientation = rightOrientation != rightRefPos.second;
 
                 // Get the minimum support in the right path
-                Support minRightSupport = min_support_in_path(rightPath);
+                const Support& minRightSupport = rightPathAndSupport.second;
                 
                 if(leftRelativeOrientation == rightRelativeOrientation &&
                    ((!leftRelativeOrientation && leftRefPos.first < rightRefPos.first) ||
@@ -2068,11 +2052,11 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
 #ifdef debug
     cerr << "Combine forward paths" << endl;
 #endif
-    pair<Support, vector<Visit> > best_forward = testCombinations(left_forward, right_forward);
+    pair<Support, vector<Visit> > best_forward = testCombinations(left_paths.forward, right_paths.forward);
 #ifdef debug
     cerr << "Combine reverse paths" << endl;
 #endif
-    pair<Support, vector<Visit> > best_reverse = testCombinations(left_reverse, right_reverse);
+    pair<Support, vector<Visit> > best_reverse = testCombinations(left_paths.reverse, right_paths.reverse);
     
 #ifdef debug
     cerr << "Best forward path:" << endl;
@@ -2095,6 +2079,50 @@ pair<Support, vector<Visit>> RepresentativeTraversalFinder::find_bubble(id_t nod
     }
 }
 
+const RepresentativeTraversalFinder::SearchFrontier&
+RepresentativeTraversalFinder::search_frontier(const Visit& visit, bool search_right, PathIndex& index,
+                                               const Snarl* in_snarl, SearchMemo* memo, SearchFrontier& scratch) {
+    
+    // Work out where the result should go
+    SearchFrontier* frontier = &scratch;
+    if (memo != nullptr) {
+        auto& memo_side = search_right ? memo->right : memo->left;
+        auto found = memo_side.find(visit);
+        if (found != memo_side.end()) {
+            // We already searched from here for this site.
+            memo->hits++;
+            return found->second;
+        }
+        frontier = &memo_side[visit];
+        memo->searches++;
+    }
+    
+    // Make sure to keep looking for the other orientation of the ref path
+    // after we find a first one, to handle inversions of up to a certain size.
+    auto paths = search_right ? bfs_right(visit, index, false, in_snarl, other_orientation_timeout) :
+                                bfs_left(visit, index, false, in_snarl, other_orientation_timeout);
+    
+    for (auto& annotated_path : paths) {
+        // Break up the paths by orientation
+        auto& ref_reverse = get<1>(annotated_path);
+        auto& path = get<2>(annotated_path);
+        // TODO: ImmutableList iterators don't actually satisfy
+        // https://en.cppreference.com/w/cpp/named_req/Iterator because they
+        // lack the tyypedefs for std::iterator_traits. So we can't use them to
+        // construct lists. So we have to build the lists manually.
+        list<Visit> converted;
+        for (auto& item : path) {
+            converted.push_back(item);
+        }
+        // Work out the support once here, rather than for every combination
+        // the path is tried in.
+        Support min_support = min_support_in_path(converted);
+        (ref_reverse ? frontier->reverse : frontier->forward).emplace_back(move(converted), min_support);
+    }
+    
+    return *frontier;
+}
+
 Support RepresentativeTraversalFinder::min_support_in_path(const list<Visit>& path) {
     
     if (path.empty() || !has_supports) {
@@ -3238,4 +3266,100 @@ pair<step_handle_t, bool> VCFTraversalFinder::step_in_path(handle_t handle, path
 }
 
 
+GBWTTraversalFinder::GBWTTraversalFinder(const HandleGraph& graph, SnarlManager& snarl_manager,
+                                         const gbwt::GBWT& gbwt_index) :
+    graph(graph), snarl_manager(snarl_manager), gbwt_index(gbwt_index) {
+
+}
+
+vector<SnarlTraversal> GBWTTraversalFinder::find_traversals(const Snarl& site) {
+    return find_gbwt_traversals(site).first;
+}
+
+pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> GBWTTraversalFinder::find_gbwt_traversals(const Snarl& site) {
+
+    unordered_set<id_t> contents = snarl_manager.deep_contents(&site, graph, true).first;
+    gbwt::node_type start_node = gbwt::Node::encode(site.start().node_id(), site.start().backward());
+    gbwt::node_type end_node = gbwt::Node::encode(site.end().node_id(), site.end().backward());
+
+    vector<vector<gbwt::node_type>> travs;
+    vector<vector<gbwt::size_type>> paths;
+    search(start_node, end_node, contents, travs, paths);
+    if (!gbwt_index.bidirectional()) {
+        // Only one orientation of each haplotype is indexed, so we need to look for ones
+        // that go through the site backward too.
+        vector<vector<gbwt::node_type>> backward_travs;
+        vector<vector<gbwt::size_type>> backward_paths;
+        search(gbwt::Node::reverse(end_node), gbwt::Node::reverse(start_node), contents, backward_travs, backward_paths);
+        for (size_t i = 0; i < backward_travs.size(); ++i) {
+            vector<gbwt::node_type> trav;
+            trav.reserve(backward_travs[i].size());
+            for (auto it = backward_travs[i].rbegin(); it != backward_travs[i].rend(); ++it) {
+                trav.push_back(gbwt::Node::reverse(*it));
+            }
+            // merge with the forward traversal if we've seen this one already
+            auto found = std::find(travs.begin(), travs.end(), trav);
+            if (found == travs.end()) {
+                travs.push_back(std::move(trav));
+                paths.push_back(std::move(backward_paths[i]));
+            } else {
+                auto& found_paths = paths[found - travs.begin()];
+                found_paths.insert(found_paths.end(), backward_paths[i].begin(), backward_paths[i].end());
+            }
+        }
+    }
+
+    vector<SnarlTraversal> out_travs(travs.size());
+    for (size_t i = 0; i < travs.size(); ++i) {
+        for (auto& node : travs[i]) {
+            Visit* visit = out_travs[i].add_visit();
+            visit->set_node_id(gbwt::Node::id(node));
+            visit->set_backward(gbwt::Node::is_reverse(node));
+        }
+        sort(paths[i].begin(), paths[i].end());
+        paths[i].erase(unique(paths[i].begin(), paths[i].end()), paths[i].end());
+    }
+    return make_pair(out_travs, paths);
+}
+
+void GBWTTraversalFinder::search(gbwt::node_type from, gbwt::node_type to, const unordered_set<id_t>& contents,
+                                 vector<vector<gbwt::node_type>>& out_travs,
+                                 vector<vector<gbwt::size_type>>& out_paths) const {
+
+    // depth-first search over extensions that some haplotype takes. each haplotype is finite,
+    // so this terminates even in cyclic sites.
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState>> stack;
+    gbwt::SearchState start_state = gbwt_index.find(from);
+    if (!start_state.empty()) {
+        stack.emplace_back(vector<gbwt::node_type>(1, from), start_state);
+    }
+
+    while (!stack.empty()) {
+        vector<gbwt::node_type> trav = std::move(stack.back().first);
+        gbwt::SearchState state = stack.back().second;
+        stack.pop_back();
+
+        if (trav.size() > 1 && trav.back() == to) {
+            out_travs.push_back(std::move(trav));
+            out_paths.emplace_back();
+            for (gbwt::size_type sequence : gbwt_index.locate(state)) {
+                out_paths.back().push_back(gbwt_index.bidirectional() ? gbwt::Path::id(sequence) : sequence);
+            }
+            continue;
+        }
+
+        for (auto& edge : gbwt_index.edges(trav.back())) {
+            if (edge.first == gbwt::ENDMARKER || !contents.count(gbwt::Node::id(edge.first))) {
+                // the haplotype ends or leaves the site here
+                continue;
+            }
+            gbwt::SearchState next_state = gbwt_index.extend(state, edge.first);
+            if (!next_state.empty()) {
+                stack.emplace_back(trav, next_state);
+                stack.back().first.push_back(edge.first);
+            }
+        }
+    }
+}
+
 }
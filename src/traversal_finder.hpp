@@ -15,8 +15,10 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <list>
+#include <map>
 
 #include <structures/immutable_list.hpp>
+#include <gbwt/gbwt.h>
 
 #include <vg/vg.pb.h>
 #include "vg.hpp"
@@ -282,6 +284,31 @@ protected:
      */
     Path find_backbone(const Snarl& site);
     
+    /**
+     * The result of a BFS from a visit out to the backbone in one direction:
+     * the paths that reach the backbone in backbone-forward and
+     * backbone-reverse orientation, each with its minimum support.
+     */
+    struct SearchFrontier {
+        list<pair<list<Visit>, Support>> forward;
+        list<pair<list<Visit>, Support>> reverse;
+    };
+    
+    /**
+     * Search frontiers already computed for the site currently being
+     * searched, by starting visit, for searches left and right. Adjacent nodes
+     * and edges in a site start their searches from the same visits, so this
+     * lets each search be done only once per site.
+     */
+    struct SearchMemo {
+        map<Visit, SearchFrontier> left;
+        map<Visit, SearchFrontier> right;
+        /// How many searches were actually run
+        size_t searches = 0;
+        /// How many searches were answered from the memo
+        size_t hits = 0;
+    };
+    
     /**
      * Given an edge or node in the augmented graph, look out from the edge or
      * node or snarl in both directions to find a shortest bubble relative to
@@ -300,7 +327,16 @@ protected:
      * stored in the path).
      */
     pair<Support, vector<Visit>> find_bubble(id_t node, const edge_t* edge, const Snarl* snarl, PathIndex& index,
-                                             const Snarl& site);
+                                             const Snarl& site, SearchMemo* memo = nullptr);
+    
+    /**
+     * Get the partial paths from the given visit to the backbone, searching
+     * left or right, split by backbone-relative orientation and annotated with
+     * their minimum supports. If a memo is given, each search is only done
+     * once per visit and direction, and repeated requests are served from it.
+     */
+    const SearchFrontier& search_frontier(const Visit& visit, bool search_right, PathIndex& index,
+                                          const Snarl* in_snarl, SearchMemo* memo, SearchFrontier& scratch);
         
     /**
      * Get the minimum support of all nodes and edges in path, in the path's forward orientation.
@@ -382,6 +418,10 @@ public:
     /// the reference path after we find one?
     size_t other_orientation_timeout = 10;
     
+    /// Should we report to standard error how long each site took to search,
+    /// and how many of its BFS searches were shared?
+    bool report_site_times = false;
+    
     virtual ~RepresentativeTraversalFinder() = default;
     
     /**
@@ -393,6 +433,43 @@ public:
 };
 
 
+/**
+ * This TraversalFinder returns the distinct traversals of a site taken by the
+ * haplotypes in a GBWT index, without needing the haplotypes to be embedded
+ * as paths in the graph. Haplotypes are followed from the start of the site
+ * with GBWT searches, staying inside the site, until they reach its end.
+ */
+class GBWTTraversalFinder : public TraversalFinder {
+
+protected:
+    const HandleGraph& graph;
+
+    SnarlManager& snarl_manager;
+
+    const gbwt::GBWT& gbwt_index;
+
+    /// Follow haplotypes from one oriented node to another inside the contents
+    void search(gbwt::node_type from, gbwt::node_type to, const unordered_set<id_t>& contents,
+                vector<vector<gbwt::node_type>>& out_travs, vector<vector<gbwt::size_type>>& out_paths) const;
+
+public:
+    GBWTTraversalFinder(const HandleGraph& graph, SnarlManager& snarl_manager, const gbwt::GBWT& gbwt_index);
+
+    virtual ~GBWTTraversalFinder() = default;
+
+    /**
+     * Return every distinct traversal (as a sequence of node visits) through
+     * the site that a haplotype takes from start to end.
+     */
+    virtual vector<SnarlTraversal> find_traversals(const Snarl& site);
+
+    /**
+     * Like above, but also return the GBWT path numbers (sequence numbers, for
+     * indexes that aren't bidirectional) of the haplotypes that take each traversal.
+     */
+    pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> find_gbwt_traversals(const Snarl& site);
+};
+
 /**
  * This TraversalFinder returns a traversals and their corresponding genotypes
  * from an input vcf. It relies on alt-paths in the graph (via construct -a)
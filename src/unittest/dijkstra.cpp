@@ -119,9 +119,103 @@ TEST_CASE("Dijkstra search works on a particular problem graph", "[dijkstra][alg
     REQUIRE(seen.size() == graph.get_node_count());
         
 }
+
+TEST_CASE("DijkstraWorkspace agrees with dijkstra and can be reused", "[dijkstra][algorithms]") {
+    
+    // A dense graph
+    HashGraph graph;
+    handle_t start = graph.create_handle("GAT");
+    handle_t middle = graph.create_handle("TA");
+    handle_t snp1 = graph.create_handle("C");
+    handle_t snp2 = graph.create_handle("TT");
+    handle_t end = graph.create_handle("A");
+    graph.create_edge(start, middle);
+    graph.create_edge(middle, snp1);
+    graph.create_edge(middle, snp2);
+    graph.create_edge(snp1, end);
+    graph.create_edge(snp2, end);
+    
+    // A graph with sparse IDs
+    HashGraph sparse;
+    handle_t s1 = sparse.create_handle("GAT", 1);
+    handle_t s2 = sparse.create_handle("TACA", 1000000);
+    handle_t s3 = sparse.create_handle("C", 5000000);
+    sparse.create_edge(s1, s2);
+    sparse.create_edge(s2, s3);
+    sparse.create_edge(s1, s3);
+    
+    algorithms::DijkstraWorkspace workspace(3);
+    
+    auto run_both = [&](const HandleGraph& g, handle_t from, bool leftward) {
+        unordered_map<handle_t, size_t> expected;
+        algorithms::dijkstra(&g, from, [&](const handle_t& reached, size_t distance) {
+            expected[reached] = distance;
+            return true;
+        }, leftward);
+        
+        unordered_map<handle_t, size_t> seen;
+        size_t last_distance = 0;
+        REQUIRE(workspace.search(&g, {from}, [&](const handle_t& reached, size_t distance) {
+            REQUIRE(distance >= last_distance);
+            last_distance = distance;
+            seen[reached] = distance;
+            return true;
+        }, leftward));
+        
+        REQUIRE(seen == expected);
+    };
+    
+    SECTION("Searches match on dense and sparse graphs, alternating") {
+        for (size_t round = 0; round < 3; round++) {
+            run_both(graph, start, false);
+            run_both(sparse, s1, false);
+            run_both(graph, graph.flip(end), false);
+            run_both(graph, end, true);
+            run_both(sparse, s3, true);
+        }
+    }
+    
+    SECTION("Searches match when the graph changes between them") {
+        run_both(graph, start, false);
+        
+        // Add nodes past the old ID range, and one far enough out to make the
+        // graph sparse, without changing the graph's address.
+        handle_t extra = graph.create_handle("GG");
+        graph.create_edge(end, extra);
+        run_both(graph, start, false);
+        run_both(graph, extra, true);
+        
+        handle_t far = graph.create_handle("CCC", 10000000);
+        graph.create_edge(extra, far);
+        run_both(graph, start, false);
+        run_both(graph, far, true);
+    }
+    
+    SECTION("Distance-capped searches stop at the cap") {
+        unordered_map<handle_t, size_t> seen;
+        REQUIRE(algorithms::bounded_dijkstra(&graph, {start}, 2, [&](const handle_t& reached, size_t distance) {
+            seen[reached] = distance;
+            return true;
+        }));
+        
+        // Both SNP alleles start 2 bases out, but the end is at least 3 out.
+        REQUIRE(seen.size() == 4);
+        REQUIRE(seen.at(start) == 0);
+        REQUIRE(seen.at(middle) == 0);
+        REQUIRE(seen.at(snp1) == 2);
+        REQUIRE(seen.at(snp2) == 2);
+        REQUIRE(!seen.count(end));
+    }
     
+    SECTION("Searches can be aborted") {
+        size_t reached_count = 0;
+        REQUIRE(!workspace.search(&graph, {start}, [&](const handle_t& reached, size_t distance) {
+            reached_count++;
+            return reached != middle;
+        }));
+        REQUIRE(reached_count == 2);
+    }
+}
 
-   
 }
 }
-        
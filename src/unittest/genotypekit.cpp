@@ -304,6 +304,98 @@ TEST_CASE("fixed priors can be assigned to genotypes", "[genotype]") {
   delete calculator;
 }
 
+TEST_CASE("dense genotype likelihoods are computed correctly", "[genotype]") {
+
+  DenseGenotypeLikelihoodCalculator calculator(2);
+
+  // Two reads only on allele 0, one forward and one reverse
+  calculator.add_read({true, false}, {false, false}, -0.5);
+  calculator.add_read({true, false}, {true, false}, -0.25);
+  // One read only on allele 1
+  calculator.add_read({false, true}, {false, false}, -1);
+  // One read on neither
+  calculator.add_read({false, false}, {false, false}, -2);
+  // One ambiguous read
+  calculator.add_read({true, true}, {false, false}, -5);
+
+  REQUIRE(calculator.read_count() == 5);
+
+  SECTION("homozygotes count reads on other alleles as wrong") {
+    // Reads 2 and 3 are wrong, and 2 forward and 1 reverse read support allele 0.
+    REQUIRE(calculator.calculate_log_likelihood(vector<int>{0, 0}) == Approx(-3 + log(0.375)));
+  }
+
+  SECTION("heterozygotes treat ambiguous reads as censored") {
+    // Read 3 is wrong, alleles 0 and 1 each have unambiguous strand support,
+    // and between 1 and 2 of the 4 supporting reads come from allele 1.
+    double expected = -2 + log(0.5) + log(0.5) + log(10.0 / 16);
+    REQUIRE(calculator.calculate_log_likelihood(vector<int>{1, 0}) == Approx(expected));
+    REQUIRE(calculator.calculate_log_likelihood(vector<int>{0, 1}) == Approx(expected));
+  }
+
+  SECTION("haploid genotypes can be scored") {
+    REQUIRE(calculator.calculate_log_likelihood(vector<int>{1}) == Approx(-2.75 + log(0.25)));
+  }
+
+  SECTION("heterozygotes leave out reads that don't know about both alleles") {
+    // This read is only on allele 0, but has no flag for allele 1.
+    calculator.add_read({true}, {false}, -3);
+    // It adds forward support to allele 0, but isn't apportioned.
+    double expected = -2 + log(0.375) + log(0.5) + log(10.0 / 16);
+    REQUIRE(calculator.calculate_log_likelihood(vector<int>{0, 1}) == Approx(expected));
+  }
+}
+
+TEST_CASE("dense genotype likelihoods can be computed through the generic interface", "[genotype]") {
+
+  DenseGenotypeLikelihoodCalculator calculator(0);
+  GenotypeLikelihoodCalculator& generic = calculator;
+
+  // Make a site from node 1 forward to node 3 forward
+  Snarl site;
+  site.mutable_start()->set_node_id(1);
+  site.mutable_end()->set_node_id(3);
+
+  // It has two traversals, which only need to be counted.
+  vector<SnarlTraversal> traversals(2);
+
+  // One read is on the forward strand, and one is backward through the site.
+  Alignment forward_read;
+  forward_read.set_mapping_quality(20);
+  forward_read.mutable_path()->add_mapping()->mutable_position()->set_node_id(1);
+  Alignment reverse_read;
+  reverse_read.set_mapping_quality(10);
+  auto* pos = reverse_read.mutable_path()->add_mapping()->mutable_position();
+  pos->set_node_id(3);
+  pos->set_is_reverse(true);
+  vector<Alignment*> reads {&forward_read, &reverse_read};
+
+  // Both support allele 0.
+  vector<vector<bool>> consistencies {{true, false}, {true, false}};
+
+  Genotype hom_ref;
+  hom_ref.add_allele(0);
+  hom_ref.add_allele(0);
+  Genotype hom_alt;
+  hom_alt.add_allele(1);
+  hom_alt.add_allele(1);
+
+  SECTION("reads are scored from the arguments") {
+    // One read forward and one reverse on allele 0
+    REQUIRE(generic.calculate_log_likelihood(site, traversals, hom_ref, consistencies, {}, reads) ==
+            Approx(log(0.5)));
+    // Both reads are wrong
+    REQUIRE(generic.calculate_log_likelihood(site, traversals, hom_alt, consistencies, {}, reads) ==
+            Approx(phred_to_logprob(20) + phred_to_logprob(10)));
+  }
+
+  SECTION("reads added to the matrix are not used") {
+    calculator.add_read({false, true}, {false, false}, -1);
+    REQUIRE(generic.calculate_log_likelihood(site, traversals, hom_ref, consistencies, {}, reads) ==
+            Approx(log(0.5)));
+  }
+}
+
 TEST_CASE("TrivialTraversalFinder can find traversals", "[genotype]") {
   // Build a toy graph
   const string graph_json = R"(
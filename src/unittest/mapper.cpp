@@ -529,6 +529,92 @@ TEST_CASE( "Mapper can annotate positions correctly on both strands", "[mapper][
     
 }
 
+TEST_CASE( "Mapper finds the same MEMs with the MEM search cache enabled", "[mapping][mapper][mem]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "GATTACACATTAG"},
+            {"id": 2, "sequence": "C"},
+            {"id": 3, "sequence": "T"},
+            {"id": 4, "sequence": "GGCCTTAAGACTAC"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4}
+        ],
+        "path": [
+            {"name": "ref", "mapping": [
+                {"position": {"node_id": 1}, "edit": [{"from_length": 13, "to_length": 13}], "rank": 1},
+                {"position": {"node_id": 2}, "edit": [{"from_length": 1, "to_length": 1}], "rank": 2},
+                {"position": {"node_id": 4}, "edit": [{"from_length": 14, "to_length": 14}], "rank": 3}
+            ]}
+        ]
+    })";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Make it into a VG
+    VG graph;
+    graph.extend(proto_graph);
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    // Build the xg index
+    XG xg_index(proto_graph);
+    
+    Mapper uncached(&xg_index, gcsaidx, lcpidx);
+    Mapper cached(&xg_index, gcsaidx, lcpidx);
+    cached.mem_cache_kmer_length = 6;
+    
+    // reads that share suffixes, with and without mismatches inside the cached suffix
+    vector<string> reads{"ACACATTAGCGGCCTTAAG", "TTACATTAGTGGCCTTAAG", "GATTACACATTAGCGGCC",
+        "ACACATTAGCGGCCTTAAG", "GATTACACATTAGCGGCA", "GGTTACACATTAGCGGCC"};
+    
+    for (bool record_max_lcp : {false, true}) {
+        for (const string& read : reads) {
+            double lcp_1 = 0, lcp_2 = 0, filtered_1 = 0, filtered_2 = 0;
+            vector<MaximalExactMatch> mems_1 = uncached.find_mems_deep(read.begin(), read.end(), lcp_1, filtered_1,
+                                                                        0, 3, 0, false, false, false, record_max_lcp);
+            vector<MaximalExactMatch> mems_2 = cached.find_mems_deep(read.begin(), read.end(), lcp_2, filtered_2,
+                                                                      0, 3, 0, false, false, false, record_max_lcp);
+            
+            REQUIRE(mems_1.size() == mems_2.size());
+            for (size_t i = 0; i < mems_1.size(); i++) {
+                REQUIRE(mems_1[i].begin == mems_2[i].begin);
+                REQUIRE(mems_1[i].end == mems_2[i].end);
+                REQUIRE(mems_1[i].range == mems_2[i].range);
+                REQUIRE(mems_1[i].match_count == mems_2[i].match_count);
+            }
+            if (record_max_lcp) {
+                REQUIRE(lcp_1 == lcp_2);
+            }
+        }
+    }
+    
+    // the repeated suffixes should have been found in the cache
+    REQUIRE(cached.mem_cache_queries == 2 * reads.size());
+    REQUIRE(cached.mem_cache_hits > 0);
+    REQUIRE(uncached.mem_cache_queries == 0);
+    
+    // Clean up the GCSA/LCP index
+    delete gcsaidx;
+    delete lcpidx;
+}
+
 }
 
 }
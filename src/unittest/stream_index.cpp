@@ -410,6 +410,79 @@ TEST_CASE("GAMIndex can work with ProtobufIterator cursors", "[gam][gamindex]")
     
 }
 
+TEST_CASE("GAMIndexSession answers repeated and batched queries", "[gam][gamindex]") {
+    stringstream file;
+    
+    id_t next_id = 1;
+    for (size_t group_number = 0; group_number < 50; group_number++) {
+        // Make groups of one-node alignments to each node, in order.
+        vector<Alignment> group;
+        for (size_t i = 0; i < 100; i++) {
+            group.emplace_back();
+            auto* mapping = group.back().mutable_path()->add_mapping();
+            mapping->mutable_position()->set_node_id(next_id);
+            next_id++;
+        }
+        vg::io::write_buffered(file, group, 0);
+    }
+    
+    GAMIndex::cursor_t cursor(file);
+    GAMIndex index;
+    index.index(cursor);
+    
+    GAMIndexSession session(index, cursor);
+    
+    SECTION("Unsorted, overlapping ranges are coalesced") {
+        vector<pair<id_t, id_t>> ranges {{30, 40}, {1, 10}, {35, 50}, {11, 12}, {100, 100}};
+        GAMIndexSession::coalesce(ranges);
+        REQUIRE(ranges == vector<pair<id_t, id_t>>{{1, 12}, {30, 50}, {100, 100}});
+    }
+    
+    SECTION("Repeated queries agree with the index and are served from the cache") {
+        vector<pair<id_t, id_t>> ranges {{450, 520}, {150, 160}};
+        
+        vector<id_t> expected;
+        index.find(cursor, {{150, 160}, {450, 520}}, [&](const Alignment& found) {
+            expected.push_back(found.path().mapping(0).position().node_id());
+        });
+        REQUIRE(expected.size() == 82);
+        
+        for (size_t round = 0; round < 2; round++) {
+            vector<id_t> seen;
+            session.find(ranges, [&](const Alignment& found) {
+                seen.push_back(found.path().mapping(0).position().node_id());
+            });
+            REQUIRE(seen == expected);
+        }
+        
+        REQUIRE(session.cache_misses() > 0);
+        REQUIRE(session.cache_hits() >= session.cache_misses());
+    }
+    
+    SECTION("Batched queries emit each message once with all its queries") {
+        vector<vector<pair<id_t, id_t>>> queries {{{10, 20}}, {{15, 25}}, {{1000, 1005}, {18, 18}}};
+        
+        size_t emitted = 0;
+        session.find_batch(queries, [&](const vector<size_t>& matched, const Alignment& found) {
+            id_t id = found.path().mapping(0).position().node_id();
+            emitted++;
+            
+            vector<size_t> expected;
+            if (id >= 10 && id <= 20) {
+                expected.push_back(0);
+            }
+            if (id >= 15 && id <= 25) {
+                expected.push_back(1);
+            }
+            if ((id >= 1000 && id <= 1005) || id == 18) {
+                expected.push_back(2);
+            }
+            REQUIRE(matched == expected);
+        });
+        
+        REQUIRE(emitted == 16 + 6);
+    }
+}
 
 }
 }
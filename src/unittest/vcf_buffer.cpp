@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <sstream>
+#include <fstream>
 #include <iostream>
 
 namespace vg {
@@ -136,5 +137,71 @@ ref	18	rs1342	A	G	29	PASS	.	GT
     
 }
 
+TEST_CASE( "VcfBuffer reads the same sites through htslib as through vcflib", "[vcfbuffer][vcf]" ) {
+
+    auto vcf_data = R"(##fileformat=VCFv4.2
+##contig=<ID=ref,length=100>
+##FILTER=<ID=q10,Description="Quality below 10">
+##INFO=<ID=SVTYPE,Number=1,Type=String,Description="Type of structural variant">
+##INFO=<ID=END,Number=1,Type=Integer,Description="End position of the variant">
+##INFO=<ID=AF,Number=A,Type=Float,Description="Allele frequency">
+##INFO=<ID=SOMATIC,Number=0,Type=Flag,Description="Somatic mutation">
+##FORMAT=<ID=GT,Number=1,Type=String,Description="Genotype">
+#CHROM	POS	ID	REF	ALT	QUAL	FILTER	INFO	FORMAT	s1	s2	s3
+ref	5	rs1337	A	G,T	29	PASS	AF=0.5,0.25	GT	0|1	1|2	0|0
+ref	7	.	AC	A	.	q10	SOMATIC	GT	0|1	0|0	1|1
+ref	20	sv1	G	<DEL>	50	.	SVTYPE=DEL;END=30	GT	0|1	0|0	./.
+)";
+
+    string filename = temp_file::create();
+    ofstream vcf_file(filename);
+    vcf_file << vcf_data;
+    vcf_file.close();
+    
+    // Read it with vcflib
+    vcflib::VariantCallFile vcf;
+    vcf.parseSamples = false;
+    vcf.open(filename);
+    VcfBuffer vcflib_buffer(&vcf);
+    
+    // And with htslib
+    VcfBuffer hts_buffer(filename);
+    REQUIRE(hts_buffer.is_open());
+    REQUIRE(!hts_buffer.has_tabix());
+    
+    size_t seen = 0;
+    vcflib_buffer.fill_buffer();
+    hts_buffer.fill_buffer();
+    while (vcflib_buffer.get() != nullptr) {
+        REQUIRE(hts_buffer.get() != nullptr);
+        
+        auto& expected = *vcflib_buffer.get();
+        auto& observed = *hts_buffer.get();
+        
+        REQUIRE(observed.sequenceName == expected.sequenceName);
+        REQUIRE(observed.position == expected.position);
+        REQUIRE(observed.zeroBasedPosition() == expected.zeroBasedPosition());
+        REQUIRE(observed.id == expected.id);
+        REQUIRE(observed.ref == expected.ref);
+        REQUIRE(observed.alt == expected.alt);
+        REQUIRE(observed.alleles == expected.alleles);
+        REQUIRE(observed.filter == expected.filter);
+        REQUIRE(observed.info == expected.info);
+        REQUIRE(observed.infoFlags == expected.infoFlags);
+        REQUIRE(observed.isSymbolicSV() == expected.isSymbolicSV());
+        REQUIRE(observed.samples.empty());
+        
+        seen++;
+        vcflib_buffer.handle_buffer();
+        vcflib_buffer.fill_buffer();
+        hts_buffer.handle_buffer();
+        hts_buffer.fill_buffer();
+    }
+    REQUIRE(hts_buffer.get() == nullptr);
+    REQUIRE(seen == 3);
+    
+    temp_file::remove(filename);
+}
+
 }
 }
@@ -9,11 +9,13 @@
 #include <stdio.h>
 #include <set>
 #include <random>
+#include <omp.h>
 #include "catch.hpp"
 #include "algorithms/extract_connecting_graph.hpp"
 #include "algorithms/extract_containing_graph.hpp"
 #include "algorithms/extract_extending_graph.hpp"
 #include "algorithms/topological_sort.hpp"
+#include "algorithms/id_sort.hpp"
 #include "algorithms/weakly_connected_components.hpp"
 #include "algorithms/is_acyclic.hpp"
 #include "algorithms/split_strands.hpp"
@@ -3240,6 +3242,50 @@ namespace vg {
                   
         }
         
+        TEST_CASE( "Parallel topological and ID sorts match the serial sorts",
+                  "[algorithms][topologicalsort]" ) {
+            
+            int old_thread_count = get_thread_count();
+            omp_set_num_threads(4);
+            
+            default_random_engine generator(8675309);
+            
+            for (size_t trial = 0; trial < 20; trial++) {
+                
+                // Make several components with interleaved IDs. Some are
+                // cyclic, some have reversing edges, and some have no heads.
+                VG vg;
+                size_t component_count = uniform_int_distribution<size_t>(1, 8)(generator);
+                vector<vector<handle_t>> components(component_count);
+                uniform_int_distribution<size_t> pick_component(0, component_count - 1);
+                for (id_t id = 1; id <= 200; id++) {
+                    components[pick_component(generator)].push_back(vg.create_handle("A", id * 3));
+                }
+                
+                bernoulli_distribution flip(0.2);
+                for (auto& component : components) {
+                    if (component.size() < 2) {
+                        continue;
+                    }
+                    uniform_int_distribution<size_t> pick_node(0, component.size() - 1);
+                    // Chain the component together, then add random extra edges
+                    for (size_t i = 1; i < component.size(); i++) {
+                        vg.create_edge(flip(generator) ? vg.flip(component[i - 1]) : component[i - 1], component[i]);
+                    }
+                    for (size_t i = 0; i < component.size() / 2; i++) {
+                        handle_t from = component[pick_node(generator)];
+                        handle_t to = component[pick_node(generator)];
+                        vg.create_edge(flip(generator) ? vg.flip(from) : from, flip(generator) ? vg.flip(to) : to);
+                    }
+                }
+                
+                REQUIRE(algorithms::parallel_topological_order(&vg) == algorithms::topological_order(&vg));
+                REQUIRE(algorithms::parallel_id_order(&vg) == algorithms::id_order(&vg));
+            }
+            
+            omp_set_num_threads(old_thread_count);
+        }
+        
         TEST_CASE( "Weakly connected components works",
                   "[algorithms]" ) {
             
@@ -3298,6 +3344,87 @@ namespace vg {
             
             }
         }
+        
+        TEST_CASE( "Weakly connected component labels are flat and ordered by smallest ID",
+                  "[algorithms]" ) {
+            
+            VG vg;
+            
+            // Three components with interleaved, sparse IDs
+            Node* a1 = vg.create_node("A", 10);
+            Node* b1 = vg.create_node("C", 20);
+            Node* a2 = vg.create_node("G", 30);
+            Node* c1 = vg.create_node("T", 40);
+            Node* b2 = vg.create_node("A", 5000);
+            Node* a3 = vg.create_node("C", 70000);
+            
+            vg.create_edge(a3, a1, false, true);
+            vg.create_edge(a2, a3);
+            vg.create_edge(b2, b1, true, false);
+            
+            auto labeling = algorithms::weakly_connected_component_labels(&vg);
+            
+            REQUIRE(labeling.component_count == 3);
+            REQUIRE(labeling.ranked_ids == vector<id_t>{10, 20, 30, 40, 5000, 70000});
+            REQUIRE(labeling.labels == vector<size_t>{0, 1, 0, 2, 1, 0});
+            REQUIRE(labeling.component_of(70000) == 0);
+            REQUIRE(labeling.component_of(5000) == 1);
+            REQUIRE(labeling.component_of(40) == 2);
+            
+            auto components = algorithms::weakly_connected_components(&vg);
+            REQUIRE(components.size() == 3);
+            REQUIRE(components[0] == unordered_set<id_t>{10, 30, 70000});
+            REQUIRE(components[1] == unordered_set<id_t>{20, 5000});
+            REQUIRE(components[2] == unordered_set<id_t>{40});
+            
+            auto with_tips = algorithms::weakly_connected_components_with_tips(&vg);
+            REQUIRE(with_tips.size() == 3);
+            // The lone node is a tip on both sides
+            REQUIRE(with_tips[2].second.size() == 2);
+        }
+        
+        TEST_CASE( "Weakly connected components come out in the order the graph presents them",
+                  "[algorithms]" ) {
+            
+            VG vg;
+            
+            // Make the components in the opposite order from their IDs
+            Node* c1 = vg.create_node("A", 300);
+            Node* b1 = vg.create_node("C", 200);
+            Node* a1 = vg.create_node("G", 100);
+            Node* c2 = vg.create_node("T", 1);
+            Node* a2 = vg.create_node("A", 150);
+            
+            vg.create_edge(c2, c1);
+            vg.create_edge(a1, a2);
+            
+            vector<id_t> first_ids;
+            vg.for_each_handle([&](const handle_t& handle) {
+                first_ids.push_back(vg.get_id(handle));
+            });
+            
+            auto components = algorithms::weakly_connected_components(&vg);
+            auto with_tips = algorithms::weakly_connected_components_with_tips(&vg);
+            REQUIRE(components.size() == 3);
+            REQUIRE(with_tips.size() == 3);
+            
+            // Each component should come no earlier than the first one the
+            // graph shows us a node from.
+            size_t next_component = 0;
+            for (auto& id : first_ids) {
+                if (next_component < components.size() && components[next_component].count(id)) {
+                    REQUIRE(with_tips[next_component].first == components[next_component]);
+                    next_component++;
+                } else {
+                    bool seen = false;
+                    for (size_t i = 0; i < next_component; i++) {
+                        seen = seen || components[i].count(id);
+                    }
+                    REQUIRE(seen);
+                }
+            }
+            REQUIRE(next_component == 3);
+        }
         TEST_CASE("distance_to_head() using HandleGraph produces expected results", "[vg]") {
             VG vg;
             Node* n0 = vg.create_node("AA");
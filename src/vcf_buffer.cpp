@@ -6,6 +6,9 @@
 
 #include "vcf_buffer.hpp"
 
+#include <sys/stat.h>
+#include <cstring>
+
 namespace vg {
 
 using namespace std;
@@ -27,7 +30,17 @@ void VcfBuffer::handle_buffer() {
 }
 
 void VcfBuffer::fill_buffer() {
-    if(file != nullptr && file->is_open() && !has_buffer && safe_to_get) {
+    if (hts_file != nullptr) {
+        // We read through htslib ourselves
+        if (!has_buffer && safe_to_get) {
+            has_buffer = safe_to_get = read_hts_record();
+#ifdef debug
+            if (has_buffer) {
+                cerr << "Variant in buffer: " << buffer << endl;
+            }
+#endif
+        }
+    } else if(file != nullptr && file->is_open() && !has_buffer && safe_to_get) {
         // Put a new variant in the buffer if we have a file and the buffer was empty.
         has_buffer = safe_to_get = file->getNextVariant(buffer);
 #ifdef debug
@@ -36,8 +49,152 @@ void VcfBuffer::fill_buffer() {
     }
 }
 
+bool VcfBuffer::read_hts_record() {
+    int status;
+    if (hts_get_format(hts_file)->format != bcf) {
+        // Text VCF. Read the line ourselves, so we can keep the INFO text as
+        // it was written before htslib parses the line in place.
+        if (hts_iterator != nullptr) {
+            // We are reading a region through tabix
+            status = tbx_itr_next(hts_file, hts_tabix, hts_iterator, &hts_line);
+        } else {
+            status = hts_getline(hts_file, KS_SEP_LINE, &hts_line);
+        }
+        if (status >= 0) {
+            hts_info.clear();
+            const char* column = hts_line.s;
+            for (size_t i = 0; i < 7 && column != nullptr; i++) {
+                // Skip ahead to the INFO column
+                column = strchr(column, '\t');
+                if (column != nullptr) {
+                    column++;
+                }
+            }
+            if (column != nullptr) {
+                const char* column_end = strchr(column, '\t');
+                hts_info.assign(column, column_end == nullptr ? strlen(column) : column_end - column);
+            }
+            status = vcf_parse(&hts_line, hts_header, hts_record);
+        }
+    } else if (hts_iterator != nullptr) {
+        // We are reading a region of a BCF
+        status = bcf_itr_next(hts_file, hts_iterator, hts_record);
+    } else {
+        status = bcf_read(hts_file, hts_header, hts_record);
+    }
+    
+    if (status < 0) {
+        if (status < -1) {
+#pragma omp critical (cerr)
+            cerr << "warning:[vg::VcfBuffer] error reading VCF record; stopping" << endl;
+        }
+        return false;
+    }
+    
+    // Unpack only the shared (site-level) part of the record. Samples were
+    // dropped from the header, so there is nothing else to unpack anyway.
+    bcf_unpack(hts_record, BCF_UN_SHR);
+    
+    buffer.sequenceName = bcf_hdr_id2name(hts_header, hts_record->rid);
+    // vcflib positions are 1-based
+    buffer.position = hts_record->pos + 1;
+    buffer.id = hts_record->d.id;
+    buffer.ref = hts_record->d.allele[0];
+    
+    buffer.alt.clear();
+    for (size_t i = 1; i < hts_record->n_allele; i++) {
+        buffer.alt.emplace_back(hts_record->d.allele[i]);
+    }
+    if (buffer.alt.empty()) {
+        // vcflib would see a "." alt as an allele; match it.
+        buffer.alt.emplace_back(".");
+    }
+    buffer.alleles.clear();
+    buffer.alleles.push_back(buffer.ref);
+    buffer.alleles.insert(buffer.alleles.end(), buffer.alt.begin(), buffer.alt.end());
+    buffer.updateAlleleIndexes();
+    
+    buffer.quality = bcf_float_is_missing(hts_record->qual) ? 0 : hts_record->qual;
+    
+    if (hts_record->d.n_flt == 0) {
+        buffer.filter = ".";
+    } else {
+        buffer.filter.clear();
+        for (int i = 0; i < hts_record->d.n_flt; i++) {
+            if (i != 0) {
+                buffer.filter.push_back(';');
+            }
+            buffer.filter += bcf_hdr_int2id(hts_header, BCF_DT_ID, hts_record->d.flt[i]);
+        }
+    }
+    
+    buffer.info.clear();
+    buffer.infoFlags.clear();
+    if (hts_get_format(hts_file)->format != bcf) {
+        // Split the original INFO text the way vcflib does, so values come
+        // through exactly as they were written.
+        size_t field_start = 0;
+        while (field_start < hts_info.size()) {
+            size_t field_end = hts_info.find(';', field_start);
+            if (field_end == string::npos) {
+                field_end = hts_info.size();
+            }
+            size_t equals = hts_info.find('=', field_start);
+            if (equals >= field_end) {
+                string key = hts_info.substr(field_start, field_end - field_start);
+                if (!key.empty() && key != ".") {
+                    buffer.infoFlags[key] = true;
+                }
+            } else {
+                auto& values = buffer.info[hts_info.substr(field_start, equals - field_start)];
+                size_t value_start = equals + 1;
+                for (size_t j = value_start; j <= field_end; j++) {
+                    if (j == field_end || hts_info[j] == ',') {
+                        values.emplace_back(hts_info, value_start, j - value_start);
+                        value_start = j + 1;
+                    }
+                }
+            }
+            field_start = field_end + 1;
+        }
+        return true;
+    }
+    
+    // A BCF has no original text, so format the typed values.
+    for (size_t i = 0; i < hts_record->n_info; i++) {
+        bcf_info_t& field = hts_record->d.info[i];
+        if (field.vptr == nullptr) {
+            // This field was deleted
+            continue;
+        }
+        string key = bcf_hdr_int2id(hts_header, BCF_DT_ID, field.key);
+        if (bcf_hdr_id2type(hts_header, BCF_HL_INFO, field.key) == BCF_HT_FLAG) {
+            buffer.infoFlags[key] = true;
+            continue;
+        }
+        
+        // Format the value as text and split it on commas the way vcflib does.
+        hts_value.l = 0;
+        bcf_fmt_array(&hts_value, field.len, field.type, field.vptr);
+        auto& values = buffer.info[key];
+        size_t value_start = 0;
+        for (size_t j = 0; j <= hts_value.l; j++) {
+            if (j == hts_value.l || hts_value.s[j] == ',') {
+                values.emplace_back(hts_value.s + value_start, j - value_start);
+                value_start = j + 1;
+            }
+        }
+    }
+    
+    return true;
+}
+
 bool VcfBuffer::has_tabix() const {
-    return file && file->usingTabix;
+    return (file && file->usingTabix) || hts_tabix != nullptr || hts_index != nullptr;
+}
+
+bool VcfBuffer::is_open() const {
+    return hts_file != nullptr || (file != nullptr && file->is_open());
 }
 
 bool VcfBuffer::set_region(const string& contig, int64_t start, int64_t end) {
@@ -52,6 +209,25 @@ bool VcfBuffer::set_region(const string& contig, int64_t start, int64_t end) {
     // Remember that we can get the next variant now, in case we had hit the end
     // of the VCF.
     safe_to_get = true;
+    
+    if (hts_file != nullptr) {
+        // Build the same region string vcflib would hand to htslib.
+        string region = contig;
+        if (start != -1 && end != -1) {
+            region += ":" + to_string(start) + "-" + to_string(end);
+        }
+        
+        if (hts_iterator != nullptr) {
+            hts_itr_destroy(hts_iterator);
+        }
+        if (hts_tabix != nullptr) {
+            hts_iterator = tbx_itr_querys(hts_tabix, region.c_str());
+        } else {
+            hts_iterator = bcf_itr_querys(hts_index, hts_header, region.c_str());
+        }
+        safe_to_get = (hts_iterator != nullptr);
+        return safe_to_get;
+    }
 
     if(start != -1 && end != -1) {
         // We have a start and end
@@ -72,6 +248,71 @@ VcfBuffer::VcfBuffer(vcflib::VariantCallFile* file) : file(file) {
     }
 }
 
+VcfBuffer::VcfBuffer(const string& filename) : file(nullptr) {
+    hts_file = hts_open(filename.c_str(), "r");
+    if (hts_file == nullptr) {
+        // is_open() will report the failure
+        return;
+    }
+    hts_header = bcf_hdr_read(hts_file);
+    if (hts_header == nullptr) {
+        hts_close(hts_file);
+        hts_file = nullptr;
+        return;
+    }
+    
+    // Don't parse any of the sample columns. This is where most of the time
+    // goes for VCFs with many samples.
+    bcf_hdr_set_samples(hts_header, nullptr, 0);
+    hts_record = bcf_init();
+    
+    // Load an index if there is one. Check for it first so htslib doesn't
+    // complain about it being missing.
+    struct stat temp;
+    if (hts_get_format(hts_file)->format == bcf) {
+        if (stat((filename + ".csi").c_str(), &temp) == 0) {
+            hts_index = bcf_index_load(filename.c_str());
+        }
+    } else if (stat((filename + ".tbi").c_str(), &temp) == 0 ||
+               stat((filename + ".csi").c_str(), &temp) == 0) {
+        hts_tabix = tbx_index_load(filename.c_str());
+    }
+    
+    // The buffered variant still wants a vcflib file to consult for header
+    // information, so give it one made from just the header text.
+    kstring_t header_text = {0, 0, nullptr};
+    bcf_hdr_format(hts_header, 0, &header_text);
+    string header_string(header_text.s, header_text.l);
+    free(header_text.s);
+    hts_vcflib_header.reset(new vcflib::VariantCallFile());
+    hts_vcflib_header->parseSamples = false;
+    hts_vcflib_header->openForOutput(header_string);
+    buffer.setVariantCallFile(hts_vcflib_header.get());
+}
+
+VcfBuffer::~VcfBuffer() {
+    if (hts_iterator != nullptr) {
+        hts_itr_destroy(hts_iterator);
+    }
+    if (hts_tabix != nullptr) {
+        tbx_destroy(hts_tabix);
+    }
+    if (hts_index != nullptr) {
+        hts_idx_destroy(hts_index);
+    }
+    if (hts_record != nullptr) {
+        bcf_destroy(hts_record);
+    }
+    if (hts_header != nullptr) {
+        bcf_hdr_destroy(hts_header);
+    }
+    if (hts_file != nullptr) {
+        hts_close(hts_file);
+    }
+    free(hts_line.s);
+    free(hts_value.s);
+}
+
 
 WindowedVcfBuffer::WindowedVcfBuffer(vcflib::VariantCallFile* file, size_t window_size): reader(file), window_size(window_size) {
     // Nothing to do!
@@ -12,6 +12,12 @@
 // We need vcflib
 #include "Variant.h"
 
+// And htslib for the lightweight reading path
+#include "htslib/hts.h"
+#include "htslib/kstring.h"
+#include "htslib/tbx.h"
+#include "htslib/vcf.h"
+
 
 namespace vg {
 
@@ -22,6 +28,10 @@ using namespace std;
  * construction functions peek and see if they want the next variant, or lets
  * them ignore it for the next construction function for a different contig to
  * handle. Ought not to be copied.
+ *
+ * Can alternatively read a VCF or BCF file directly with htslib, in which case
+ * only the site-level columns are parsed, and genotype columns are skipped
+ * entirely. Variants produced that way carry no sample data.
  */
 class VcfBuffer {
 
@@ -72,14 +82,36 @@ public:
      */
     bool set_region(const string& contig, int64_t start = -1, int64_t end = -1);
     
+    /**
+     * Returns true if there is an open file to read variants from.
+     */
+    bool is_open() const;
+    
     /**
      * Make a new VcfBuffer buffering the file at the given pointer (which must
      * outlive the buffer, but which may be null).
      */
     VcfBuffer(vcflib::VariantCallFile* file = nullptr);
     
+    /**
+     * Make a new VcfBuffer that reads the VCF or BCF file at the given path
+     * itself, through htslib, without parsing any sample columns. Uses a
+     * tabix or CSI index if one is present next to the file. Use is_open() to
+     * see if the file could be opened.
+     */
+    VcfBuffer(const string& filename);
+    
+    ~VcfBuffer();
+    
 protected:
     
+    /**
+     * Read the next record from the htslib file into the buffer, converting
+     * the site-level fields into the buffered vcflib::Variant. Returns false
+     * at the end of the file or region, or on a read error.
+     */
+    bool read_hts_record();
+    
     // This stores whether the buffer is populated with a valid variant or not
     bool has_buffer = false;
     // This stores whether the last getNextVariant call succeeded. If it didn't
@@ -92,6 +124,22 @@ protected:
     // We can wrap the null file (and never have any variants) with a null here.
     vcflib::VariantCallFile* const file;
     
+    // When reading through htslib instead, these hold the open file, its
+    // header, the record we decode into, any index, and the current region
+    // iterator.
+    htsFile* hts_file = nullptr;
+    bcf_hdr_t* hts_header = nullptr;
+    bcf1_t* hts_record = nullptr;
+    tbx_t* hts_tabix = nullptr;
+    hts_idx_t* hts_index = nullptr;
+    hts_itr_t* hts_iterator = nullptr;
+    // Scratch space for text lines and formatted BCF INFO values
+    kstring_t hts_line = {0, 0, nullptr};
+    kstring_t hts_value = {0, 0, nullptr};
+    // The INFO column of a text record, as written
+    string hts_info;
+    // Header-only vcflib file for the buffered variant to refer to
+    unique_ptr<vcflib::VariantCallFile> hts_vcflib_header;
     
 
 private:
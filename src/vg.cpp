@@ -3310,7 +3310,7 @@ void VG::sort() {
         return;
     }
     
-    apply_ordering(algorithms::topological_order(this));
+    apply_ordering(algorithms::parallel_topological_order(this));
 }
     
 void VG::id_sort() {
@@ -3319,7 +3319,7 @@ void VG::id_sort() {
         return;
     }
     
-    apply_ordering(algorithms::id_order(this));
+    apply_ordering(algorithms::parallel_id_order(this));
 }
         
 void VG::apply_ordering(const vector<handle_t>& ordering, bool compact_ids) {
@@ -5245,7 +5245,8 @@ void VG::edit(vector<Path>& paths_to_add,
 void VG::edit(istream& paths_to_add,
               vector<Translation>* out_translations,
               bool save_paths, ostream* out_gam_stream,
-              bool break_at_ends, bool remove_softclips) {
+              bool break_at_ends, bool remove_softclips,
+              const Packer* packer, size_t min_edit_support) {
 
     // If we are going to actually add the paths to the graph, we need to break at path ends
     break_at_ends |= save_paths;
@@ -5262,7 +5263,7 @@ void VG::edit(istream& paths_to_add,
     
     // Augment the graph with the paths, modifying paths in place if update true
     augment(this, paths_to_add, out_translations, out_gam_stream, save_fn,
-            break_at_ends, remove_softclips);
+            break_at_ends, remove_softclips, packer, min_edit_support);
         
     // Rebuild path ranks, aux mapping, etc. by compacting the path ranks
     // Todo: can we just do this once?
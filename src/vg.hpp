@@ -67,6 +67,7 @@ struct KmerPosition {
 
 class Aligner; // forward declarations
 class QualAdjAligner;
+class Packer;
 
 }
 
@@ -669,12 +670,17 @@ public:
     /// updtate the in-memory list, an optional output stream is used
     ///
     /// todo: duplicate less code between the two versions. 
+    ///
+    /// If packer is given, only edits it has seen at least min_edit_support
+    /// times are added to the graph.
     void edit(istream& paths_to_add,
               vector<Translation>* out_translations = nullptr,
               bool save_paths = false,
               ostream* out_path_stream = nullptr,
               bool break_at_ends = false,
-              bool remove_softclips = false);
+              bool remove_softclips = false,
+              const Packer* packer = nullptr,
+              size_t min_edit_support = 0);
     
     /// %Edit the graph to include all the sequences and edges added by the
     /// given path. Returns a vector of Translations, one per original-node
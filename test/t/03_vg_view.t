@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 20
+plan tests 22
 
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -d - | wc -l) 505 "view produces the expected number of lines of dot output"
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -g - | wc -l) 503 "view produces the expected number of lines of GFA output"
@@ -60,3 +60,11 @@ rm -f errors.txt
 vg view -Fv overlaps/corrected_overlap.gfa >/dev/null
 is "$?" "0" "GFA import accepts that file when the offending overlap length is fixed"
 
+
+vg construct -r small/x.fa -v small/x.vcf.gz > x.vg
+vg index -x x.xg x.vg
+vg sim -x x.xg -n 5000 -l 50 -a -s 1 > x.gam
+is "$(vg view -a --threads 4 x.gam | md5sum)" "$(vg view -a x.gam | md5sum)" "multithreaded GAM to JSON conversion preserves order"
+is "$(vg view -a x.gam | vg view -JGa --threads 4 - | vg view -a - | md5sum)" "$(vg view -a x.gam | md5sum)" "multithreaded JSON to GAM conversion preserves order"
+
+rm -f x.vg x.xg x.gam
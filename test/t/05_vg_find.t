@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 25
+plan tests 27
 
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz >x.vg
 is $? 0 "construction"
@@ -68,6 +68,10 @@ is $(vg find -A <(vg find -N <(seq 37 52 ) -x x.xg ) -d x.db | vg view -a - | wc
 vg gamsort -i x.sorted.gam.gai x.gam > x.sorted.gam
 is $(vg find -o 127 --sorted-gam x.sorted.gam | vg view -a - | wc -l) 6 "the GAM index can return the set of alignments mapping to a node"
 is $(vg find -A <(vg find -N <(seq 37 52 ) -x x.xg ) --sorted-gam x.sorted.gam | vg view -a - | wc -l) 15 "a subgraph query may be used to obtain a particular subset of alignments from a sorted GAM"
+printf "37:45\n40:52\n" > batch.txt
+is $(vg find -b batch.txt --sorted-gam x.sorted.gam | vg view -a - | wc -l) 15 "a batch of overlapping queries returns each alignment from a sorted GAM once"
+is $(echo 127 | vg find -b - --sorted-gam x.sorted.gam | vg view -a - | wc -l) 6 "a query batch can be read from standard input"
+rm -f batch.txt
 
 rm -rf x.db x.gam x.sorted.gam x.sorted.gam.gai
 
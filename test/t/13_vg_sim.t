@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 14
+plan tests 17
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -50,4 +50,13 @@ vg view -Fv graphs/cactus-BRCA2.gfa >cactus-BRCA2.vg
 vg index -x cactus-BRCA2.xg cactus-BRCA2.vg
 is $(vg sim -x cactus-BRCA2.xg -n 100 -l 150 -p 1000 -v 100 -e 0.01 -i 0.005 -F minigiab/NA12878.chr22.tiny.fq.gz | wc -l) 100 "ngs trained simulator works"
 is $(vg sim -x cactus-BRCA2.xg -n 100 -l 150 -p 1000 -v 100 -e 0.01 -i 0.005 -a -F minigiab/NA12878.chr22.tiny.fq.gz | vg view -a - | wc -l) 200 "ngs trained simulator generates gam"
+
+vg sim -x cactus-BRCA2.xg -n 2500 -l 100 -e 0.01 -i 0.005 -s 1 -t 1 -aJ > threads1.json
+vg sim -x cactus-BRCA2.xg -n 2500 -l 100 -e 0.01 -i 0.005 -s 1 -t 4 -aJ > threads4.json
+is $(wc -l < threads4.json) 2500 "threaded simulation creates the correct number of reads"
+is "$(md5sum < threads1.json)" "$(md5sum < threads4.json)" "threaded simulation output does not depend on the thread count"
+vg sim -x cactus-BRCA2.xg -n 2500 -l 150 -p 1000 -v 100 -s 1 -t 1 -F minigiab/NA12878.chr22.tiny.fq.gz > threads1.txt
+vg sim -x cactus-BRCA2.xg -n 2500 -l 150 -p 1000 -v 100 -s 1 -t 4 -F minigiab/NA12878.chr22.tiny.fq.gz > threads4.txt
+is "$(md5sum < threads1.txt)" "$(md5sum < threads4.txt)" "threaded trained simulation output does not depend on the thread count"
+rm -f threads1.json threads4.json threads1.txt threads4.txt
 rm -f cactus-BRCA2.xg cactus-BRCA2.vg
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 13
+plan tests 17
 
 vg view -J -v pileup/tiny.json > tiny.vg
 
@@ -69,7 +69,16 @@ vg index -x x.xg -g x.gcsa -k 16 x.vg
 vg map -x x.xg -g x.gcsa -G small/x-s1337-n100-e0.01-i0.005.gam -t 1 >x.gam
 vg augment -Z x.trans -i x.vg x.gam >x.mod.vg
 is $(vg view -Z x.trans | wc -l) 1288 "the expected graph translation is exported when the graph is edited"
-rm -rf x.vg x.xg x.gcsa x.reads x.gam x.mod.vg x.trans
+vg augment -t 1 -i x.vg x.gam -A x.1.gam >x.1.vg
+vg augment -t 4 -i x.vg x.gam -A x.4.gam >x.4.vg
+is "$(cat x.1.vg x.1.gam | md5sum)" "$(cat x.4.vg x.4.gam | md5sum)" "augmenting with multiple threads produces the same graph and reads"
+vg pack -x x.xg -g x.gam -e -o x.pack
+vg augment x.vg x.gam >x.all.vg
+is "$(vg augment -k x.pack -x x.xg -g 1 x.vg x.gam | md5sum)" "$(md5sum <x.all.vg)" "augmenting with edits seen at least once in a pack adds every edit"
+is "$(vg augment -k x.pack -x x.xg -g 1000 x.vg x.gam | vg stats -N -)" "$(vg stats -N x.vg)" "augmenting with only well-supported edits from a pack leaves the graph alone when nothing is well supported"
+vg augment -k x.pack -x x.xg -g 2 x.vg x.gam -A x.k.gam >/dev/null 2>&1
+isnt "$?" 0 "augmenting with pack filtering refuses to write GAM output whose sequences no longer match its paths"
+rm -rf x.vg x.xg x.gcsa x.reads x.gam x.mod.vg x.trans x.1.vg x.1.gam x.4.vg x.4.gam x.pack x.all.vg x.k.gam
 
 vg construct -m 1000 -r tiny/tiny.fa >flat.vg
 vg view flat.vg| sed 's/CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG/CAAATAAGGCTTGGAAATTTTCTGGAGATCTATTATACTCCAACTCTCTG/' | vg view -Fv - >2snp.vg
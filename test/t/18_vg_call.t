@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 6
+plan tests 13
 
 # Toy example of hand-made pileup (and hand inspected truth) to make sure some
 # obvious (and only obvious) SNPs are detected by vg call
@@ -80,6 +80,33 @@ DIFF_COUNT=$(diff -U 0 baseline_gts.txt gts.txt | grep ^@ | wc -l)
 LESS_SIX=$(if (( $DIFF_COUNT < 8 )); then echo 1; else echo 0; fi)
 is "${LESS_SIX}" "1" "Fewer than 6 differences between called and true SV genotypes" 
 
-rm -f  HGSVC_alts.vg HGSVC_aug.vg HGSVC.vcf HGSVC_aug.support  HGSVC_aug.trans baseline_gts.txt gts.txt
-
-
+grep -v '#' HGSVC.vcf | cut -f 2 > HGSVC_positions.txt
+is "$(sort -n HGSVC_positions.txt | md5sum)" "$(md5sum < HGSVC_positions.txt)" "called vcf is sorted by position"
+vg call HGSVC_aug.vg -f call/HGSVC_chr22_17200000_17800000.vcf.gz -n 0 -u -s HGSVC_aug.support -z HGSVC_aug.trans -r chr22 -S HG00514 -t 1 > HGSVC_t1.vcf
+is "$(md5sum < HGSVC_t1.vcf)" "$(md5sum < HGSVC.vcf)" "called vcf does not depend on the thread count"
+
+vg call HGSVC_aug.vg -f call/HGSVC_chr22_17200000_17800000.vcf.gz -n 0 -u -s HGSVC_aug.support -z HGSVC_aug.trans -r chr22 -S HG00514 --checkpoint-dir HGSVC_checkpoints --region-size 100000 --shards 2 --shard 0 > /dev/null 2>&1
+vg call HGSVC_aug.vg -f call/HGSVC_chr22_17200000_17800000.vcf.gz -n 0 -u -s HGSVC_aug.support -z HGSVC_aug.trans -r chr22 -S HG00514 --checkpoint-dir HGSVC_checkpoints --region-size 100000 --shards 2 --shard 1 > HGSVC_checkpointed.vcf
+is "$(md5sum < HGSVC_checkpointed.vcf)" "$(md5sum < HGSVC.vcf)" "calls made by region in separate shards match calls made in one run"
+rm -f HGSVC_checkpoints/region_1.vcf
+vg call HGSVC_aug.vg -f call/HGSVC_chr22_17200000_17800000.vcf.gz -n 0 -u -s HGSVC_aug.support -z HGSVC_aug.trans -r chr22 -S HG00514 --checkpoint-dir HGSVC_checkpoints --region-size 100000 > HGSVC_checkpointed.vcf
+is "$(md5sum < HGSVC_checkpointed.vcf)" "$(md5sum < HGSVC.vcf)" "a checkpointed call run can be resumed"
+vg call HGSVC_aug.vg -f call/HGSVC_chr22_17200000_17800000.vcf.gz -n 1 -u -s HGSVC_aug.support -z HGSVC_aug.trans -r chr22 -S HG00514 --checkpoint-dir HGSVC_checkpoints --region-size 100000 > /dev/null 2>&1
+is "$?" "1" "a checkpointed call run cannot be resumed with different options"
+
+rm -rf HGSVC_checkpoints HGSVC_checkpointed.vcf
+rm -f  HGSVC_alts.vg HGSVC_aug.vg HGSVC.vcf HGSVC_t1.vcf HGSVC_positions.txt HGSVC_aug.support  HGSVC_aug.trans baseline_gts.txt gts.txt
+
+## Calling from a pack
+vg construct -r small/x.fa -v small/x.vcf.gz > x.vg
+vg index -x x.xg -g x.gcsa x.vg
+vg sim -x x.xg -n 2000 -l 100 -e 0.01 -i 0.005 -s 1 -a > x.sim
+vg map -x x.xg -g x.gcsa -G x.sim -t 1 > x.gam
+vg pack -x x.xg -g x.gam -o x.pack
+vg snarls x.vg > x.snarls
+vg call -P x.pack -x x.xg -g x.snarls x.vg > x.graph.vcf
+vg call -P x.pack -x x.xg -g x.snarls > x.xg.vcf
+is "$(grep -v '^#' x.xg.vcf | wc -l | awk '{print ($1 > 0)}')" "1" "calling from a pack on the xg index makes calls"
+is "$(md5sum < x.xg.vcf)" "$(md5sum < x.graph.vcf)" "calling from a pack on the xg index matches calling on the loaded graph"
+
+rm -f x.vg x.xg x.gcsa x.gcsa.lcp x.sim x.gam x.pack x.snarls x.graph.vcf x.xg.vcf
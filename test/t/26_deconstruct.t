@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 18
+plan tests 22
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz > tiny.vg
 vg index tiny.vg -x tiny.xg
@@ -18,6 +18,14 @@ is "$?" 0 "deconstruct retrieved original VCF (modulo adjacent snp allele)"
 
 rm -f tiny.vg tiny.xg tiny_decon.vcf tiny_orig.tsv tiny_dec.tsv
 
+vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz -a > tiny.vg
+vg index tiny.vg -x tiny.xg -G tiny.gbwt -v tiny/tiny.vcf.gz
+vg deconstruct tiny.xg -p x -g tiny.gbwt > tiny_decon.vcf
+is "$(grep -v "#" tiny_decon.vcf | awk '$2 == 34 {print $10}')" "1|1" "deconstruct genotypes a homozygous gbwt haplotype site"
+is "$(grep -v "#" tiny_decon.vcf | awk '$2 == 39 {print $10}')" "1|0" "deconstruct genotypes a heterozygous gbwt haplotype site"
+
+rm -f tiny.vg tiny.xg tiny.gbwt tiny_decon.vcf
+
 vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 1 -k 16 | vg mod -U 10 - | vg mod -c - > hla.vg
 vg index hla.vg -x hla.xg
 
@@ -43,6 +51,12 @@ is $(grep -v "#" hla_decon_path.vcf | awk -v x="$SAMPLE_COL" '{print $x}' | uniq
 
 is $(grep "#" hla_decon_path.vcf | grep "568815592") "##contig=<ID=gi|568815592:29791752-29792749,length=998>" "reference contig correctly written"
 
+grep -v "#" hla_decon_path.vcf | cut -f 2 > hla_decon_positions.txt
+is "$(sort -n hla_decon_positions.txt | md5sum)" "$(md5sum < hla_decon_positions.txt)" "deconstructed vcf is sorted by position"
+vg deconstruct hla.xg -p "gi|568815592:29791752-29792749" -e -t 1 > hla_decon_path_t1.vcf
+is "$(md5sum < hla_decon_path_t1.vcf)" "$(md5sum < hla_decon_path.vcf)" "deconstructed vcf does not depend on the thread count"
+rm -f hla_decon_positions.txt hla_decon_path_t1.vcf
+
 
 rm -f hla_decon.vcf hla_decon_path.vcf  hla_decon.tsv hla_decon_path.tsv hla.vg hla.xg
 
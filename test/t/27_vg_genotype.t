@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 5
+plan tests 8
 
 vg construct -v tiny/tiny.vcf.gz -r tiny/tiny.fa > tiny.vg
 vg index -x tiny.vg.xg -g tiny.vg.gcsa -k 16 tiny.vg
@@ -55,6 +55,18 @@ vg index -x bigins.vg.xg -g bigins.vg.gcsa -k 16 bigins.vg
 cat call/bigins-s1337-n100-l12.reads > reads.txt
 vg map -T reads.txt -g bigins.vg.gcsa -x bigins.vg.xg > bigins.gam
 is "$(vg genotype bigins.vg -G bigins.gam -t 1 -v | grep GACGTTACAATGAGCCCTACAGACATATC | wc -l)" "1" "genotype finds big insert" 
+vg gamsort bigins.gam -i bigins.sorted.gam.gai > bigins.sorted.gam
+is "$(vg genotype bigins.vg -S bigins.sorted.gam -t 2 -v | grep GACGTTACAATGAGCCCTACAGACATATC | wc -l)" "1" "genotype finds big insert with reads streamed from a sorted GAM"
 
-rm -rf bigins.vg bigins.vg.xg bigins.vg.gcsa bigins.vg.gcsa.lcp bigins.gam reads.txt 
+# Streaming from a sorted GAM expects the reads to be embedded already, so check it against augmented input too
+vg augment bigins.vg bigins.gam -A bigins.aug.gam > bigins.aug.vg
+vg gamsort bigins.aug.gam -i bigins.aug.sorted.gam.gai > bigins.aug.sorted.gam
+vg genotype bigins.aug.vg -G bigins.aug.gam -t 1 -v | grep -v "^#" | cut -f 1-5 | sort > loaded.sites
+vg genotype bigins.aug.vg -S bigins.aug.sorted.gam -t 2 -v | grep -v "^#" | cut -f 1-5 | sort > streamed.sites
+is "$(grep GACGTTACAATGAGCCCTACAGACATATC streamed.sites | wc -l)" "1" "genotype finds big insert streaming reads for an augmented graph"
+diff loaded.sites streamed.sites
+is "$?" "0" "genotype calls the same sites on an augmented graph whether or not reads are streamed"
+
+rm -rf bigins.vg bigins.vg.xg bigins.vg.gcsa bigins.vg.gcsa.lcp bigins.gam bigins.sorted.gam bigins.sorted.gam.gai reads.txt 
+rm -f bigins.aug.vg bigins.aug.gam bigins.aug.sorted.gam bigins.aug.sorted.gam.gai loaded.sites streamed.sites
 
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 16
+plan tests 18
 
 # Construct a graph with alt paths so we can make a gPBWT and later a GBWT
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz -a >x.vg
@@ -35,6 +35,11 @@ is $(ls -l _chunk_test*.gam | wc -l) 2 "gam chunker produces correct number of g
 is $(grep x _chunk_test_out.bed | wc -l) 2 "gam chunker produces bed with correct number of chunks"
 is "$(vg view -aj _chunk_test_0_x_0_199.gam | wc -l)" "$(vg view -aj _chunk_test_0_x_0_199.gam | sort | uniq | wc -l)" "gam chunker emits each matching read at most once"
 is "$(vg view -aj _chunk_test_1_x_500_627.gam | wc -l)" "225" "chunk contains the expected number of alignments"
+vg chunk -x x.xg -a x.sorted.gam -O -t 2 -b _chunk_onepass -e _chunk_test_bed.bed -c 0
+is "$(vg view -aj _chunk_onepass_1_x_500_627.gam | sort | md5sum)" "$(vg view -aj _chunk_test_1_x_500_627.gam | sort | md5sum)" "one-pass gam chunking matches indexed chunking"
+vg chunk -x x.xg -a x.sorted.gam -O -f -b _chunk_onepass_f -e _chunk_test_bed.bed -c 0
+vg chunk -x x.xg -a x.sorted.gam -f -b _chunk_test_f -e _chunk_test_bed.bed -c 0
+is "$(vg view -aj _chunk_onepass_f_0_x_0_199.gam | sort | md5sum)" "$(vg view -aj _chunk_test_f_0_x_0_199.gam | sort | md5sum)" "one-pass gam chunking respects -f"
 
 #check that id ranges work
 is $(vg chunk -x x.xg -r 1:3 -c 0 | vg view - -j | jq .node | grep id |  wc -l) 3 "id chunker produces correct chunk size"
@@ -55,6 +60,6 @@ vg chunk -x x.xg -n 5 -b x.chunk/
 # we grep it out of the comparison
 is $(cat x.chunk/*vg | vg view -V - | grep -v P 2>/dev/null | sort |  md5sum | cut -f 1 -d\ ) $(vg view x.vg | grep -v P | sort  | md5sum | cut -f 1 -d\ ) "n-chunking works and chunks over the full graph"
 
-rm -rf x.sorted.gam x.sorted.gam.gai _chunk_test_bed.bed _chunk_test* x.chunk
+rm -rf x.sorted.gam x.sorted.gam.gai _chunk_test_bed.bed _chunk_test* _chunk_onepass* x.chunk
 rm -f x.vg x.xg x.gbwt x.gam.json filter_chunk*.gam chunks.bed
 rm -f chunk_*.annotate.txt
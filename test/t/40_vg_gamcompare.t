@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 2
+plan tests 6
 
 vg construct -r small/x.fa -v small/x.vcf.gz >s.vg
 vg index -x s.xg -g s.gcsa s.vg
@@ -16,4 +16,20 @@ is $(vg map -x s.xg -g s.gcsa -G s.sim --surject-to sam | vg inject -x s.xg - |
 
 is $(vg gamcompare --range 10 s.sim s.sim | vg view -aj - | jq -c 'select(.correctly_mapped)' | wc -l) 1000 "gamcompare says the truth is correctly mapped"
 
+vg map -x s.xg -g s.gcsa -G s.sim -t 1 > s.gam
+vg gamcompare -r 10 -t 1 s.gam s.sim 2>unordered.txt | vg view -aj - | jq -c '[.name, .correctly_mapped]' > unordered.json
+vg gamcompare -r 10 -s s.gam s.sim 2>ordered.txt | vg view -aj - | jq -c '[.name, .correctly_mapped]' > ordered.json
+is "$(cat ordered.txt)" "$(cat unordered.txt)" "gamcompare finds the same number of correct reads when streaming same-order inputs"
+diff ordered.json unordered.json
+is "$?" 0 "gamcompare annotates same-order inputs the same way when streaming"
+
+vg view -aj s.sim | sed '400,500d' | vg view -JaG - > partial.sim
+vg gamcompare -r 10 -t 1 s.gam partial.sim 2>unordered.txt | vg view -aj - | jq -c '[.name, .correctly_mapped]' > unordered.json
+vg gamcompare -r 10 -s s.gam partial.sim 2>ordered.txt | vg view -aj - | jq -c '[.name, .correctly_mapped]' > ordered.json
+is "$(grep correct ordered.txt)" "$(cat unordered.txt)" "gamcompare finds the same number of correct reads when streaming with reads missing from the truth"
+diff ordered.json unordered.json
+is "$?" 0 "gamcompare passes through reads missing from the truth when streaming"
+
+rm -f s.gam partial.sim ordered.txt unordered.txt ordered.json unordered.json
+
 rm -f s.vg s.xg s.gcsa s.gcsa.lcp s.sim